@@ -0,0 +1,480 @@
+//--------------------------------------------------
+// Standalone benchmark suite (make bench)
+//--------------------------------------------------
+// Generates synthetic databases at each requested scale, then times the
+// load (players alone and with their stats), index build and teardown, exact
+// lookup (single and batched), prefix search and character aggregation paths
+// of PlayerHashTable and PlayerTrie with a nanosecond clock. Per-operation latencies are summarised as mean and
+// percentiles; a table goes to stdout and the same results as JSON to --out.
+// Each index's allocator-level memory (live, peak, allocation count) is
+// reported per scale after the latency table, followed by the player row
+// decoder's allocations per row and rows/s against the old decoder's.
+// Needs only SQLite, not wxWidgets.
+
+#include "synth_db.h"
+#include "backend.h"
+#include "columns.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::vector<size_t> scales = {10000, 100000};
+    double sets_per_player = 5.0;
+    std::string dir = ".";
+    std::string out = "bench_results.json";
+    unsigned threads = 0;      // 0: loader default
+    size_t reps = 3;           // repetitions of the whole-table benchmarks
+    size_t lookups = 100000;   // operations per lookup benchmark
+    size_t batch = 256;        // keys per batched lookup
+    size_t prefixes = 2000;
+    uint64_t seed = 1;
+    bool regen = false;
+};
+
+struct Result {
+    size_t players = 0;
+    std::string benchmark;
+    std::string structure;
+    size_t ops = 0;
+    double mean_ns = 0, p50_ns = 0, p90_ns = 0, p99_ns = 0, max_ns = 0;
+};
+
+// Read from the structure's TrackingResource after the last load with stats,
+// once retired versions are reclaimed; peak covers every load and rebuild at
+// the scale
+struct MemoryResult {
+    size_t players = 0;
+    std::string structure;
+    MemoryStats stats;
+};
+
+// One decoder's pass over the players table (Backend_BenchmarkPlayerDecode)
+struct DecodeResult {
+    size_t players = 0;
+    std::string decoder;
+    DecodeBenchmark stats;
+};
+
+// Keeps benchmarked results alive without the optimiser dropping the work
+volatile uintptr_t g_sink = 0;
+template <typename T> void consume(const T& v) { g_sink = g_sink + (uintptr_t)v; }
+
+inline double nsSince(Clock::time_point t0) {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+}
+
+double timerOverheadNs() {
+    std::vector<double> samples(100000);
+    for (double& s : samples) {
+        auto t0 = Clock::now();
+        s = nsSince(t0);
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+Result summarise(size_t players, const char* benchmark, const char* structure, std::vector<double>& samples) {
+    Result r;
+    r.players = players;
+    r.benchmark = benchmark;
+    r.structure = structure;
+    r.ops = samples.size();
+    if (samples.empty()) return r;
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&samples](double p) { return samples[std::min(samples.size() - 1, (size_t)(p * samples.size()))]; };
+    double sum = 0;
+    for (double s : samples) sum += s;
+    r.mean_ns = sum / samples.size();
+    r.p50_ns = pct(0.50);
+    r.p90_ns = pct(0.90);
+    r.p99_ns = pct(0.99);
+    r.max_ns = samples.back();
+    return r;
+}
+
+// Times fn(i) for i in [0, ops) one call at a time
+template <typename Fn>
+std::vector<double> timeEach(size_t ops, Fn fn) {
+    std::vector<double> samples(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        auto t0 = Clock::now();
+        fn(i);
+        samples[i] = nsSince(t0);
+    }
+    return samples;
+}
+
+// Times fn(first, last) over consecutive batches of keys; one sample per
+// batch, in nanoseconds per key
+template <typename Fn>
+std::vector<double> timeBatches(size_t keys, size_t batch, Fn fn) {
+    std::vector<double> samples;
+    for (size_t first = 0; first < keys; first += batch) {
+        size_t last = std::min(keys, first + batch);
+        auto t0 = Clock::now();
+        fn(first, last);
+        samples.push_back(nsSince(t0) / (double)(last - first));
+    }
+    return samples;
+}
+
+void printResult(const Result& r) {
+    std::printf("%-10zu %-16s %-10s %8zu %14.0f %14.0f %14.0f %14.0f %14.0f\n",
+                r.players, r.benchmark.c_str(), r.structure.c_str(), r.ops,
+                r.mean_ns, r.p50_ns, r.p90_ns, r.p99_ns, r.max_ns);
+    std::fflush(stdout);
+}
+
+void printMemory(const std::vector<MemoryResult>& memory) {
+    std::printf("\n%-10s %-10s %14s %14s %14s %12s\n",
+                "players", "structure", "live_bytes", "peak_bytes", "allocations", "bytes/player");
+    for (const MemoryResult& m : memory)
+        std::printf("%-10zu %-10s %14zu %14zu %14zu %12.1f\n", m.players, m.structure.c_str(),
+                    m.stats.live_bytes, m.stats.peak_bytes, m.stats.allocations,
+                    m.players ? (double)m.stats.live_bytes / m.players : 0.0);
+}
+
+void printDecode(const std::vector<DecodeResult>& decode) {
+    std::printf("\n%-10s %-10s %14s %14s %14s\n", "players", "decoder", "rows", "allocs/row", "rows/s");
+    for (const DecodeResult& d : decode)
+        std::printf("%-10zu %-10s %14zu %14.2f %14.0f\n", d.players, d.decoder.c_str(),
+                    d.stats.rows, d.stats.allocs_per_row, d.stats.rows_per_sec);
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+bool writeJson(const std::string& path, const Options& opt, double overhead, const std::vector<Result>& results,
+               const std::vector<MemoryResult>& memory, const std::vector<DecodeResult>& decode) {
+    std::ostringstream js;
+    js << "{\n  \"timer_overhead_ns\": " << overhead
+       << ",\n  \"loader_threads\": " << Backend_GetLoaderThreads()
+       << ",\n  \"sets_per_player\": " << opt.sets_per_player
+       << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        js << (i ? ",\n    " : "\n    ")
+           << "{\"players\": " << r.players
+           << ", \"benchmark\": \"" << jsonEscape(r.benchmark) << "\""
+           << ", \"structure\": \"" << jsonEscape(r.structure) << "\""
+           << ", \"ops\": " << r.ops
+           << ", \"mean_ns\": " << r.mean_ns << ", \"p50_ns\": " << r.p50_ns
+           << ", \"p90_ns\": " << r.p90_ns << ", \"p99_ns\": " << r.p99_ns
+           << ", \"max_ns\": " << r.max_ns << "}";
+    }
+    js << "\n  ],\n  \"memory\": [";
+    for (size_t i = 0; i < memory.size(); ++i) {
+        const MemoryResult& m = memory[i];
+        js << (i ? ",\n    " : "\n    ")
+           << "{\"players\": " << m.players
+           << ", \"structure\": \"" << jsonEscape(m.structure) << "\""
+           << ", \"live_bytes\": " << m.stats.live_bytes
+           << ", \"peak_bytes\": " << m.stats.peak_bytes
+           << ", \"allocations\": " << m.stats.allocations << "}";
+    }
+    js << "\n  ],\n  \"decode\": [";
+    for (size_t i = 0; i < decode.size(); ++i) {
+        const DecodeResult& d = decode[i];
+        js << (i ? ",\n    " : "\n    ")
+           << "{\"players\": " << d.players
+           << ", \"decoder\": \"" << jsonEscape(d.decoder) << "\""
+           << ", \"rows\": " << d.stats.rows
+           << ", \"allocs_per_row\": " << d.stats.allocs_per_row
+           << ", \"rows_per_sec\": " << d.stats.rows_per_sec << "}";
+    }
+    js << "\n  ]\n}\n";
+    if (path == "-") {
+        std::cout << js.str();
+        return true;
+    }
+    std::ofstream f(path);
+    f << js.str();
+    if (!f) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool runScale(size_t players, const Options& opt, std::vector<Result>& results,
+              std::vector<MemoryResult>& memory, std::vector<DecodeResult>& decode) {
+    SynthDbOptions synth;
+    synth.players = players;
+    synth.sets_per_player = opt.sets_per_player;
+    synth.seed = opt.seed;
+    std::string db = opt.dir + "/synth_" + std::to_string(players) + ".db";
+    if (opt.regen || !SynthDb_Matches(db, synth)) {
+        std::fprintf(stderr, "Generating %s ...\n", db.c_str());
+        auto t0 = Clock::now();
+        if (!SynthDb_Generate(db, synth)) return false;
+        std::fprintf(stderr, "  done in %.1f s\n", nsSince(t0) / 1e9);
+    }
+    auto add = [&](const char* benchmark, const char* structure, std::vector<double> samples) {
+        results.push_back(summarise(players, benchmark, structure, samples));
+        printResult(results.back());
+    };
+
+    // --- Whole-table paths, repeated. Every load starts from empty structures,
+    // as the first load of a session does, so no published version is kept
+    // alongside the one being built ---
+    std::vector<double> loadNs, loadStatsNs;
+    PlayerHashTable hash;
+    PlayerTrie trie;
+    auto dropAll = [&hash, &trie]() {
+        hash.Clear();
+        hash.Publish();
+        trie.Clear();
+        trie.Publish();
+        Rcu_Synchronize();
+    };
+    for (size_t rep = 0; rep < opt.reps; ++rep) {
+        dropAll();
+        auto t0 = Clock::now();
+        if (!BackendDB_LoadAllPlayers(db, hash, trie)) return false;
+        loadNs.push_back(nsSince(t0));
+    }
+    add("load_players", "hash+trie", loadNs);
+
+    // --- Row decoding alone, current decoder against the old one ---
+    for (bool legacy : {false, true}) {
+        DecodeBenchmark d;
+        if (!Backend_BenchmarkPlayerDecode(db, legacy, d)) return false;
+        decode.push_back({players, legacy ? "legacy" : "current", d});
+    }
+
+    // Builds stream from the other index into an emptied one, so at most one
+    // copy of each structure is alive at a time. Teardown is the clear plus
+    // the wait for the dropped version to be freed.
+    std::vector<double> buildHashNs, buildTrieNs, teardownHashNs, teardownTrieNs;
+    for (size_t rep = 0; rep < opt.reps; ++rep) {
+        auto t0 = Clock::now();
+        hash.Clear();
+        hash.Publish();
+        Rcu_Synchronize();
+        teardownHashNs.push_back(nsSince(t0));
+        t0 = Clock::now();
+        hash.Reserve(trie.Size());
+        trie.ForEachRecord([&hash](const PlayerRecord& r) { hash.Insert(r); });
+        hash.Publish();
+        buildHashNs.push_back(nsSince(t0));
+
+        t0 = Clock::now();
+        trie.Clear();
+        trie.Publish();
+        Rcu_Synchronize();
+        teardownTrieNs.push_back(nsSince(t0));
+        t0 = Clock::now();
+        hash.ForEachRecord([&trie](const PlayerRecord& r) { trie.Insert(r); });
+        trie.Publish();
+        buildTrieNs.push_back(nsSince(t0));
+    }
+    add("build", "hash", buildHashNs);
+    add("build", "trie", buildTrieNs);
+    add("teardown", "hash", teardownHashNs);
+    add("teardown", "trie", teardownTrieNs);
+
+    for (size_t rep = 0; rep < opt.reps; ++rep) {
+        dropAll();
+        auto t0 = Clock::now();
+        if (!BackendDB_LoadPlayersWithStats(db, hash, trie)) return false;
+        loadStatsNs.push_back(nsSince(t0));
+    }
+    add("load_with_stats", "hash+trie", loadStatsNs);
+    Rcu_Synchronize();
+    const size_t count = hash.Size();
+    memory.push_back({count, "hash", hash.GetMemoryStats()});
+    memory.push_back({trie.Size(), "trie", trie.GetMemoryStats()});
+    if (count == 0) return true;
+
+    // --- Point lookups: ~90% hits, the rest names and IDs that do not exist ---
+    uint64_t state = opt.seed;
+    auto pick = [&state](size_t n) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return (size_t)((state >> 33) % n);
+    };
+    // Keys come from an evenly spaced sample of the players, drawn at random
+    std::vector<std::pair<std::string, std::string>> sample;   // name, id
+    const size_t stride = std::max<size_t>(1, count / std::max(opt.lookups, opt.prefixes));
+    size_t seen = 0;
+    hash.ForEachRecord([&](const PlayerRecord& r) {
+        if (seen++ % stride == 0) sample.emplace_back(r.name, r.id);
+    });
+    std::vector<std::string> names(opt.lookups), ids(opt.lookups);
+    for (size_t i = 0; i < opt.lookups; ++i) {
+        const auto& r = sample[pick(sample.size())];
+        bool miss = pick(10) == 0;
+        names[i] = miss ? r.first + "~" : r.first;
+        ids[i] = miss ? "-" + r.second : r.second;
+    }
+    RcuReadGuard guard;   // returned pointers are only valid under a guard
+    add("exact_lookup", "hash", timeEach(names.size(), [&](size_t i) { consume(hash.SearchByName(names[i])); }));
+    add("exact_lookup", "trie", timeEach(names.size(), [&](size_t i) { consume(trie.SearchExact(names[i])); }));
+    add("id_lookup", "hash", timeEach(ids.size(), [&](size_t i) { consume(hash.SearchByID(ids[i])); }));
+
+    // --- The same keys in batches, per key. The _loop rows feed each batch
+    // to the single-key calls, so they differ from the _batch rows only in
+    // the batching, not in the per-call clock reads ---
+    std::vector<std::vector<std::string>> nameBatches, idBatches;
+    for (size_t first = 0; first < names.size(); first += opt.batch) {
+        size_t last = std::min(names.size(), first + opt.batch);
+        nameBatches.emplace_back(names.begin() + first, names.begin() + last);
+        idBatches.emplace_back(ids.begin() + first, ids.begin() + last);
+    }
+    auto batchOf = [&opt](size_t first) { return first / opt.batch; };
+    add("exact_loop", "hash", timeBatches(names.size(), opt.batch, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) consume(hash.SearchByName(names[i]));
+    }));
+    add("exact_batch", "hash", timeBatches(names.size(), opt.batch, [&](size_t first, size_t) {
+        consume(hash.SearchByNames(nameBatches[batchOf(first)]).back());
+    }));
+    add("exact_loop", "trie", timeBatches(names.size(), opt.batch, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) consume(trie.SearchExact(names[i]));
+    }));
+    add("exact_batch", "trie", timeBatches(names.size(), opt.batch, [&](size_t first, size_t) {
+        consume(trie.SearchExactBatch(nameBatches[batchOf(first)]).back());
+    }));
+    add("id_loop", "hash", timeBatches(ids.size(), opt.batch, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) consume(hash.SearchByID(ids[i]));
+    }));
+    add("id_batch", "hash", timeBatches(ids.size(), opt.batch, [&](size_t first, size_t) {
+        consume(hash.SearchByIDs(idBatches[batchOf(first)]).back());
+    }));
+
+    // --- Prefix search: 2-4 byte prefixes of existing tags ---
+    std::vector<std::string> prefixes(opt.prefixes);
+    for (std::string& p : prefixes) {
+        const std::string& name = sample[pick(sample.size())].first;
+        p = name.substr(0, std::min(name.size(), 2 + pick(3)));
+    }
+    add("prefix_search", "trie", timeEach(prefixes.size(), [&](size_t i) { consume(trie.SearchByPrefix(prefixes[i]).size()); }));
+    add("prefix_top10", "trie", timeEach(prefixes.size(), [&](size_t i) {
+        consume(trie.TopKByPrefix(prefixes[i], 10).size());
+    }));
+
+    // --- Played/won totals per main character ---
+    std::vector<double> rowHash, rowTrie, colBuild, colSum;
+    for (size_t rep = 0; rep < opt.reps; ++rep) {
+        auto t0 = Clock::now();
+        std::map<std::string, PlayerColumns::Totals> byChar;
+        auto tally = [&byChar](const PlayerRecord& r) {
+            auto& t = byChar[r.main_character];
+            t.played += std::max(r.matches_played, 0);
+            t.won += std::max(r.matches_won, 0);
+        };
+        hash.ForEachRecord(tally);
+        rowHash.push_back(nsSince(t0));
+        consume(byChar.size());
+
+        t0 = Clock::now();
+        byChar.clear();
+        trie.ForEachRecord(tally);
+        rowTrie.push_back(nsSince(t0));
+        consume(byChar.size());
+
+        PlayerColumns columns;
+        t0 = Clock::now();
+        columns.Build(hash);
+        colBuild.push_back(nsSince(t0));
+        t0 = Clock::now();
+        consume(columns.SumByCharacter().size());
+        colSum.push_back(nsSince(t0));
+    }
+    add("char_aggregate", "hash", rowHash);
+    add("char_aggregate", "trie", rowTrie);
+    add("char_aggregate", "columns", colSum);
+    add("columns_build", "columns", colBuild);
+    return true;
+}
+
+bool parseScales(const char* arg, std::vector<size_t>& out) {
+    out.clear();
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        char* end = nullptr;
+        double v = std::strtod(item.c_str(), &end);
+        if (end == item.c_str() || v < 1) return false;
+        if (*end == 'k' || *end == 'K') v *= 1e3;
+        else if (*end == 'm' || *end == 'M') v *= 1e6;
+        out.push_back((size_t)v);
+    }
+    return !out.empty();
+}
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --scales LIST          player counts, e.g. 10k,100k,1m,10m (default 10k,100k)\n"
+        "  --sets-per-player X    sets generated per player (default 5)\n"
+        "  --dir DIR              where the synthetic databases are kept (default .)\n"
+        "  --out FILE             JSON results, - for stdout (default bench_results.json)\n"
+        "  --threads N            loader threads (default: hardware threads)\n"
+        "  --reps N               repetitions of whole-table benchmarks (default 3)\n"
+        "  --lookups N            operations per lookup benchmark (default 100000)\n"
+        "  --prefixes N           operations per prefix benchmark (default 2000)\n"
+        "  --batch N              keys per batched lookup (default 256)\n"
+        "  --seed N               generator seed (default 1)\n"
+        "  --regen                regenerate databases even if they match\n", argv0);
+}
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = true;
+        if (!std::strcmp(a, "--regen")) { opt.regen = true; continue; }
+        if (!std::strcmp(a, "--help") || !v) { usage(argv[0]); return !std::strcmp(a, "--help") ? 0 : 2; }
+        if (!std::strcmp(a, "--scales")) ok = parseScales(v, opt.scales);
+        else if (!std::strcmp(a, "--sets-per-player")) opt.sets_per_player = std::atof(v);
+        else if (!std::strcmp(a, "--dir")) opt.dir = v;
+        else if (!std::strcmp(a, "--out")) opt.out = v;
+        else if (!std::strcmp(a, "--threads")) opt.threads = (unsigned)std::atoi(v);
+        else if (!std::strcmp(a, "--reps")) opt.reps = std::max(1, std::atoi(v));
+        else if (!std::strcmp(a, "--lookups")) opt.lookups = (size_t)std::max(1, std::atoi(v));
+        else if (!std::strcmp(a, "--prefixes")) opt.prefixes = (size_t)std::max(1, std::atoi(v));
+        else if (!std::strcmp(a, "--batch")) opt.batch = (size_t)std::max(1, std::atoi(v));
+        else if (!std::strcmp(a, "--seed")) opt.seed = std::strtoull(v, nullptr, 10);
+        else ok = false;
+        if (!ok) { usage(argv[0]); return 2; }
+        ++i;
+    }
+    if (opt.threads) Backend_SetLoaderThreads(opt.threads);
+
+    double overhead = timerOverheadNs();
+    std::printf("timer overhead %.0f ns/sample (not subtracted), %u loader thread(s)\n\n",
+                overhead, Backend_GetLoaderThreads());
+    std::printf("%-10s %-16s %-10s %8s %14s %14s %14s %14s %14s\n",
+                "players", "benchmark", "structure", "ops", "mean_ns", "p50_ns", "p90_ns", "p99_ns", "max_ns");
+
+    std::vector<Result> results;
+    std::vector<MemoryResult> memory;
+    std::vector<DecodeResult> decode;
+    for (size_t players : opt.scales) {
+        if (!runScale(players, opt, results, memory, decode)) {
+            std::cerr << "Benchmark failed at " << players << " players" << std::endl;
+            return 1;
+        }
+    }
+    printMemory(memory);
+    printDecode(decode);
+    return writeJson(opt.out, opt, overhead, results, memory, decode) ? 0 : 1;
+}
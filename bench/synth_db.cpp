@@ -0,0 +1,190 @@
+#include "synth_db.h"
+#include <sqlite3.h>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+// splitmix64: small, fast and identical on every platform, unlike std::
+// distributions
+struct Rng {
+    uint64_t s;
+    uint64_t next() {
+        uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    size_t below(size_t n) { return (size_t)(next() % n); }
+};
+
+const char* const kSyllables[] = {
+    "ka", "ze", "mi", "ro", "lu", "tan", "shi", "vo", "rex", "jin", "ar", "el",
+    "mk", "leo", "sp", "ar", "go", "ny", "qu", "ix", "bo", "da", "fe", "ha",
+};
+const char* const kCharacters[] = {
+    "mario", "luigi", "fox", "falco", "pikachu", "ness", "inkling", "joker",
+    "pyra", "steve", "kazuya", "sora", "snake", "wolf", "roy", "cloud",
+    "sonic", "peach", "daisy", "samus", "dark_samus", "lucina", "marth", "ike",
+};
+const char* const kStages[] = {
+    "Battlefield", "Final Destination", "Smashville", "Town and City",
+    "Pokemon Stadium 2", "Kalos Pokemon League", "Hollow Bastion", "Small Battlefield",
+};
+template <typename T, size_t N> size_t countOf(T (&)[N]) { return N; }
+
+const long long kFirstPlayerId = 1000;
+
+std::string makeTag(Rng& rng, size_t i) {
+    std::string tag;
+    size_t parts = 1 + rng.below(3);
+    for (size_t p = 0; p < parts; ++p) tag += kSyllables[rng.below(countOf(kSyllables))];
+    tag[0] = (char)(tag[0] - 'a' + 'A');
+    // Most tags are made unique with a suffix; the rest may collide
+    if (rng.below(100) >= 3) tag += std::to_string(i);
+    return tag;
+}
+
+bool exec(sqlite3* db, const char* sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << "sqlite3_exec FAILED: " << (err ? err : "unknown") << std::endl;
+        sqlite3_free(err);
+        return false;
+    }
+    return true;
+}
+
+sqlite3_stmt* prepare(sqlite3* db, const char* sql) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "sqlite3_prepare_v2 FAILED: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+    return stmt;
+}
+
+void bindText(sqlite3_stmt* stmt, int col, const std::string& s) {
+    sqlite3_bind_text(stmt, col, s.data(), (int)s.size(), SQLITE_TRANSIENT);
+}
+
+bool insertPlayers(sqlite3* db, const SynthDbOptions& opt, Rng& rng) {
+    sqlite3_stmt* stmt = prepare(db, "INSERT INTO players VALUES ('ultimate', ?1, ?2, ?3);");
+    if (!stmt) return false;
+    std::string characters;
+    for (size_t i = 0; i < opt.players; ++i) {
+        const char* main = kCharacters[rng.below(countOf(kCharacters))];
+        const char* second = kCharacters[rng.below(countOf(kCharacters))];
+        characters = std::string("{\"ultimate/") + main + "\": " + std::to_string(1 + rng.below(40))
+                   + ", \"ultimate/" + second + "\": " + std::to_string(1 + rng.below(5)) + "}";
+        bindText(stmt, 1, std::to_string(kFirstPlayerId + (long long)i));
+        bindText(stmt, 2, makeTag(rng, i));
+        bindText(stmt, 3, characters);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::cerr << "Insert player FAILED: " << sqlite3_errmsg(db) << std::endl;
+            sqlite3_finalize(stmt);
+            return false;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+bool insertSets(sqlite3* db, const SynthDbOptions& opt, Rng& rng) {
+    if (opt.players < 2) return true;
+    sqlite3_stmt* stmt = prepare(db,
+        "INSERT INTO sets VALUES (?1, 'ultimate', ?2, ?3, ?4, ?5, ?6, ?7, ?8);");
+    if (!stmt) return false;
+    const size_t sets = (size_t)(opt.players * opt.sets_per_player);
+    const size_t tournaments = sets / 200 + 1;
+    std::string games;
+    for (size_t k = 0; k < sets; ++k) {
+        long long a = kFirstPlayerId + (long long)rng.below(opt.players);
+        long long b = kFirstPlayerId + (long long)rng.below(opt.players - 1);
+        if (b >= a) ++b;
+        int wins_a = 0, wins_b = 0;
+        size_t count = 2 + rng.below(2);
+        games = "[";
+        for (size_t g = 0; g < count && wins_a < 2 && wins_b < 2; ++g) {
+            bool a_wins = rng.below(2) == 0;
+            (a_wins ? wins_a : wins_b)++;
+            if (g) games += ", ";
+            games += "{\"winner_id\": " + std::to_string(a_wins ? a : b)
+                   + ", \"loser_id\": " + std::to_string(a_wins ? b : a)
+                   + ", \"winner_score\": 1, \"loser_score\": 0, \"winner_char\": \"ultimate/"
+                   + kCharacters[rng.below(countOf(kCharacters))]
+                   + "\", \"loser_char\": \"ultimate/" + kCharacters[rng.below(countOf(kCharacters))]
+                   + "\", \"stage\": \"" + kStages[rng.below(countOf(kStages))] + "\"}";
+        }
+        games += "]";
+        bindText(stmt, 1, "s" + std::to_string(k));
+        bindText(stmt, 2, "t" + std::to_string(rng.below(tournaments)));
+        bindText(stmt, 3, std::to_string(wins_a > wins_b ? a : b));
+        bindText(stmt, 4, std::to_string(a));
+        bindText(stmt, 5, std::to_string(b));
+        sqlite3_bind_int(stmt, 6, wins_a);
+        sqlite3_bind_int(stmt, 7, wins_b);
+        bindText(stmt, 8, games);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::cerr << "Insert set FAILED: " << sqlite3_errmsg(db) << std::endl;
+            sqlite3_finalize(stmt);
+            return false;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+std::string metaValue(const SynthDbOptions& opt) {
+    char buf[96];
+    std::snprintf(buf, sizeof buf, "%zu/%.3f/%llu", opt.players, opt.sets_per_player,
+                  (unsigned long long)opt.seed);
+    return buf;
+}
+}
+
+bool SynthDb_Generate(const std::string& path, const SynthDbOptions& options) {
+    std::remove(path.c_str());
+    sqlite3* db = nullptr;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+        std::cerr << "sqlite3_open FAILED: " << (db ? sqlite3_errmsg(db) : "unknown") << std::endl;
+        sqlite3_close(db);
+        return false;
+    }
+    Rng rng{options.seed};
+    bool ok = exec(db, "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF;"
+                       "CREATE TABLE players (game TEXT, player_id TEXT, tag TEXT, characters TEXT);"
+                       "CREATE TABLE sets (key TEXT, game TEXT, tournament_key TEXT, winner_id TEXT,"
+                       " p1_id TEXT, p2_id TEXT, p1_score INT, p2_score INT, game_data TEXT);"
+                       "CREATE TABLE synth_meta (options TEXT);"
+                       "BEGIN;")
+           && insertPlayers(db, options, rng)
+           && insertSets(db, options, rng);
+    if (ok) {
+        std::string meta = "INSERT INTO synth_meta VALUES ('" + metaValue(options) + "'); COMMIT;";
+        ok = exec(db, meta.c_str());
+    }
+    sqlite3_close(db);
+    if (!ok) std::remove(path.c_str());
+    return ok;
+}
+
+bool SynthDb_Matches(const std::string& path, const SynthDbOptions& options) {
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        sqlite3_close(db);
+        return false;
+    }
+    bool match = false;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT options FROM synth_meta;", -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char* text = sqlite3_column_text(stmt, 0);
+        match = text && metaValue(options) == reinterpret_cast<const char*>(text);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return match;
+}
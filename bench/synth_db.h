@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+//--------------------------------------------------
+// Synthetic players/sets database for benchmarks
+//--------------------------------------------------
+// Writes a SQLite file with the same players and sets tables the loaders
+// read. Tags are built from a small syllable set, so prefixes are shared the
+// way real tags are, and a few percent of them repeat. Every set carries a
+// game_data list of 2-3 games with characters and stages. Output is
+// deterministic for a given seed.
+
+struct SynthDbOptions {
+    size_t players = 10000;
+    double sets_per_player = 5.0;
+    uint64_t seed = 1;
+};
+
+// Overwrites path. Returns false on error.
+bool SynthDb_Generate(const std::string& path, const SynthDbOptions& options);
+// True if path already holds a database generated with the same options
+bool SynthDb_Matches(const std::string& path, const SynthDbOptions& options);
@@ -0,0 +1,51 @@
+#include "allocstats.h"
+#include <cstdlib>
+#include <new>
+
+#ifdef SMASH_COUNT_ALLOCS
+static thread_local size_t t_allocations = 0;
+
+bool AllocStats_Counting() { return true; }
+size_t AllocStats_ThreadAllocations() { return t_allocations; }
+
+// Array and nothrow forms forward to these in libstdc++
+void* operator new(std::size_t size) {
+    ++t_allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#else
+bool AllocStats_Counting() { return false; }
+size_t AllocStats_ThreadAllocations() { return 0; }
+#endif
+
+void TrackingResource::grow(size_t bytes, size_t allocations) {
+    size_t live = _live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    _allocations.fetch_add(allocations, std::memory_order_relaxed);
+    size_t peak = _peak.load(std::memory_order_relaxed);
+    while (live > peak && !_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+void* TrackingResource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = _upstream->allocate(bytes, alignment);
+    grow(bytes, 1);
+    return p;
+}
+void TrackingResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    _upstream->deallocate(p, bytes, alignment);
+    _live.fetch_sub(bytes, std::memory_order_relaxed);
+}
+void TrackingResource::AddExternal(size_t bytes, size_t allocations) {
+    if (bytes || allocations) grow(bytes, allocations);
+}
+void TrackingResource::RemoveExternal(size_t bytes) {
+    if (bytes) _live.fetch_sub(bytes, std::memory_order_relaxed);
+}
+MemoryStats TrackingResource::Stats() const {
+    MemoryStats st;
+    st.live_bytes = _live.load(std::memory_order_relaxed);
+    st.peak_bytes = _peak.load(std::memory_order_relaxed);
+    st.allocations = _allocations.load(std::memory_order_relaxed);
+    return st;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+//--------------------------------------------------
+// Heap allocation counting
+//--------------------------------------------------
+// Only in builds with SMASH_COUNT_ALLOCS defined (the benchmark suite, see
+// the Makefile) is the global operator new replaced (allocstats.cpp) to
+// count calls per thread, so a benchmark can report allocations per row of
+// the code it ran. The app keeps the default allocator and the count stays 0.
+// Counting is one thread-local increment; allocations made by C libraries
+// (SQLite's own malloc) are not seen.
+
+// Whether this build counts allocations at all
+bool AllocStats_Counting();
+// operator new calls made by the calling thread so far
+size_t AllocStats_ThreadAllocations();
+
+//--------------------------------------------------
+// Per-structure memory accounting
+//--------------------------------------------------
+// A structure that allocates through its own TrackingResource can report
+// what it holds exactly instead of estimating from sizeof. Memory a
+// structure owns but cannot route through the resource (std::string
+// payloads) is added and removed by hand with AddExternal/RemoveExternal.
+
+struct MemoryStats {
+    size_t live_bytes = 0;
+    size_t peak_bytes = 0;    // highest live_bytes seen
+    size_t allocations = 0;   // made so far, freed or not
+};
+
+class TrackingResource : public std::pmr::memory_resource {
+public:
+    explicit TrackingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : _upstream(upstream) {}
+    TrackingResource(const TrackingResource&) = delete;
+    TrackingResource& operator=(const TrackingResource&) = delete;
+
+    void AddExternal(size_t bytes, size_t allocations);
+    void RemoveExternal(size_t bytes);
+    MemoryStats Stats() const;
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    void grow(size_t bytes, size_t allocations);
+
+    std::pmr::memory_resource* _upstream;
+    std::atomic<size_t> _live{0};
+    std::atomic<size_t> _peak{0};
+    std::atomic<size_t> _allocations{0};
+};
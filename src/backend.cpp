@@ -4,241 +4,2233 @@
 #include <queue>
 #include <iostream>
 #include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <charconv>
+#include <deque>
+#include "allocstats.h"
+#include "metrics.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-// --- Rows visited counter implementation ---
-std::atomic<size_t> g_backendRowsVisited{0};
+// --- Rows visited: a sharded counter, so loader threads never contend on it ---
 size_t Backend_GetTotalRowsVisited() {
-    return g_backendRowsVisited.load();
+    return (size_t)Metrics_Counter(METRIC_ROWS_VISITED);
 }
 
-// --- ONLY load id, name, main_character ---
-bool BackendDB_LoadAllPlayers(const std::string& db_path, PlayerHashTable& hash) {
-    static PlayerTrie tr;
-    return BackendDB_LoadAllPlayers(db_path, hash, tr);
+static std::atomic<size_t> g_lastRowsScanned{0};
+static std::atomic<double> g_lastLoadMs{0.0};
+size_t Backend_GetLastRowsScanned() { return g_lastRowsScanned.load(); }
+double Backend_GetLastLoadMillis()  { return g_lastLoadMs.load(); }
+
+static void recordLoadPass(size_t rows, std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    g_lastRowsScanned = rows;
+    g_lastLoadMs = elapsed.count();
 }
-bool BackendDB_LoadAllPlayers(const std::string& db_path, PlayerTrie& trie) {
-    static PlayerHashTable ht;
-    return BackendDB_LoadAllPlayers(db_path, ht, trie);
+
+// --- LoadMonitor ---
+LoadMonitor::LoadMonitor(Callback cb, unsigned interval_ms)
+    : cb_(std::move(cb)), interval_(std::chrono::milliseconds(interval_ms)),
+      phase_start_(std::chrono::steady_clock::now()) {}
+void LoadMonitor::BeginPhase(const std::string& phase, size_t total) {
+    {
+        std::lock_guard<std::mutex> lock(phase_mut_);
+        phase_ = phase;
+        total_ = total;
+        phase_start_ = std::chrono::steady_clock::now();
+    }
+    rows_ = 0;
+    next_report_ = 0;
+    report();
 }
-bool BackendDB_LoadAllPlayers(
-    const std::string& db_path,
-    PlayerHashTable& hashOut,
-    PlayerTrie& trieOut)
-{
-    sqlite3* db = nullptr;
-    int rc = sqlite3_open(db_path.c_str(), &db);
+void LoadMonitor::AddRows(size_t n) {
+    rows_ += n;
+    if (!cb_) return;
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto due = next_report_.load(std::memory_order_relaxed);
+    // Only the thread that wins the exchange reports for this interval
+    if (now >= due && next_report_.compare_exchange_strong(due, now + interval_.count()))
+        report();
+}
+void LoadMonitor::report() {
+    if (!cb_) return;
+    LoadProgress p;
+    std::chrono::steady_clock::time_point start;
+    {
+        std::lock_guard<std::mutex> lock(phase_mut_);
+        p.phase = phase_;
+        p.total = total_;
+        start = phase_start_;
+    }
+    p.rows = rows_.load();
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    p.rows_per_sec = secs.count() > 0 ? p.rows / secs.count() : 0.0;
+    cb_(p);
+}
+
+// Workers flush their local row count to the monitor in batches of this size
+static const size_t kProgressBatch = 4096;
+
+// --- Loader threading: each worker reads one rowid range on its own connection ---
+static unsigned defaultLoaderThreads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+static std::atomic<unsigned> g_loaderThreads{defaultLoaderThreads()};
+void Backend_SetLoaderThreads(unsigned threads) { g_loaderThreads = threads ? threads : 1; }
+unsigned Backend_GetLoaderThreads() { return g_loaderThreads.load(); }
 
+// Reservation per partition is its rowid span, up to this; a sparse range can
+// be far larger than the rows it holds
+static const size_t kMaxReserveRows = size_t(1) << 24;
+
+struct RowidRange {
+    long long lo = 0;   // inclusive
+    long long hi = 0;   // exclusive
+};
+
+static sqlite3* openReadOnly(const std::string& db_path) {
+    sqlite3* db = nullptr;
+    int rc = sqlite3_open_v2(db_path.c_str(), &db,
+                             SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
     if (rc != SQLITE_OK || !db) {
         std::cerr << "sqlite3_open FAILED! Error code: " << rc
                   << " - " << (db ? sqlite3_errmsg(db) : "unknown") << std::endl;
         if (db) sqlite3_close(db);
-        return false;
+        return nullptr;
     }
+    return db;
+}
 
-    const char* query =
-        "SELECT player_id, tag, characters FROM players LIMIT 100000;";
-
+static sqlite3_stmt* prepare(sqlite3* db, const char* query) {
     sqlite3_stmt* stmt = nullptr;
-    rc = sqlite3_prepare_v2(db, query, -1, &stmt, nullptr);
+    int rc = sqlite3_prepare_v2(db, query, -1, &stmt, nullptr);
     if (rc != SQLITE_OK || !stmt) {
         std::cerr << "sqlite3_prepare_v2 FAILED! Error code: " << rc
                   << " - " << sqlite3_errmsg(db) << std::endl;
         if (stmt) sqlite3_finalize(stmt);
-        sqlite3_close(db);
-        return false;
+        return nullptr;
     }
+    return stmt;
+}
 
-    hashOut.Clear();
-    trieOut.Clear();
+// Split [MIN(rowid), MAX(rowid)] of a table's rows with rowid >= from into at
+// most `parts` equal ranges
+static size_t rowidSpan(const std::vector<RowidRange>& ranges) {
+    size_t span = 0;
+    for (const auto& r : ranges) span += (size_t)(r.hi - r.lo);
+    return span;
+}
 
-    size_t rows_visited = 0;
+static bool rowidPartitions(const std::string& db_path, const char* table,
+                            unsigned parts, std::vector<RowidRange>& out,
+                            long long from = std::numeric_limits<long long>::min())
+{
+    out.clear();
+    sqlite3* db = openReadOnly(db_path);
+    if (!db) return false;
+    std::string query = std::string("SELECT MIN(rowid), MAX(rowid) FROM ") + table + " WHERE rowid >= ?1;";
+    sqlite3_stmt* stmt = prepare(db, query.c_str());
+    if (!stmt) { sqlite3_close(db); return false; }
+    sqlite3_bind_int64(stmt, 1, from);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        long long lo = sqlite3_column_int64(stmt, 0);
+        long long hi = sqlite3_column_int64(stmt, 1) + 1;
+        long long span = hi - lo;
+        long long chunk = (span + parts - 1) / parts;
+        if (chunk < 1) chunk = 1;
+        for (long long b = lo; b < hi; b += chunk)
+            out.push_back({b, std::min(b + chunk, hi)});
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return true;
+}
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        PlayerRecord rec;
+// Run fn(partition_index) for every partition, one thread each
+template <typename Fn>
+static void runPartitions(size_t count, Fn fn) {
+    if (count == 1) { fn(0); return; }
+    std::vector<std::thread> workers;
+    workers.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        workers.emplace_back(fn, i);
+    for (auto& t : workers) t.join();
+}
 
-        int id_val = sqlite3_column_int(stmt, 0);
-        const unsigned char* col_name   = sqlite3_column_text(stmt, 1);
-        const unsigned char* col_chars  = sqlite3_column_text(stmt, 2);
+// --- PooledString: one global pool, fronted by a per-thread cache ---
+namespace {
+struct StringPool {
+    std::mutex mut;
+    std::deque<std::string> values;   // never shrinks, so addresses are stable
+    std::unordered_map<std::string_view, const std::string*> index;
+    size_t bytes = 0;
+};
+StringPool& stringPool() {
+    static StringPool* pool = new StringPool;   // outlives every static record
+    return *pool;
+}
+const std::string* emptyPooled() {
+    static const std::string* empty = &PooledString::Intern(std::string_view()).str();
+    return empty;
+}
+}
 
-        rec.id = std::to_string(id_val);
-        rec.name = (col_name != nullptr) ? reinterpret_cast<const char*>(col_name) : "";
-        std::string characters = (col_chars != nullptr) ? reinterpret_cast<const char*>(col_chars) : "";
+PooledString::PooledString() : _s(emptyPooled()) {}
 
-        if (characters.empty())
-            continue;
+PooledString PooledString::Intern(std::string_view value) {
+    thread_local std::unordered_map<std::string_view, const std::string*> cache;
+    auto it = cache.find(value);
+    if (it != cache.end()) return PooledString(it->second);
 
-        // --- Extract only the character name: match forward slash up to quote ---
-        std::string main_char = "";
-        auto slash = characters.find('/');
-        if (slash != std::string::npos) {
-            auto quote = characters.find('"', slash + 1);
-            if (quote != std::string::npos && quote > slash + 1) {
-                main_char = characters.substr(slash + 1, quote - slash - 1);
-            }
+    StringPool& pool = stringPool();
+    const std::string* s;
+    {
+        std::lock_guard<std::mutex> lock(pool.mut);
+        auto found = pool.index.find(value);
+        if (found != pool.index.end()) {
+            s = found->second;
+        } else {
+            pool.values.emplace_back(value);
+            s = &pool.values.back();
+            pool.index.emplace(*s, s);
+            pool.bytes += s->capacity() + 1;
         }
-        // fallback: if parsing failed, use old behavior
-        if (main_char.empty()) {
-            size_t comma = characters.find(',');
-            main_char = (comma == std::string::npos) ? characters : characters.substr(0, comma);
+    }
+    cache.emplace(*s, s);
+    return PooledString(s);
+}
+
+size_t PooledString::PoolSize() {
+    StringPool& pool = stringPool();
+    std::lock_guard<std::mutex> lock(pool.mut);
+    return pool.values.size();
+}
+size_t PooledString::PoolBytes() {
+    StringPool& pool = stringPool();
+    std::lock_guard<std::mutex> lock(pool.mut);
+    return pool.bytes;
+}
+
+// --- Decode one players row straight from SQLite's column buffers ---
+// The characters column looks like {"ultimate/fox": 12, ...}: the main
+// character is the text between the first '/' and the next '"'. Anything else
+// falls back to the text before the first ','.
+static std::string_view mainCharacterOf(const char* p, size_t n) {
+    const char* end = p + n;
+    if (const char* slash = static_cast<const char*>(std::memchr(p, '/', n))) {
+        const char* name = slash + 1;
+        const char* quote = static_cast<const char*>(std::memchr(name, '"', end - name));
+        if (quote && quote > name) return std::string_view(name, quote - name);
+    }
+    const char* comma = static_cast<const char*>(std::memchr(p, ',', n));
+    return std::string_view(p, comma ? comma - p : n);
+}
+
+// Returns false, leaving rec alone, for rows without characters. The strings
+// are assigned in place, so a reused record only allocates for a name longer
+// than any it held before; the main character is interned.
+static bool decodePlayerRow(sqlite3_stmt* stmt, PlayerRecord& rec) {
+    const char* chars = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+    int chars_len = sqlite3_column_bytes(stmt, 2);
+    if (!chars || chars_len == 0)
+        return false;
+    rec.main_character = PooledString::Intern(mainCharacterOf(chars, (size_t)chars_len));
+
+    char idbuf[24];
+    auto conv = std::to_chars(idbuf, idbuf + sizeof idbuf, sqlite3_column_int64(stmt, 0));
+    rec.id.assign(idbuf, conv.ptr);
+
+    const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+    if (name) rec.name.assign(name, (size_t)sqlite3_column_bytes(stmt, 1));
+    else      rec.name.clear();
+
+    rec.matches_played = -1;
+    rec.matches_won = -1;
+    rec.win_rate = -1.0;
+    rec.stats_loaded = false;
+    return true;
+}
+
+static sqlite3_stmt* preparePlayerScan(sqlite3* db, const RowidRange& range) {
+    sqlite3_stmt* stmt = prepare(db,
+        "SELECT player_id, tag, characters FROM players "
+        "WHERE rowid >= ?1 AND rowid < ?2;");
+    if (!stmt) return nullptr;
+    sqlite3_bind_int64(stmt, 1, range.lo);
+    sqlite3_bind_int64(stmt, 2, range.hi);
+    return stmt;
+}
+
+// Rows are decoded directly into out's last element, so each stored record is
+// built once rather than decoded into a temporary and copied
+static bool scanPlayers(const std::string& db_path, const RowidRange& range,
+                        std::vector<PlayerRecord>& out, LoadMonitor* monitor)
+{
+    sqlite3* db = openReadOnly(db_path);
+    if (!db) return false;
+    sqlite3_stmt* stmt = preparePlayerScan(db, range);
+    if (!stmt) { sqlite3_close(db); return false; }
+    out.reserve(std::min((size_t)(range.hi - range.lo), kMaxReserveRows));
+
+    int rc;
+    size_t batch = 0;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        Metrics_Add(METRIC_PLAYER_ROWS);
+        out.emplace_back();
+        if (!decodePlayerRow(stmt, out.back()))
+            out.pop_back();
+        if (monitor && ++batch == kProgressBatch) {
+            monitor->AddRows(batch);
+            batch = 0;
+            if (monitor->Cancelled()) break;
         }
-        rec.main_character = main_char;
+    }
+    if (monitor) monitor->AddRows(batch);
+    bool ok = (rc == SQLITE_ROW || rc == SQLITE_DONE);
+    if (!ok)
+        std::cerr << "sqlite3_step FAILED! Error code: " << rc << std::endl;
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return ok;
+}
+
+// --- Decode a game_data column: a JSON list of per-game objects ---
+// Only the fields the game indexes need are kept; anything else is skipped.
+// A malformed list contributes no games at all.
+namespace {
+struct JsonCursor {
+    const char* p;
+    const char* end;
+    void ws() { while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p; }
+    bool eat(char c) { ws(); if (p < end && *p == c) { ++p; return true; } return false; }
+    bool peek(char c) { ws(); return p < end && *p == c; }
+};
+
+void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += (char)cp;
+    } else if (cp < 0x800) {
+        out += (char)(0xC0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+bool readHex4(JsonCursor& c, uint32_t& v) {
+    if (c.end - c.p < 4) return false;
+    v = 0;
+    for (int i = 0; i < 4; ++i) {
+        char h = *c.p++;
+        v <<= 4;
+        if (h >= '0' && h <= '9') v |= h - '0';
+        else if (h >= 'a' && h <= 'f') v |= h - 'a' + 10;
+        else if (h >= 'A' && h <= 'F') v |= h - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
 
-        rec.matches_played = -1;
-        rec.matches_won = -1;
-        rec.win_rate = -1.0;
-        rec.stats_loaded = false;
+bool readString(JsonCursor& c, std::string& out) {
+    out.clear();
+    if (!c.eat('"')) return false;
+    while (c.p < c.end) {
+        char ch = *c.p++;
+        if (ch == '"') return true;
+        if (ch != '\\') { out += ch; continue; }
+        if (c.p >= c.end) return false;
+        switch (char e = *c.p++) {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            uint32_t cp;
+            if (!readHex4(c, cp)) return false;
+            if (cp >= 0xD800 && cp < 0xDC00 && c.end - c.p >= 6 && c.p[0] == '\\' && c.p[1] == 'u') {
+                uint32_t lo;
+                c.p += 2;
+                if (!readHex4(c, lo)) return false;
+                cp = (lo >= 0xDC00 && lo < 0xE000) ? 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00) : 0xFFFD;
+            } else if (cp >= 0xD800 && cp < 0xE000) {
+                cp = 0xFFFD;   // unpaired surrogate
+            }
+            appendUtf8(out, cp);
+            break;
+        }
+        default: out += e; break;
+        }
+    }
+    return false;
+}
 
-        hashOut.Insert(rec);
-        trieOut.Insert(rec);
+// Number, string holding a number, or null (0)
+bool readId(JsonCursor& c, long long& id, std::string& scratch) {
+    c.ws();
+    if (c.peek('"')) {
+        if (!readString(c, scratch)) return false;
+        id = std::strtoll(scratch.c_str(), nullptr, 10);
+        return true;
+    }
+    const char* start = c.p;
+    while (c.p < c.end && *c.p != ',' && *c.p != '}' && *c.p != ']' && *c.p != ' ') ++c.p;
+    if (c.p == start) return false;
+    id = (*start == '-' || (*start >= '0' && *start <= '9')) ? std::strtoll(start, nullptr, 10) : 0;
+    return true;
+}
 
-        ++rows_visited;
-        ++g_backendRowsVisited;
+// Any value we do not keep: strings, scalars, nested lists/objects
+bool skipValue(JsonCursor& c, std::string& scratch) {
+    c.ws();
+    if (c.peek('"')) return readString(c, scratch);
+    if (c.peek('[') || c.peek('{')) {
+        int depth = 0;
+        while (c.p < c.end) {
+            if (*c.p == '"') { if (!readString(c, scratch)) return false; continue; }
+            char ch = *c.p++;
+            if (ch == '[' || ch == '{') ++depth;
+            else if ((ch == ']' || ch == '}') && --depth == 0) return true;
+        }
+        return false;
     }
+    const char* start = c.p;
+    while (c.p < c.end && *c.p != ',' && *c.p != '}' && *c.p != ']') ++c.p;
+    return c.p != start;
+}
 
+// "ultimate/inkling" -> "inkling"
+void stripGamePrefix(std::string& name) {
+    size_t slash = name.rfind('/');
+    if (slash != std::string::npos) name.erase(0, slash + 1);
+}
+
+struct DecodedGame {
+    long long winner = 0;
+    long long loser = 0;
+    std::string winner_char, loser_char, stage;
+};
+} // namespace
+
+static bool decodeGameData(const char* text, size_t len, std::vector<DecodedGame>& out) {
+    out.clear();
+    JsonCursor c{text, text + len};
+    std::string key, scratch;
+    if (!c.eat('[')) return false;
+    if (c.eat(']')) return true;
+    do {
+        DecodedGame g;
+        if (!c.eat('{')) return false;
+        if (!c.eat('}')) {
+            do {
+                if (!readString(c, key) || !c.eat(':')) return false;
+                bool ok;
+                if (key == "winner_id")        ok = readId(c, g.winner, scratch);
+                else if (key == "loser_id")    ok = readId(c, g.loser, scratch);
+                else if (key == "winner_char") ok = c.peek('"') ? readString(c, g.winner_char) : skipValue(c, scratch);
+                else if (key == "loser_char")  ok = c.peek('"') ? readString(c, g.loser_char) : skipValue(c, scratch);
+                else if (key == "stage")       ok = c.peek('"') ? readString(c, g.stage) : skipValue(c, scratch);
+                else                           ok = skipValue(c, scratch);
+                if (!ok) return false;
+            } while (c.eat(','));
+            if (!c.eat('}')) return false;
+        }
+        stripGamePrefix(g.winner_char);
+        stripGamePrefix(g.loser_char);
+        out.push_back(std::move(g));
+    } while (c.eat(','));
+    return c.eat(']');
+}
+
+static bool scanSets(const std::string& db_path, const RowidRange& range,
+                     PlayerTallyMap& tallies, size_t& rows, LoadMonitor* monitor,
+                     std::vector<SetSummary>* sets, GameTable* games)
+{
+    sqlite3* db = openReadOnly(db_path);
+    if (!db) return false;
+    // game_data is by far the widest column; only read it when games are wanted
+    sqlite3_stmt* stmt = prepare(db, games
+        ? "SELECT p1_id, p2_id, winner_id, rowid, p1_score, p2_score, tournament_key, game_data "
+          "FROM sets WHERE rowid >= ?1 AND rowid < ?2;"
+        : "SELECT p1_id, p2_id, winner_id, rowid, p1_score, p2_score, tournament_key "
+          "FROM sets WHERE rowid >= ?1 AND rowid < ?2;");
+    if (!stmt) { sqlite3_close(db); return false; }
+    sqlite3_bind_int64(stmt, 1, range.lo);
+    sqlite3_bind_int64(stmt, 2, range.hi);
+
+    int rc;
+    size_t batch = 0;
+    std::vector<DecodedGame> decoded;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        ++rows;
+        Metrics_Add(METRIC_SET_ROWS);
+        if (monitor && ++batch == kProgressBatch) {
+            monitor->AddRows(batch);
+            batch = 0;
+            if (monitor->Cancelled()) break;
+        }
+        bool has_p1 = sqlite3_column_type(stmt, 0) != SQLITE_NULL;
+        bool has_p2 = sqlite3_column_type(stmt, 1) != SQLITE_NULL;
+        long long p1 = sqlite3_column_int64(stmt, 0);
+        long long p2 = sqlite3_column_int64(stmt, 1);
+        long long winner = sqlite3_column_int64(stmt, 2);
+
+        // Same semantics as the old per-player "p1_id = ?1 OR p2_id = ?1" count
+        if (has_p1) {
+            PlayerTally& t = tallies[p1];
+            ++t.played;
+            if (winner == p1) ++t.won;
+        }
+        if (has_p2 && !(has_p1 && p2 == p1)) {
+            PlayerTally& t = tallies[p2];
+            ++t.played;
+            if (winner == p2) ++t.won;
+        }
+
+        if (sets) {
+            SetSummary set;
+            set.rowid = sqlite3_column_int64(stmt, 3);
+            set.p1 = has_p1 ? p1 : 0;
+            set.p2 = has_p2 ? p2 : 0;
+            set.winner = winner;
+            set.p1_score = sqlite3_column_int(stmt, 4);
+            set.p2_score = sqlite3_column_int(stmt, 5);
+            const char* tkey = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
+            if (tkey) set.tournament = PooledString::Intern(std::string_view(tkey, sqlite3_column_bytes(stmt, 6)));
+            sets->push_back(std::move(set));
+        }
+
+        if (games) {
+            const char* data = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
+            if (data && decodeGameData(data, (size_t)sqlite3_column_bytes(stmt, 7), decoded)) {
+                Metrics_Add(METRIC_GAMES_DECODED, decoded.size());
+                for (const DecodedGame& g : decoded)
+                    games->AddGame({g.winner, g.loser, games->InternCharacter(g.winner_char),
+                                    games->InternCharacter(g.loser_char), games->InternStage(g.stage)});
+            }
+        }
+    }
+    if (monitor) monitor->AddRows(batch);
+    bool ok = (rc == SQLITE_ROW || rc == SQLITE_DONE);
+    if (!ok)
+        std::cerr << "sqlite3_step FAILED! Error code: " << rc << std::endl;
     sqlite3_finalize(stmt);
     sqlite3_close(db);
+    return ok;
+}
+
+static void applyTally(PlayerRecord& rec, const PlayerTallyMap& tallies) {
+    auto it = tallies.find(std::strtoll(rec.id.c_str(), nullptr, 10));
+    rec.matches_played = (it != tallies.end()) ? it->second.played : 0;
+    rec.matches_won    = (it != tallies.end()) ? it->second.won : 0;
+    rec.win_rate       = rec.matches_played ? 1.0 * rec.matches_won / rec.matches_played : 0.0;
+    rec.stats_loaded   = true;
+}
+// Adds rec's share of delta, if any, on top of its current totals
+static void addTally(PlayerRecord& rec, const PlayerTallyMap& delta) {
+    auto it = delta.find(std::strtoll(rec.id.c_str(), nullptr, 10));
+    if (it == delta.end()) return;
+    int played = rec.stats_loaded ? std::max(rec.matches_played, 0) : 0;
+    int won    = rec.stats_loaded ? std::max(rec.matches_won, 0) : 0;
+    rec.matches_played = played + it->second.played;
+    rec.matches_won    = won + it->second.won;
+    rec.win_rate       = rec.matches_played ? 1.0 * rec.matches_won / rec.matches_played : 0.0;
+    rec.stats_loaded   = true;
+}
+
+// --- ONLY load id, name, main_character ---
+// Either structure may be null; only the given ones are built. With tallies
+// non-null every record is indexed with its stats already applied.
+static bool loadAllPlayers(
+    const std::string& db_path,
+    PlayerHashTable* hashOut,
+    PlayerTrie* trieOut,
+    LoadMonitor* monitor,
+    HighWaterMarks* marks,
+    const PlayerTallyMap* tallies = nullptr)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<RowidRange> ranges;
+    if (!rowidPartitions(db_path, "players", Backend_GetLoaderThreads(), ranges))
+        return false;
+
+    if (monitor) monitor->BeginPhase("Reading players", rowidSpan(ranges));
+    std::vector<std::vector<PlayerRecord>> partials(ranges.size());
+    std::vector<char> ok(ranges.size(), 0);
+    runPartitions(ranges.size(), [&](size_t i) {
+        ok[i] = scanPlayers(db_path, ranges[i], partials[i], monitor);
+    });
+    for (char r : ok)
+        if (!r) return false;
+    if (monitor && monitor->Cancelled()) return false;
+
+    size_t decoded = 0;
+    for (const auto& part : partials) decoded += part.size();
+    if (monitor) monitor->BeginPhase("Indexing players", decoded);
+
+    if (hashOut) {
+        hashOut->Clear();
+        hashOut->Reserve(decoded);
+    }
+    if (trieOut) trieOut->Clear();
+
+    // Merge in rowid order so later duplicates win, as in a serial scan. Each
+    // partition is released once indexed, so peak memory stays near one copy.
+    size_t rows_visited = 0;
+    for (auto& part : partials) {
+        for (PlayerRecord& rec : part) {
+            if (tallies) applyTally(rec, *tallies);
+            // The last structure to take the decoded record moves it in
+            if (hashOut && trieOut) hashOut->Insert(rec);
+            else if (hashOut)       hashOut->Insert(std::move(rec));
+            if (trieOut)            trieOut->Insert(std::move(rec));
+            ++rows_visited;
+            if (monitor && rows_visited % kProgressBatch == 0)
+                monitor->AddRows(kProgressBatch);
+        }
+        std::vector<PlayerRecord>().swap(part);
+    }
+    if (hashOut) hashOut->Publish();
+    if (trieOut) trieOut->Publish();
+    if (marks) marks->players = ranges.empty() ? 0 : ranges.back().hi - 1;
+
+    Metrics_Add(METRIC_ROWS_VISITED, rows_visited);
+    recordLoadPass(rows_visited, start);
+    return true;
+}
+
+bool BackendDB_LoadAllPlayers(const std::string& db_path, PlayerHashTable& hash, PlayerTrie& trie,
+                              LoadMonitor* monitor, HighWaterMarks* marks) {
+    return loadAllPlayers(db_path, &hash, &trie, monitor, marks);
+}
+bool BackendDB_LoadAllPlayers(const std::string& db_path, PlayerHashTable& hash, LoadMonitor* monitor) {
+    return loadAllPlayers(db_path, &hash, nullptr, monitor, nullptr);
+}
+bool BackendDB_LoadAllPlayers(const std::string& db_path, PlayerTrie& trie, LoadMonitor* monitor) {
+    return loadAllPlayers(db_path, nullptr, &trie, monitor, nullptr);
+}
+
+// --- Read the sets in ranges, one partition per loader thread ---
+// Partial tallies are summed and the optional set/game outputs concatenated
+// in rowid order. Returns false on error or cancellation.
+static bool scanSetRanges(const std::string& db_path, const std::vector<RowidRange>& ranges,
+                          LoadMonitor* monitor, PlayerTallyMap& tallies, size_t& rows_visited,
+                          std::vector<SetSummary>* sets, GameTable* games)
+{
+    tallies.clear();
+    rows_visited = 0;
+    if (ranges.empty()) return true;
+
+    std::vector<PlayerTallyMap> partials(ranges.size());
+    std::vector<std::vector<SetSummary>> setParts(sets ? ranges.size() : 0);
+    std::vector<GameTable> gameParts(games ? ranges.size() : 0);
+    std::vector<size_t> rows(ranges.size(), 0);
+    std::vector<char> ok(ranges.size(), 0);
+    runPartitions(ranges.size(), [&](size_t i) {
+        ok[i] = scanSets(db_path, ranges[i], partials[i], rows[i], monitor,
+                         sets ? &setParts[i] : nullptr, games ? &gameParts[i] : nullptr);
+    });
+    for (char r : ok)
+        if (!r) return false;
+    if (monitor && monitor->Cancelled()) return false;
+
+    tallies = std::move(partials[0]);
+    rows_visited = rows[0];
+    for (size_t i = 1; i < partials.size(); ++i) {
+        for (const auto& kv : partials[i]) {
+            PlayerTally& t = tallies[kv.first];
+            t.played += kv.second.played;
+            t.won    += kv.second.won;
+        }
+        rows_visited += rows[i];
+    }
+    if (sets) {
+        sets->clear();
+        sets->reserve(rows_visited);
+        for (auto& part : setParts)
+            std::move(part.begin(), part.end(), std::back_inserter(*sets));
+    }
+    if (games) {
+        size_t total = 0;
+        for (const auto& part : gameParts) total += part.Games().size();
+        games->Clear();
+        games->Reserve(total);
+        for (const auto& part : gameParts) games->Append(part);
+    }
+    return true;
+}
 
+// --- Players and stats in one load ---
+// The sets are tallied before any player is indexed, so the records go in
+// with their totals and no loaded structure is staged a second time. Both
+// tables are read before anything is modified.
+static bool loadPlayersWithStats(
+    const std::string& db_path,
+    PlayerHashTable* hashOut,
+    PlayerTrie* trieOut,
+    LoadMonitor* monitor,
+    std::vector<SetSummary>* sets,
+    GameTable* games,
+    HighWaterMarks* marks)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<RowidRange> ranges;
+    if (!rowidPartitions(db_path, "sets", Backend_GetLoaderThreads(), ranges))
+        return false;
+
+    PlayerTallyMap tallies;
+    size_t set_rows = 0;
+    std::vector<SetSummary> setRows;
+    GameTable gameTable;
+    if (monitor) monitor->BeginPhase("Reading sets", rowidSpan(ranges));
+    if (!scanSetRanges(db_path, ranges, monitor, tallies, set_rows, sets ? &setRows : nullptr,
+                       games ? &gameTable : nullptr))
+        return false;
+    MetricBackend backend = !trieOut ? METRIC_HASH : !hashOut ? METRIC_TRIE : METRIC_HASH_AND_TRIE;
+    Metrics_RecordLatency(METRIC_OP_STATS_HYDRATION, backend, (uint64_t)
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+    if (!loadAllPlayers(db_path, hashOut, trieOut, monitor, marks, &tallies))
+        return false;
+    if (sets) sets->swap(setRows);
+    if (games) std::swap(*games, gameTable);
+    if (marks) marks->sets = ranges.empty() ? 0 : ranges.back().hi - 1;
+
+    Metrics_Add(METRIC_ROWS_VISITED, set_rows);
+    recordLoadPass(Backend_GetLastRowsScanned() + set_rows, start);
     return true;
 }
 
+bool BackendDB_LoadPlayersWithStats(const std::string& db_path, PlayerHashTable& hash, PlayerTrie& trie,
+                                    LoadMonitor* monitor, std::vector<SetSummary>* sets,
+                                    GameTable* games, HighWaterMarks* marks) {
+    return loadPlayersWithStats(db_path, &hash, &trie, monitor, sets, games, marks);
+}
+bool BackendDB_LoadPlayersWithStats(const std::string& db_path, PlayerHashTable& hash, LoadMonitor* monitor) {
+    return loadPlayersWithStats(db_path, &hash, nullptr, monitor, nullptr, nullptr, nullptr);
+}
+bool BackendDB_LoadPlayersWithStats(const std::string& db_path, PlayerTrie& trie, LoadMonitor* monitor) {
+    return loadPlayersWithStats(db_path, nullptr, &trie, monitor, nullptr, nullptr, nullptr);
+}
+
 // --- Load per-player stats data (call after players loaded) ---
+// Streams the sets table once, tallies played/won per player ID, then applies
+// the totals to both structures in one batch. With several loader threads each
+// one tallies its own rowid range and the partial maps are summed at the end.
 bool BackendDB_LoadPlayerStats(
     const std::string& db_path,
     PlayerHashTable& hash,
-    PlayerTrie& trie)
+    PlayerTrie& trie,
+    LoadMonitor* monitor,
+    std::vector<SetSummary>* sets,
+    GameTable* games,
+    HighWaterMarks* marks)
 {
-    std::vector<PlayerRecord> all_players = hash.GetFirstNRecords(100000);
+    auto start = std::chrono::steady_clock::now();
+    if (hash.Size() == 0 && trie.Size() == 0)
+        return false;
 
-    if (all_players.empty()) return false;
+    std::vector<RowidRange> ranges;
+    if (!rowidPartitions(db_path, "sets", Backend_GetLoaderThreads(), ranges))
+        return false;
 
-    sqlite3* db = nullptr;
-    int rc = sqlite3_open(db_path.c_str(), &db);
-    if (rc != SQLITE_OK || !db) {
-        std::cerr << "sqlite3_open FAILED! " << rc << std::endl;
-        if (db) sqlite3_close(db);
+    PlayerTallyMap tallies;
+    size_t stats_rows_visited = 0;
+    if (monitor) monitor->BeginPhase("Reading sets", rowidSpan(ranges));
+    if (!scanSetRanges(db_path, ranges, monitor, tallies, stats_rows_visited, sets, games))
         return false;
-    }
 
-    const char* query =
-        "SELECT "
-            "COUNT(s.key) AS matches_played, "
-            "SUM(CASE WHEN s.winner_id = ?1 THEN 1 ELSE 0 END) AS matches_won, "
-            "CASE WHEN COUNT(s.key) = 0 THEN 0 "
-                "ELSE 1.0 * SUM(CASE WHEN s.winner_id = ?1 THEN 1 ELSE 0 END) / COUNT(s.key) END AS win_rate "
-        "FROM sets s "
-        "WHERE (s.p1_id = ?1 OR s.p2_id = ?1);";
+    if (monitor) monitor->BeginPhase("Applying stats", tallies.size());
+    hash.ApplyStats(tallies);
+    trie.ApplyStats(tallies);
+    hash.Publish();
+    trie.Publish();
+    if (marks) marks->sets = ranges.empty() ? 0 : ranges.back().hi - 1;
 
-    sqlite3_stmt* stmt = nullptr;
-    rc = sqlite3_prepare_v2(db, query, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK || !stmt) {
-        std::cerr << "sqlite3_prepare_v2 FAILED! Code: " << rc << std::endl;
-        if (stmt) sqlite3_finalize(stmt);
-        sqlite3_close(db);
+    Metrics_Add(METRIC_ROWS_VISITED, stats_rows_visited);
+    recordLoadPass(stats_rows_visited, start);
+    Metrics_RecordLatency(METRIC_OP_STATS_HYDRATION, METRIC_HASH_AND_TRIE, (uint64_t)
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    return true;
+}
+
+// --- Incremental refresh: only rows past the high-water marks ---
+// Both tables are read before anything is modified, so a failed or cancelled
+// refresh leaves the structures and marks as they were.
+bool BackendDB_Refresh(
+    const std::string& db_path,
+    PlayerHashTable& hash,
+    PlayerTrie& trie,
+    HighWaterMarks& marks,
+    RefreshDelta& delta,
+    LoadMonitor* monitor)
+{
+    auto start = std::chrono::steady_clock::now();
+    delta.new_players = 0;
+    delta.sets.clear();
+    delta.games.Clear();
+    delta.players.clear();
+
+    unsigned threads = Backend_GetLoaderThreads();
+    std::vector<RowidRange> playerRanges, setRanges;
+    if (!rowidPartitions(db_path, "players", threads, playerRanges, marks.players + 1) ||
+        !rowidPartitions(db_path, "sets", threads, setRanges, marks.sets + 1))
         return false;
+
+    if (monitor) monitor->BeginPhase("Reading new players", rowidSpan(playerRanges));
+    std::vector<std::vector<PlayerRecord>> playerParts(playerRanges.size());
+    std::vector<char> ok(playerRanges.size(), 0);
+    runPartitions(playerRanges.size(), [&](size_t i) {
+        ok[i] = scanPlayers(db_path, playerRanges[i], playerParts[i], monitor);
+    });
+    for (char r : ok)
+        if (!r) return false;
+    if (monitor && monitor->Cancelled()) return false;
+
+    PlayerTallyMap tallies;
+    size_t set_rows = 0;
+    if (monitor) monitor->BeginPhase("Reading new sets", rowidSpan(setRanges));
+    if (!scanSetRanges(db_path, setRanges, monitor, tallies, set_rows, &delta.sets, &delta.games))
+        return false;
+
+    // New players start from zero; a re-added ID keeps the stats it had.
+    // The hash table finds the players the new sets involve by ID; the trie
+    // then takes the final record of every player changed, once each, after
+    // dropping the record a re-added ID had under its old tag.
+    if (monitor) monitor->BeginPhase("Applying new rows", tallies.size());
+    std::vector<UpdatedPlayer> changed;
+    std::unordered_map<size_t, std::string> oldTags;   // by row
+    {
+        RcuReadGuard guard;
+        for (auto& part : playerParts) {
+            for (PlayerRecord& rec : part) {
+                const PlayerRecord* old = hash.SearchByID(rec.id);
+                rec.matches_played = old && old->stats_loaded ? old->matches_played : 0;
+                rec.matches_won    = old && old->stats_loaded ? old->matches_won : 0;
+                rec.win_rate       = old && old->stats_loaded ? old->win_rate : 0.0;
+                rec.stats_loaded   = true;
+                size_t row = hash.Insert(rec);
+                if (old && old->name != rec.name) oldTags.emplace(row, old->name);
+                changed.push_back({row, std::move(rec)});
+                ++delta.new_players;
+            }
+        }
+    }
+    hash.AddStats(tallies, &changed);
+    // Later writes to a row come later in changed; keep the last of each
+    std::stable_sort(changed.begin(), changed.end(),
+                     [](const UpdatedPlayer& a, const UpdatedPlayer& b) { return a.row < b.row; });
+    delta.players.clear();
+    for (UpdatedPlayer& p : changed) {
+        if (!delta.players.empty() && delta.players.back().row == p.row) delta.players.back() = std::move(p);
+        else                                                             delta.players.push_back(std::move(p));
+    }
+    for (const UpdatedPlayer& p : delta.players) {
+        auto tag = oldTags.find(p.row);
+        if (tag != oldTags.end() && tag->second != p.record.name) trie.Erase(tag->second, p.record.id);
+        trie.Insert(p.record);
     }
+    hash.Publish();
+    trie.Publish();
+    if (!playerRanges.empty()) marks.players = playerRanges.back().hi - 1;
+    if (!setRanges.empty()) marks.sets = setRanges.back().hi - 1;
 
-    size_t stats_rows_visited = 0;
+    size_t rows_visited = delta.new_players + set_rows;
+    Metrics_Add(METRIC_ROWS_VISITED, rows_visited);
+    recordLoadPass(rows_visited, start);
+    return true;
+}
 
-    for (const PlayerRecord& original : all_players) {
-        rc = sqlite3_bind_text(stmt, 1, original.id.c_str(), -1, SQLITE_STATIC);
+// --- Row decode benchmark ---
+// The loader's player decoding before interning: every field copied through
+// a temporary std::string, then the record copied into the output
+namespace {
+struct LegacyPlayerRow {
+    std::string id;
+    std::string name;
+    std::string main_character;
+    int matches_played = -1;
+    int matches_won = -1;
+    double win_rate = -1.0;
+    bool stats_loaded = false;
+};
+}
 
-        rc = sqlite3_step(stmt);
-        if (rc == SQLITE_ROW) {
-            int matches_played = sqlite3_column_int(stmt, 0);
-            int matches_won    = sqlite3_column_int(stmt, 1);
-            double win_rate    = sqlite3_column_double(stmt, 2);
+static bool legacyDecodePlayerRow(sqlite3_stmt* stmt, LegacyPlayerRow& rec) {
+    int id_val = sqlite3_column_int(stmt, 0);
+    const unsigned char* col_name   = sqlite3_column_text(stmt, 1);
+    const unsigned char* col_chars  = sqlite3_column_text(stmt, 2);
 
-            PlayerRecord rec = original;
-            rec.matches_played = matches_played;
-            rec.matches_won    = matches_won;
-            rec.win_rate       = win_rate;
-            rec.stats_loaded   = true;
+    rec.id = std::to_string(id_val);
+    rec.name = (col_name != nullptr) ? reinterpret_cast<const char*>(col_name) : "";
+    std::string characters = (col_chars != nullptr) ? reinterpret_cast<const char*>(col_chars) : "";
 
-            hash.Insert(rec);
-            trie.Insert(rec);
-            
-            ++stats_rows_visited;
-            ++g_backendRowsVisited;
+    if (characters.empty())
+        return false;
+
+    std::string main_char = "";
+    auto slash = characters.find('/');
+    if (slash != std::string::npos) {
+        auto quote = characters.find('"', slash + 1);
+        if (quote != std::string::npos && quote > slash + 1) {
+            main_char = characters.substr(slash + 1, quote - slash - 1);
         }
-        sqlite3_reset(stmt);
-        sqlite3_clear_bindings(stmt);
     }
+    if (main_char.empty()) {
+        size_t comma = characters.find(',');
+        main_char = (comma == std::string::npos) ? characters : characters.substr(0, comma);
+    }
+    rec.main_character = main_char;
 
+    rec.matches_played = -1;
+    rec.matches_won = -1;
+    rec.win_rate = -1.0;
+    rec.stats_loaded = false;
+    return true;
+}
+
+static bool legacyScanPlayers(const std::string& db_path, const RowidRange& range,
+                              std::vector<LegacyPlayerRow>& out)
+{
+    sqlite3* db = openReadOnly(db_path);
+    if (!db) return false;
+    sqlite3_stmt* stmt = preparePlayerScan(db, range);
+    if (!stmt) { sqlite3_close(db); return false; }
+    int rc;
+    LegacyPlayerRow rec;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (legacyDecodePlayerRow(stmt, rec))
+            out.push_back(rec);
+    }
+    bool ok = (rc == SQLITE_ROW || rc == SQLITE_DONE);
     sqlite3_finalize(stmt);
     sqlite3_close(db);
+    return ok;
+}
 
+bool Backend_BenchmarkPlayerDecode(const std::string& db_path, bool legacy, DecodeBenchmark& out) {
+    out = DecodeBenchmark();
+    std::vector<RowidRange> ranges;
+    if (!rowidPartitions(db_path, "players", 1, ranges))
+        return false;
+    if (ranges.empty()) return true;
+
+    std::vector<PlayerRecord> records;
+    std::vector<LegacyPlayerRow> legacyRows;
+    size_t allocs = AllocStats_ThreadAllocations();
+    auto start = std::chrono::steady_clock::now();
+    bool ok = legacy ? legacyScanPlayers(db_path, ranges[0], legacyRows)
+                     : scanPlayers(db_path, ranges[0], records, nullptr);
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    allocs = AllocStats_ThreadAllocations() - allocs;
+    if (!ok) return false;
+
+    out.rows = legacy ? legacyRows.size() : records.size();
+    if (AllocStats_Counting()) out.allocs_per_row = out.rows ? (double)allocs / out.rows : 0.0;
+    out.rows_per_sec = secs.count() > 0 ? out.rows / secs.count() : 0.0;
     return true;
 }
 
+// --- GameTable ---
+uint16_t GameTable::intern(std::vector<std::string>& names, Dictionary& index, const std::string& name) {
+    auto it = index.find(name);
+    if (it != index.end()) return it->second;
+    if (names.size() >= kOtherCode) return kOtherCode;   // dictionary is full
+    uint16_t code = (uint16_t)names.size();
+    index.emplace(name, code);
+    names.push_back(name);
+    return code;
+}
+
+void GameTable::Clear() {
+    _games.clear();
+    _characters.clear();
+    _stages.clear();
+    _characterIndex.clear();
+    _stageIndex.clear();
+}
+
+void GameTable::Append(const GameTable& other) {
+    std::vector<uint16_t> charMap(other._characters.size()), stageMap(other._stages.size());
+    for (size_t i = 0; i < charMap.size(); ++i) charMap[i] = InternCharacter(other._characters[i]);
+    for (size_t i = 0; i < stageMap.size(); ++i) stageMap[i] = InternStage(other._stages[i]);
+    _games.reserve(_games.size() + other._games.size());
+    auto remap = [](const std::vector<uint16_t>& map, uint16_t code) {
+        return code == kOtherCode ? kOtherCode : map[code];
+    };
+    for (const Game& g : other._games)
+        _games.push_back({g.winner, g.loser, remap(charMap, g.winner_char), remap(charMap, g.loser_char),
+                          remap(stageMap, g.stage)});
+}
+
+int GameTable::CharacterCode(const std::string& name) const {
+    auto it = _characterIndex.find(name);
+    return it == _characterIndex.end() ? kUnknownCode : it->second;
+}
+
+int GameTable::StageCode(const std::string& name) const {
+    auto it = _stageIndex.find(name);
+    return it == _stageIndex.end() ? kUnknownCode : it->second;
+}
+
+size_t GameTable::MemoryUsageBytes() const {
+    size_t total = _games.capacity() * sizeof(Game);
+    for (const auto* names : {&_characters, &_stages})
+        for (const auto& n : *names) total += 2 * (sizeof(std::string) + n.capacity()) + 2 * sizeof(void*);
+    return total;
+}
+
 // --- PlayerHashTable ---
-PlayerHashTable::PlayerHashTable(size_t init_size) {
-    size_t sizepow2 = 1;
-    while (sizepow2 < init_size) sizepow2 <<= 1;
-    _mask = sizepow2 - 1;
-    _byName.resize(sizepow2);
-    _byID.resize(sizepow2);
-}
-void PlayerHashTable::Clear() { std::lock_guard<std::mutex> lock(mut_); for (auto &e: _byName) e.taken = false; for (auto &e: _byID)   e.taken = false; }
-size_t PlayerHashTable::hashString(const std::string& s) const { size_t hash = 0; for (char c : s) hash = hash * 31 + (unsigned char)c; return hash; }
-void PlayerHashTable::Insert(const PlayerRecord& rec) {
-    std::lock_guard<std::mutex> lock(mut_);
-    size_t h = hashString(rec.name) & _mask;
-    for (size_t i = 0; i < _byName.size(); ++i) {
-        size_t p = (h + i) & _mask;
-        if (!_byName[p].taken || _byName[p].data.name == rec.name) {
-            _byName[p].data = rec; _byName[p].taken = true; break;
-        }
-    }
-    h = hashString(rec.id) & _mask;
-    for (size_t i = 0; i < _byID.size(); ++i) {
-        size_t p = (h + i) & _mask;
-        if (!_byID[p].taken || _byID[p].data.id == rec.id) {
-            _byID[p].data = rec; _byID[p].taken = true; break;
-        }
-    }
-}
-const PlayerRecord* PlayerHashTable::SearchByName(const std::string& name) const {
-    std::lock_guard<std::mutex> lock(mut_);
-    size_t h = hashString(name) & _mask;
-    for (size_t i = 0; i < _byName.size(); ++i) {
-        size_t p = (h + i) & _mask;
-        if (!_byName[p].taken) return nullptr;
-        if (_byName[p].data.name == name) return &_byName[p].data;
+// Records live once in Table::records; the name and ID tables are Robin Hood
+// open-addressing arrays of {record index, fingerprint, probe distance}. A probe
+// only touches a record when the 16-bit fingerprint already matches, and stops
+// as soon as it meets a slot closer to its home than the key would be.
+// Writers work on the staged Table, readers on the published one (rcu.h); all
+// three arrays are paged, so the two share whatever the writer has not touched.
+
+// 64-bit string hash in the style of wyhash: 128-bit multiply-fold mixing,
+// reading 16 bytes per round.
+static inline uint64_t mulFold(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, la = (uint32_t)a, hb = b >> 32, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32); c += lo < t;
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+static inline uint64_t read64(const unsigned char* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+static inline uint64_t read32(const unsigned char* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+static uint64_t hashBytes(const char* data, size_t len) {
+    static const uint64_t s0 = 0xa0761d6478bd642full, s1 = 0xe7037ed1a0b428dbull;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    uint64_t seed = s0 ^ mulFold(s0 ^ s1, len);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t mid = (len >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + mid);
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - mid);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        while (i > 16) {
+            seed = mulFold(read64(p) ^ s1, read64(p + 8) ^ seed);
+            p += 16; i -= 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+    return mulFold(s1 ^ len, mulFold(a ^ s1, b ^ seed));
+}
+
+static size_t stringHeapBytes(const std::string& s) {
+    static const size_t sso = std::string().capacity();
+    return s.capacity() > sso ? s.capacity() + 1 : 0;
+}
+// main_character lives in the shared pool, not in the record
+static size_t recordHeapBytes(const PlayerRecord& r) {
+    return stringHeapBytes(r.id) + stringHeapBytes(r.name);
+}
+static size_t recordHeapAllocs(const PlayerRecord& r) {
+    return (stringHeapBytes(r.id) ? 1 : 0) + (stringHeapBytes(r.name) ? 1 : 0);
+}
+
+static size_t roundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+size_t PlayerHashTable::hashString(const std::string& s) { return (size_t)hashBytes(s.data(), s.size()); }
+static inline uint16_t fingerprint(size_t h) { return (uint16_t)((uint64_t)h >> 48); }
+
+size_t PlayerHashTable::heapBytes(const PlayerRecord& r) { return recordHeapBytes(r); }
+size_t PlayerHashTable::heapAllocs(const PlayerRecord& r) { return recordHeapAllocs(r); }
+
+// Pages hold a reference per version and per RecordPin. A page seen with one
+// reference belongs to the writer alone: everything that shared it has let
+// go, and nothing new can take it while the writer holds the staged table
+// (pins only take published pages).
+template <typename T, unsigned B>
+PlayerHashTable::PagedArray<T, B>::PagedArray(const PagedArray& other)
+    : _memory(other._memory), _pages(other._pages, other._memory), _size(other._size) {
+    for (Page* page : _pages) page->refs.fetch_add(1, std::memory_order_relaxed);
+}
+template <typename T, unsigned B>
+typename PlayerHashTable::PagedArray<T, B>::Page* PlayerHashTable::PagedArray<T, B>::newPage() {
+    return new (_memory->allocate(sizeof(Page), alignof(Page))) Page();
+}
+template <typename T, unsigned B>
+void PlayerHashTable::PagedArray<T, B>::drop(Page* page) {
+    if (page->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    _memory->RemoveExternal(page->heapBytes);
+    page->~Page();
+    _memory->deallocate(page, sizeof(Page), alignof(Page));
+}
+template <typename T, unsigned B>
+void PlayerHashTable::PagedArray<T, B>::track(Page* page, const T& item, bool add) {
+    size_t bytes = heapBytes(item);
+    if (add) {
+        _memory->AddExternal(bytes, heapAllocs(item));
+        page->heapBytes += bytes;
+    } else {
+        _memory->RemoveExternal(bytes);
+        page->heapBytes -= bytes;
+    }
+}
+// Copied strings size their payloads afresh, so a copied page recounts them
+template <typename T, unsigned B>
+typename PlayerHashTable::PagedArray<T, B>::Page* PlayerHashTable::PagedArray<T, B>::own(size_t page) {
+    Page* shared = _pages[page];
+    if (shared->refs.load(std::memory_order_acquire) == 1) return shared;
+    Page* copy = newPage();
+    for (size_t i = 0; i < kPageSize; ++i) {
+        copy->items[i] = shared->items[i];
+        track(copy, copy->items[i], true);
+    }
+    _pages[page] = copy;
+    drop(shared);
+    return copy;
+}
+template <typename T, unsigned B>
+void PlayerHashTable::PagedArray<T, B>::set(size_t i, T value) {
+    Page* page = own(i >> B);
+    T& item = page->items[i & (kPageSize - 1)];
+    track(page, item, false);
+    item = std::move(value);
+    track(page, item, true);
+}
+template <typename T, unsigned B>
+void PlayerHashTable::PagedArray<T, B>::push_back(T value) {
+    if ((_size & (kPageSize - 1)) == 0) _pages.push_back(newPage());
+    ++_size;
+    set(_size - 1, std::move(value));
+}
+template <typename T, unsigned B>
+void PlayerHashTable::PagedArray<T, B>::assign(size_t n, const T& value) {
+    clear();
+    _pages.reserve((n + kPageSize - 1) >> B);
+    for (size_t i = 0; i < n; i += kPageSize) {
+        Page* page = newPage();
+        for (T& item : page->items) {
+            item = value;
+            track(page, item, true);
+        }
+        _pages.push_back(page);
+    }
+    _size = n;
+}
+template <typename T, unsigned B>
+void PlayerHashTable::PagedArray<T, B>::clear() {
+    for (Page* page : _pages) drop(page);
+    _pages.clear();
+    _size = 0;
+}
+template <typename T, unsigned B>
+void PlayerHashTable::PagedArray<T, B>::swap(PagedArray& other) {
+    std::swap(_memory, other._memory);
+    _pages.swap(other._pages);
+    std::swap(_size, other._size);
+}
+
+PlayerHashTable::Table::Table(std::shared_ptr<TrackingResource> mem, size_t capacity)
+    : memory(std::move(mem)), records(memory.get()), byName(memory.get()), byID(memory.get()),
+      mask(capacity - 1) {
+    byName.assign(capacity, Slot());
+    byID.assign(capacity, Slot());
+}
+
+// Slot holding key, or npos. Robin Hood order lets a miss stop early.
+size_t PlayerHashTable::Table::find(const SlotArray& slots, const std::string& key,
+                                    std::string PlayerRecord::*field) const {
+    size_t h = hashString(key);
+    uint16_t fp = fingerprint(h);
+    size_t p = h & mask;
+    for (uint32_t d = 0; ; ++d, p = (p + 1) & mask) {
+        const Slot& slot = slots[p];
+        if (slot.index == kEmptySlot || slot.dist < d) return npos;
+        if (slot.fingerprint == fp && records[slot.index].*field == key) return p;
+    }
+}
+// First slot from p (at probe distance d) whose fingerprint matches, or npos
+size_t PlayerHashTable::Table::nextCandidate(const SlotArray& slots, size_t p, uint32_t d, uint16_t fp) const {
+    for (;; ++d, p = (p + 1) & mask) {
+        const Slot& slot = slots[p];
+        if (slot.index == kEmptySlot || slot.dist < d) return npos;
+        if (slot.fingerprint == fp) return p;
+    }
+}
+// Keys in flight per batch group: enough misses to overlap, few enough that
+// the prefetched lines are still cached when their probes run
+static const size_t kBatchGroup = 16;
+
+// find() for n keys, one group at a time, in three passes so each pass's
+// loads were prefetched by the one before: hash and prefetch the home slots,
+// walk to the first fingerprint match and prefetch its record, compare keys
+void PlayerHashTable::Table::findBatch(const SlotArray& slots, const std::string* keys, size_t n,
+                                       std::string PlayerRecord::*field, const PlayerRecord** out) const {
+    size_t hashes[kBatchGroup];
+    size_t cand[kBatchGroup];
+    for (size_t base = 0; base < n; base += kBatchGroup) {
+        const size_t m = std::min(kBatchGroup, n - base);
+        for (size_t i = 0; i < m; ++i) {
+            hashes[i] = hashString(keys[base + i]);
+            __builtin_prefetch(&slots[hashes[i] & mask]);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            cand[i] = nextCandidate(slots, hashes[i] & mask, 0, fingerprint(hashes[i]));
+            if (cand[i] != npos) __builtin_prefetch(&records[slots[cand[i]].index]);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            const std::string& key = keys[base + i];
+            const size_t home = hashes[i] & mask;
+            size_t p = cand[i];
+            // A fingerprint collision carries on down the chain
+            while (p != npos && records[slots[p].index].*field != key)
+                p = nextCandidate(slots, (p + 1) & mask, (uint32_t)((p - home) & mask) + 1, fingerprint(hashes[i]));
+            out[base + i] = (p == npos) ? nullptr : &records[slots[p].index];
+        }
+    }
+}
+// Robin Hood insert of a key known to be absent: take the slot of any entry
+// that is closer to its home than we are and carry that entry on instead.
+void PlayerHashTable::Table::place(SlotArray& slots, size_t h, uint32_t idx) {
+    Slot cur;
+    cur.index = idx;
+    cur.fingerprint = fingerprint(h);
+    cur.dist = 0;
+    size_t p = h & mask;
+    for (;; p = (p + 1) & mask, ++cur.dist) {
+        const Slot& slot = slots[p];
+        if (slot.index == kEmptySlot) { slots.mut(p) = cur; return; }
+        if (slot.dist < cur.dist) std::swap(slots.mut(p), cur);
+    }
+}
+// Backward-shift delete: pull the entries after p one slot closer to home
+// until one is already home, so no tombstones are left behind
+void PlayerHashTable::Table::erase(SlotArray& slots, size_t p) {
+    for (size_t next = (p + 1) & mask; ; p = next, next = (next + 1) & mask) {
+        const Slot& slot = slots[next];
+        if (slot.index == kEmptySlot || slot.dist == 0) { slots.set(p, Slot()); return; }
+        Slot moved = slot;
+        --moved.dist;
+        slots.set(p, moved);
+    }
+}
+void PlayerHashTable::Table::growFor(size_t entries, double max_load) {
+    size_t cap = byName.size();
+    if ((double)entries <= cap * max_load) return;
+    while ((double)entries > cap * max_load) cap <<= 1;
+    rehash(cap);
+}
+void PlayerHashTable::Table::rehash(size_t capacity) {
+    SlotArray oldName(memory.get()), oldID(memory.get());
+    oldName.assign(capacity, Slot());
+    oldID.assign(capacity, Slot());
+    oldName.swap(byName);
+    oldID.swap(byID);
+    mask = capacity - 1;
+    for (size_t i = 0; i < oldName.size(); ++i)
+        if (oldName[i].index != kEmptySlot) place(byName, hashString(records[oldName[i].index].name), oldName[i].index);
+    for (size_t i = 0; i < oldID.size(); ++i)
+        if (oldID[i].index != kEmptySlot) place(byID, hashString(records[oldID[i].index].id), oldID[i].index);
+}
+
+PlayerHashTable::PlayerHashTable(size_t init_size, double max_load_factor)
+    : _memory(std::make_shared<TrackingResource>()),
+      _initCapacity(roundUpPow2(init_size < 8 ? 8 : init_size)),
+      _table([this]() { return new Table(_memory, _initCapacity); }) {
+    SetMaxLoadFactor(max_load_factor);
+}
+void PlayerHashTable::Clear() {
+    std::lock_guard<std::mutex> lock(_table.WriteMutex());
+    _table.Fresh();
+}
+void PlayerHashTable::SetMaxLoadFactor(double lf) {
+    std::lock_guard<std::mutex> lock(_table.WriteMutex());
+    _maxLoad = (lf < 0.25) ? 0.25 : (lf > 0.95) ? 0.95 : lf;
+}
+void PlayerHashTable::Reserve(size_t n) {
+    std::lock_guard<std::mutex> lock(_table.WriteMutex());
+    Table& t = _table.Write();
+    t.records.reserve(n);
+    t.growFor(n, _maxLoad);
+}
+void PlayerHashTable::ApplyStats(const PlayerTallyMap& tallies) {
+    std::lock_guard<std::mutex> lock(_table.WriteMutex());
+    Table& t = _table.Write();
+    for (size_t i = 0; i < t.records.size(); ++i) applyTally(t.records.mut(i), tallies);
+}
+void PlayerHashTable::AddStats(const PlayerTallyMap& delta, std::vector<UpdatedPlayer>* updated) {
+    if (delta.empty()) return;
+    std::lock_guard<std::mutex> lock(_table.WriteMutex());
+    Table& t = _table.Write();
+    // One ID probe per affected player instead of a pass over every record;
+    // only the pages holding those players are copied
+    std::string id;
+    for (const auto& kv : delta) {
+        id = std::to_string(kv.first);
+        size_t pos = t.find(t.byID, id, &PlayerRecord::id);
+        if (pos == npos) continue;
+        size_t row = t.byID[pos].index;
+        PlayerRecord& rec = t.records.mut(row);
+        addTally(rec, delta);
+        if (updated) updated->push_back({row, rec});
+    }
+}
+void PlayerHashTable::Publish() {
+    std::lock_guard<std::mutex> lock(_table.WriteMutex());
+    _table.Publish();
+}
+size_t PlayerHashTable::Insert(PlayerRecord rec) {
+    std::lock_guard<std::mutex> lock(_table.WriteMutex());
+    Table& t = _table.Write();
+    t.growFor(std::max(t.nameCount, t.idCount) + 1, _maxLoad);
+    size_t pid   = t.find(t.byID, rec.id, &PlayerRecord::id);
+    const bool retagged = pid != npos && t.records[t.byID[pid].index].name != rec.name;
+    // A known ID under a new tag gives up its old tag's slot, unless another
+    // player has taken that tag since
+    if (retagged) {
+        size_t old = t.find(t.byName, t.records[t.byID[pid].index].name, &PlayerRecord::name);
+        if (old != npos && t.byName[old].index == t.byID[pid].index) {
+            t.erase(t.byName, old);
+            --t.nameCount;
+        }
+    }
+    size_t pname = t.find(t.byName, rec.name, &PlayerRecord::name);
+    size_t hid   = pid == npos ? hashString(rec.id) : 0;
+    size_t hname = pname == npos ? hashString(rec.name) : 0;
+
+    // A known ID is updated in place; anything else gets a new record
+    uint32_t idx;
+    if (pid != npos) {
+        idx = t.byID[pid].index;
+        t.records.set(idx, std::move(rec));
+    } else {
+        idx = (uint32_t)t.records.size();
+        t.records.push_back(std::move(rec));
+        t.place(t.byID, hid, idx);
+        ++t.idCount;
+    }
+    // A tag shared with other players goes to the one inserted last; a known
+    // ID keeping its tag keeps its standing, as in the trie's chains
+    if (pname != npos) {
+        if (pid == npos || retagged) t.byName.mut(pname).index = idx;
+    } else {
+        t.place(t.byName, hname, idx);
+        ++t.nameCount;
+    }
+    return idx;
+}
+// The records of t, sharing its pages; later versions copy a page before
+// writing to it, so the pinned ones stay as they are
+RecordPin PlayerHashTable::pinRecords(const Table& t) {
+    struct Pinned {
+        Pinned(const Table& t) : memory(t.memory), records(t.records) {}
+        std::shared_ptr<TrackingResource> memory;   // outlives the pages
+        RecordArray records;
+    };
+    return std::make_shared<const Pinned>(t);
+}
+const PlayerRecord* PlayerHashTable::SearchByName(const std::string& name, RecordPin* pin) const {
+    RcuReadGuard guard;
+    const Table* t = _table.Read();
+    size_t p = t->find(t->byName, name, &PlayerRecord::name);
+    if (p == npos) return nullptr;
+    if (pin) *pin = pinRecords(*t);
+    return &t->records[t->byName[p].index];
+}
+const PlayerRecord* PlayerHashTable::SearchByID(const std::string& id, RecordPin* pin) const {
+    RcuReadGuard guard;
+    const Table* t = _table.Read();
+    size_t p = t->find(t->byID, id, &PlayerRecord::id);
+    if (p == npos) return nullptr;
+    if (pin) *pin = pinRecords(*t);
+    return &t->records[t->byID[p].index];
+}
+std::vector<const PlayerRecord*> PlayerHashTable::SearchByNames(const std::vector<std::string>& names) const {
+    RcuReadGuard guard;
+    const Table* t = _table.Read();
+    std::vector<const PlayerRecord*> out(names.size());
+    t->findBatch(t->byName, names.data(), names.size(), &PlayerRecord::name, out.data());
+    return out;
+}
+std::vector<const PlayerRecord*> PlayerHashTable::SearchByIDs(const std::vector<std::string>& ids) const {
+    RcuReadGuard guard;
+    const Table* t = _table.Read();
+    std::vector<const PlayerRecord*> out(ids.size());
+    t->findBatch(t->byID, ids.data(), ids.size(), &PlayerRecord::id, out.data());
+    return out;
+}
+// records holds one entry per ID; the name table can hold fewer, as players
+// who share a tag share its slot
+void PlayerHashTable::ForEachRecord(const std::function<void(const PlayerRecord&)>& fn) const {
+    RcuReadGuard guard;
+    const Table* t = _table.Read();
+    for (size_t i = 0; i < t->records.size(); ++i) fn(t->records[i]);
+}
+void PlayerHashTable::ForEachRecordUntil(const std::function<bool(const PlayerRecord&)>& fn, RecordPin* pin) const {
+    RcuReadGuard guard;
+    const Table* t = _table.Read();
+    if (pin) *pin = pinRecords(*t);
+    for (size_t i = 0; i < t->records.size(); ++i)
+        if (!fn(t->records[i])) return;
+}
+size_t PlayerHashTable::Size() const {
+    RcuReadGuard guard;
+    return _table.Read()->idCount;
+}
+std::vector<PlayerRecord> PlayerHashTable::GetFirstNRecords(size_t n) const {
+    RcuReadGuard guard;
+    const Table* t = _table.Read();
+    std::vector<PlayerRecord> out;
+    n = std::min(n, t->records.size());
+    out.reserve(n);
+    for (size_t i = 0; i < n; ++i) out.push_back(t->records[i]);
+    return out;
+}
+void PlayerHashTable::ExportSlots(std::vector<PlayerRecord>& records,
+                                  std::vector<uint32_t>& byName, std::vector<uint32_t>& byID) const {
+    RcuReadGuard guard;
+    const Table* t = _table.Read();
+    records.clear();
+    records.reserve(t->records.size());
+    for (size_t i = 0; i < t->records.size(); ++i) records.push_back(t->records[i]);
+    byName.resize(t->byName.size());
+    byID.resize(t->byID.size());
+    for (size_t i = 0; i < t->byName.size(); ++i) byName[i] = t->byName[i].index;
+    for (size_t i = 0; i < t->byID.size(); ++i)   byID[i]   = t->byID[i].index;
+}
+bool PlayerHashTable::ImportSlots(std::vector<PlayerRecord> records,
+                                  const uint32_t* byName, const uint32_t* byID, size_t capacity) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) return false;
+    std::lock_guard<std::mutex> lock(_table.WriteMutex());
+    Table& t = _table.Fresh();
+    t.byName.assign(capacity, Slot());
+    t.byID.assign(capacity, Slot());
+    t.mask = capacity - 1;
+    t.records.reserve(records.size());
+    for (PlayerRecord& rec : records) t.records.push_back(std::move(rec));
+    // Slots keep their exported positions; fingerprint and distance follow from the hash
+    auto restore = [&t](Slot& slot, size_t pos, uint32_t idx, const std::string& key) {
+        size_t h = hashString(key);
+        slot.index = idx;
+        slot.fingerprint = fingerprint(h);
+        slot.dist = (uint16_t)((pos - (h & t.mask)) & t.mask);
+    };
+    for (size_t i = 0; i < capacity; ++i) {
+        if (byName[i] < t.records.size()) { restore(t.byName.mut(i), i, byName[i], t.records[byName[i]].name); ++t.nameCount; }
+        if (byID[i] < t.records.size())   { restore(t.byID.mut(i), i, byID[i], t.records[byID[i]].id); ++t.idCount; }
+    }
+    return true;
+}
+PlayerHashTable::ProbeStats PlayerHashTable::GetProbeStats() const {
+    RcuReadGuard guard;
+    const Table* t = _table.Read();
+    ProbeStats st;
+    st.capacity = t->byName.size();
+    size_t total = 0;
+    for (const auto* slots : {&t->byName, &t->byID}) {
+        for (size_t i = 0; i < slots->size(); ++i) {
+            const Slot& s = (*slots)[i];
+            if (s.index == kEmptySlot) continue;
+            ++st.entries;
+            total += s.dist;
+            st.max_probe = std::max<size_t>(st.max_probe, s.dist);
+        }
+    }
+    st.load_factor = st.capacity ? (double)std::max(t->nameCount, t->idCount) / st.capacity : 0.0;
+    st.avg_probe = st.entries ? (double)total / st.entries : 0.0;
+    return st;
+}
+size_t PlayerHashTable::MemoryUsageBytes() const { return _memory->Stats().live_bytes; }
+MemoryStats PlayerHashTable::GetMemoryStats() const { return _memory->Stats(); }
+size_t PlayerHashTable::LegacyLayoutBytes() const {
+    // Previous layout: two fixed 131072-slot tables of {PlayerRecord, bool taken}
+    struct LegacyEntry { PlayerRecord data; bool taken; };
+    RcuReadGuard guard;
+    const Table* t = _table.Read();
+    size_t total = 2 * 131072 * sizeof(LegacyEntry);
+    for (size_t i = 0; i < t->records.size(); ++i) total += 2 * recordHeapBytes(t->records[i]);
+    return total;
+}
+
+// --- PlayerTrie (adaptive radix tree) ---
+// Inner nodes grow 4 -> 16 -> 48 -> 256 children as they fill, and every node
+// carries the compressed path leading to it, so a chain of single-child bytes
+// costs one node. Keys are raw bytes: UTF-8 tags are stored as they are.
+// The records whose key ends at a node hang off its rec pointer, newest first,
+// as players can share a tag; leaves are header-only nodes holding the rest
+// of the key as their prefix.
+// Inner nodes also cache the best kTopKCached records of their subtree for
+// each ranking, rebuilt bottom-up whenever a staged tree is published.
+//
+// Nodes the published tree can reach are never written. A staged version
+// copies each node on an insert's path before changing it (its parent is
+// then staged too, so it can be relinked) and marks the copy staged. Publish
+// re-ranks only staged nodes, reaching them through staged parents, and
+// clears the marks. Records are immutable once stored.
+enum ArtNodeType : uint8_t { ART_LEAF, ART_NODE4, ART_NODE16, ART_NODE48, ART_NODE256 };
+static const uint32_t kArtInlinePrefix = 8;
+static const unsigned kTopKCached = 10;
+static const unsigned kRankKinds = 2;
+
+struct ArtTopK {
+    uint8_t size[kRankKinds];
+    const PlayerRecord* best[kRankKinds][kTopKCached];
+};
+
+// A stored player and the next older one with the same tag
+struct ArtRecord {
+    PlayerRecord player;
+    ArtRecord* older;
+};
+
+struct ArtNode {
+    uint8_t type;
+    uint8_t staged;             // written by the staged version since the last publish
+    uint16_t count;             // children in use
+    uint32_t prefix_len;
+    union {
+        unsigned char bytes[kArtInlinePrefix];
+        unsigned char* heap;    // prefixes longer than kArtInlinePrefix
+    } prefix;
+    ArtRecord* rec;
+    ArtTopK* top;               // inner nodes only; null until the first publish
+};
+struct ArtNode4   : ArtNode { unsigned char keys[4];  ArtNode* child[4]; };
+struct ArtNode16  : ArtNode { unsigned char keys[16]; ArtNode* child[16]; };
+struct ArtNode48  : ArtNode { unsigned char index[256]; ArtNode* child[48]; };   // index: slot + 1, 0 if absent
+struct ArtNode256 : ArtNode { ArtNode* child[256]; };
+
+static const unsigned char* artPrefix(const ArtNode* n) {
+    return n->prefix_len <= kArtInlinePrefix ? n->prefix.bytes : n->prefix.heap;
+}
+// A load's versions share one arena, drawn from the trie's TrackingResource;
+// only the writer allocates from it. Nodes, long prefixes and top-k lists
+// are bump-allocated from it in build order and never freed one by one:
+// shells left behind when a staged node grows, and the nodes and top-k lists
+// a publish replaced once no reader can reach them, are kept on free lists
+// for reuse. Replaced records stay, as pinned rows may point at them, until
+// they outnumber the live ones and Publish moves the tree to a fresh arena;
+// the old arena goes when the last version or pin using it is dropped.
+// Records sit in a chunked array in the arena, so teardown destroys them in
+// one linear pass instead of walking the tree. Record strings still use the
+// global heap and are reported as external bytes.
+struct ArtFreeShell { ArtFreeShell* next; };
+static const size_t kArtArenaInitialBytes = 64 * 1024;
+
+struct ArtArena {
+    explicit ArtArena(TrackingResource& tracker)
+        : tracker(tracker), pool(kArtArenaInitialBytes, &tracker), records(&pool) {}
+    ~ArtArena() { tracker.RemoveExternal(stringBytes); }
+    ArtArena(const ArtArena&) = delete;
+    ArtArena& operator=(const ArtArena&) = delete;
+    TrackingResource& tracker;
+    std::pmr::monotonic_buffer_resource pool;
+    std::pmr::deque<ArtRecord> records;   // stable addresses; destroyed before pool
+    ArtFreeShell* freeShells[ART_NODE256 + 1] = {};
+    ArtFreeShell* freeTops = nullptr;
+    size_t staleRecords = 0;   // replaced or erased since the arena was filled
+    size_t stringBytes = 0;
+    // Nodes replaced by a publish, handed back once the version before it is
+    // freed: filled by whichever thread frees it, drained by the writer
+    std::mutex retiredMut;
+    std::vector<ArtNode*> retiredNodes;
+};
+
+template <typename T, typename... Args>
+static T* artNew(ArtArena& a, Args&&... args) {
+    return new (a.pool.allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+static ArtRecord* artNewRecord(ArtArena& a, PlayerRecord&& rec, ArtRecord* older) {
+    a.records.push_back({std::move(rec), older});
+    const PlayerRecord& stored = a.records.back().player;
+    a.tracker.AddExternal(recordHeapBytes(stored), recordHeapAllocs(stored));
+    a.stringBytes += recordHeapBytes(stored);
+    return &a.records.back();
+}
+// Counts the records from r down to same as replaced
+static void artRetireChain(ArtArena& a, const ArtRecord* r, const ArtRecord* same) {
+    for (;; r = r->older) {
+        ++a.staleRecords;
+        if (r == same) return;
+    }
+}
+// Copies a whole chain, keeping its order, with tallies (if any) applied to the copies
+static ArtRecord* artCopyChain(ArtArena& a, const ArtRecord* r, const PlayerTallyMap* tallies) {
+    if (!r) return nullptr;
+    ArtRecord* older = artCopyChain(a, r->older, tallies);
+    PlayerRecord copy = r->player;
+    if (tallies) applyTally(copy, *tallies);
+    return artNewRecord(a, std::move(copy), older);
+}
+// The chain from r with rec in place of same: the records newer than same
+// are copied, the older ones shared
+static ArtRecord* artReplaceInChain(ArtArena& a, const ArtRecord* r, const ArtRecord* same, PlayerRecord&& rec) {
+    if (r == same) return artNewRecord(a, std::move(rec), same->older);
+    ArtRecord* older = artReplaceInChain(a, r->older, same, std::move(rec));
+    return artNewRecord(a, PlayerRecord(r->player), older);
+}
+// The chain from r without same: the records newer than same are copied,
+// the older ones shared
+static ArtRecord* artRemoveFromChain(ArtArena& a, const ArtRecord* r, const ArtRecord* same) {
+    if (r == same) return same->older;
+    ArtRecord* older = artRemoveFromChain(a, r->older, same);
+    return artNewRecord(a, PlayerRecord(r->player), older);
+}
+// Calls fn on every player of a chain, oldest first
+template <typename Fn>
+static void artForEachInChain(const ArtRecord* r, Fn fn) {
+    if (!r) return;
+    artForEachInChain(r->older, fn);
+    fn(&r->player);
+}
+
+// p may point into n's own prefix. A replaced heap prefix stays in the arena.
+static void artSetPrefix(ArtArena& a, ArtNode* n, const unsigned char* p, size_t len) {
+    unsigned char inline_copy[kArtInlinePrefix];
+    unsigned char* heap = nullptr;
+    if (len > kArtInlinePrefix) {
+        heap = static_cast<unsigned char*>(a.pool.allocate(len, 1));
+        std::memcpy(heap, p, len);
+    } else if (len) {
+        std::memcpy(inline_copy, p, len);
+    }
+    n->prefix_len = (uint32_t)len;
+    if (heap) n->prefix.heap = heap;
+    else if (len) std::memcpy(n->prefix.bytes, inline_copy, len);
+}
+// Reuses a shell of the same type if one was left by a grow
+template <typename T>
+static T* artNodeFrom(ArtArena& a, uint8_t type) {
+    if (ArtFreeShell* shell = a.freeShells[type]) {
+        a.freeShells[type] = shell->next;
+        return new (shell) T();
+    }
+    return artNew<T>(a);
+}
+static ArtNode* artNewNode(ArtArena& a, uint8_t type) {
+    ArtNode* n = nullptr;
+    switch (type) {
+        case ART_LEAF:    n = artNodeFrom<ArtNode>(a, type); break;
+        case ART_NODE4:   n = artNodeFrom<ArtNode4>(a, type); break;
+        case ART_NODE16:  n = artNodeFrom<ArtNode16>(a, type); break;
+        case ART_NODE48:  n = artNodeFrom<ArtNode48>(a, type); break;
+        default:          n = artNodeFrom<ArtNode256>(a, type); break;
+    }
+    n->type = type;
+    n->staged = 1;
+    return n;
+}
+// Staged copy of a node the published tree can see. The prefix bytes are
+// shared: a staged node's prefix is replaced, never written through.
+static ArtNode* artCopyNode(ArtArena& a, const ArtNode* n) {
+    ArtNode* copy = artNewNode(a, n->type);
+    switch (n->type) {
+        case ART_LEAF:    *copy = *n; break;
+        case ART_NODE4:   *static_cast<ArtNode4*>(copy) = *static_cast<const ArtNode4*>(n); break;
+        case ART_NODE16:  *static_cast<ArtNode16*>(copy) = *static_cast<const ArtNode16*>(n); break;
+        case ART_NODE48:  *static_cast<ArtNode48*>(copy) = *static_cast<const ArtNode48*>(n); break;
+        default:          *static_cast<ArtNode256*>(copy) = *static_cast<const ArtNode256*>(n); break;
+    }
+    copy->staged = 1;
+    copy->top = nullptr;   // rebuilt on publish
+    return copy;
+}
+// Returns the node itself for reuse; prefix, record and children are left alone
+static void artDeleteShell(ArtArena& a, ArtNode* n) {
+    uint8_t type = n->type;
+    a.freeShells[type] = new (n) ArtFreeShell{a.freeShells[type]};
+}
+static ArtTopK* artNewTopK(ArtArena& a) {
+    if (ArtFreeShell* shell = a.freeTops) {
+        a.freeTops = shell->next;
+        return new (shell) ArtTopK();
+    }
+    return artNew<ArtTopK>(a);
+}
+// Puts the nodes of versions no reader can reach any more, and their top-k
+// lists, on the free lists. Their long prefixes may be shared with the
+// copies that replaced them and are left alone.
+static void artReuseRetired(ArtArena& a) {
+    std::vector<ArtNode*> nodes;
+    {
+        std::lock_guard<std::mutex> lock(a.retiredMut);
+        nodes.swap(a.retiredNodes);
+    }
+    for (ArtNode* n : nodes) {
+        if (n->top) a.freeTops = new (n->top) ArtFreeShell{a.freeTops};
+        artDeleteShell(a, n);
+    }
+}
+static ArtNode* artMakeLeaf(ArtArena& a, const unsigned char* suffix, size_t len, PlayerRecord&& rec) {
+    ArtNode* leaf = artNewNode(a, ART_LEAF);
+    artSetPrefix(a, leaf, suffix, len);
+    leaf->rec = artNewRecord(a, std::move(rec), nullptr);
+    return leaf;
+}
+
+static ArtNode* const* artFindChild(const ArtNode* n, unsigned char b) {
+    switch (n->type) {
+        case ART_NODE4: {
+            auto* n4 = static_cast<const ArtNode4*>(n);
+            for (unsigned i = 0; i < n4->count; ++i)
+                if (n4->keys[i] == b) return &n4->child[i];
+            return nullptr;
+        }
+        case ART_NODE16: {
+            auto* n16 = static_cast<const ArtNode16*>(n);
+#ifdef __SSE2__
+            __m128i eq = _mm_cmpeq_epi8(_mm_set1_epi8((char)b),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(n16->keys)));
+            unsigned mask = (unsigned)_mm_movemask_epi8(eq) & ((1u << n16->count) - 1);
+            return mask ? &n16->child[__builtin_ctz(mask)] : nullptr;
+#else
+            for (unsigned i = 0; i < n16->count; ++i)
+                if (n16->keys[i] == b) return &n16->child[i];
+            return nullptr;
+#endif
+        }
+        case ART_NODE48: {
+            auto* n48 = static_cast<const ArtNode48*>(n);
+            return n48->index[b] ? &n48->child[n48->index[b] - 1] : nullptr;
+        }
+        case ART_NODE256: {
+            auto* n256 = static_cast<const ArtNode256*>(n);
+            return n256->child[b] ? &n256->child[b] : nullptr;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+// Calls fn on every child in ascending byte order
+template <typename Fn>
+static void artForEachChild(const ArtNode* n, Fn fn) {
+    switch (n->type) {
+        case ART_NODE4: {
+            auto* n4 = static_cast<const ArtNode4*>(n);
+            for (unsigned i = 0; i < n4->count; ++i) fn(n4->child[i]);
+            break;
+        }
+        case ART_NODE16: {
+            auto* n16 = static_cast<const ArtNode16*>(n);
+            for (unsigned i = 0; i < n16->count; ++i) fn(n16->child[i]);
+            break;
+        }
+        case ART_NODE48: {
+            auto* n48 = static_cast<const ArtNode48*>(n);
+            for (unsigned b = 0; b < 256; ++b)
+                if (n48->index[b]) fn(n48->child[n48->index[b] - 1]);
+            break;
+        }
+        case ART_NODE256: {
+            auto* n256 = static_cast<const ArtNode256*>(n);
+            for (unsigned b = 0; b < 256; ++b)
+                if (n256->child[b]) fn(n256->child[b]);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Moves n into the next larger node type; the header (prefix, record) moves with it
+static ArtNode* artGrow(ArtArena& a, ArtNode* n) {
+    ArtNode* big = artNewNode(a, n->type == ART_LEAF ? ART_NODE4 : n->type + 1);
+    uint8_t type = big->type;
+    static_cast<ArtNode&>(*big) = static_cast<const ArtNode&>(*n);
+    big->type = type;
+    switch (n->type) {
+        case ART_NODE4: {
+            auto* from = static_cast<ArtNode4*>(n);
+            auto* to = static_cast<ArtNode16*>(big);
+            std::memcpy(to->keys, from->keys, from->count);
+            std::memcpy(to->child, from->child, from->count * sizeof(ArtNode*));
+            break;
+        }
+        case ART_NODE16: {
+            auto* from = static_cast<ArtNode16*>(n);
+            auto* to = static_cast<ArtNode48*>(big);
+            for (unsigned i = 0; i < from->count; ++i) {
+                to->index[from->keys[i]] = (unsigned char)(i + 1);
+                to->child[i] = from->child[i];
+            }
+            break;
+        }
+        case ART_NODE48: {
+            auto* from = static_cast<ArtNode48*>(n);
+            auto* to = static_cast<ArtNode256*>(big);
+            for (unsigned b = 0; b < 256; ++b)
+                if (from->index[b]) to->child[b] = from->child[from->index[b] - 1];
+            break;
+        }
+        default:
+            break;
+    }
+    artDeleteShell(a, n);
+    return big;
+}
+
+// ref points at n's slot in its parent; it is updated when n has to grow
+static void artAddChild(ArtArena& a, ArtNode*& ref, unsigned char b, ArtNode* child) {
+    ArtNode* n = ref;
+    static const unsigned kCapacity[] = {0, 4, 16, 48, 256};
+    if (n->count == kCapacity[n->type]) ref = n = artGrow(a, n);
+    switch (n->type) {
+        case ART_NODE4:
+        case ART_NODE16: {
+            // Keys stay sorted so children are visited in byte order
+            unsigned char* keys = (n->type == ART_NODE4) ? static_cast<ArtNode4*>(n)->keys : static_cast<ArtNode16*>(n)->keys;
+            ArtNode** kids = (n->type == ART_NODE4) ? static_cast<ArtNode4*>(n)->child : static_cast<ArtNode16*>(n)->child;
+            unsigned pos = 0;
+            while (pos < n->count && keys[pos] < b) ++pos;
+            std::memmove(keys + pos + 1, keys + pos, n->count - pos);
+            std::memmove(kids + pos + 1, kids + pos, (n->count - pos) * sizeof(ArtNode*));
+            keys[pos] = b;
+            kids[pos] = child;
+            break;
+        }
+        case ART_NODE48: {
+            auto* n48 = static_cast<ArtNode48*>(n);
+            n48->child[n->count] = child;   // nodes never shrink, so slots fill in order
+            n48->index[b] = (unsigned char)(n->count + 1);
+            break;
+        }
+        default:
+            static_cast<ArtNode256*>(n)->child[b] = child;
+            break;
+    }
+    ++n->count;
+}
+
+// Depth-first, so the copy's nodes and records are laid out in key order.
+// Every node of the copy is staged and every record has tallies, if given, applied.
+static ArtNode* artClone(ArtArena& a, const ArtNode* n, const PlayerTallyMap* tallies) {
+    ArtNode* copy;
+    switch (n->type) {
+        case ART_LEAF:    copy = artNew<ArtNode>(a, *n); break;
+        case ART_NODE4:   copy = artNew<ArtNode4>(a, *static_cast<const ArtNode4*>(n)); break;
+        case ART_NODE16:  copy = artNew<ArtNode16>(a, *static_cast<const ArtNode16*>(n)); break;
+        case ART_NODE48:  copy = artNew<ArtNode48>(a, *static_cast<const ArtNode48*>(n)); break;
+        default:          copy = artNew<ArtNode256>(a, *static_cast<const ArtNode256*>(n)); break;
+    }
+    if (n->prefix_len > kArtInlinePrefix) {
+        copy->prefix.heap = static_cast<unsigned char*>(a.pool.allocate(n->prefix_len, 1));
+        std::memcpy(copy->prefix.heap, n->prefix.heap, n->prefix_len);
+    }
+    copy->rec = artCopyChain(a, n->rec, tallies);
+    copy->staged = 1;
+    copy->top = nullptr;   // refers to the source's records; rebuilt on publish
+    // Replace the shallow-copied child pointers with deep copies
+    ArtNode** kids = nullptr;
+    unsigned slots = copy->count;
+    switch (copy->type) {
+        case ART_NODE4:   kids = static_cast<ArtNode4*>(copy)->child; break;
+        case ART_NODE16:  kids = static_cast<ArtNode16*>(copy)->child; break;
+        case ART_NODE48:  kids = static_cast<ArtNode48*>(copy)->child; break;
+        case ART_NODE256: kids = static_cast<ArtNode256*>(copy)->child; slots = 256; break;
+        default: break;
+    }
+    for (unsigned i = 0; i < slots; ++i)
+        if (kids[i]) kids[i] = artClone(a, kids[i], tallies);
+    return copy;
+}
+
+static void artCollect(const ArtNode* n, std::vector<const PlayerRecord*>& out, size_t limit) {
+    if (out.size() >= limit) return;
+    artForEachInChain(n->rec, [&out](const PlayerRecord* r) { out.push_back(r); });
+    artForEachChild(n, [&](const ArtNode* c) { artCollect(c, out, limit); });
+}
+
+// Node whose subtree holds exactly the keys starting with prefix, or null
+static const ArtNode* artFindPrefix(const ArtNode* n, const std::string& prefix) {
+    const unsigned char* key = reinterpret_cast<const unsigned char*>(prefix.data());
+    const size_t len = prefix.size();
+    size_t depth = 0;
+    while (n) {
+        size_t plen = n->prefix_len, rest = len - depth;
+        if (std::memcmp(artPrefix(n), key + depth, std::min(plen, rest)) != 0) return nullptr;
+        if (rest <= plen) return n;
+        depth += plen;
+        ArtNode* const* child = artFindChild(n, key[depth]);
+        if (!child) return nullptr;
+        n = *child;
+        ++depth;
+    }
+    return nullptr;
+}
+
+// Descending by the ranked field, then by matches played, then by name
+static bool rankedBefore(const PlayerRecord* a, const PlayerRecord* b, PlayerRankBy by) {
+    if (by == RANK_BY_WIN_RATE && a->win_rate != b->win_rate) return a->win_rate > b->win_rate;
+    if (a->matches_played != b->matches_played) return a->matches_played > b->matches_played;
+    return a->name < b->name;
+}
+
+// n is staged. Lists of nodes the published tree shares are still right, so
+// only staged children are descended into.
+static void artRebuildTopK(ArtArena& a, ArtNode* n) {
+    n->staged = 0;
+    if (n->type == ART_LEAF) return;   // a leaf's list is its own record
+    artForEachChild(n, [&a](ArtNode* c) { if (c->staged) artRebuildTopK(a, c); });
+    if (!n->top) n->top = artNewTopK(a);
+    std::vector<const PlayerRecord*> cand;
+    for (unsigned by = 0; by < kRankKinds; ++by) {
+        cand.clear();
+        auto take = [&cand](const PlayerRecord* r) { cand.push_back(r); };
+        artForEachInChain(n->rec, take);
+        artForEachChild(n, [&cand, &take, by](const ArtNode* c) {
+            if (c->type == ART_LEAF) artForEachInChain(c->rec, take);
+            else cand.insert(cand.end(), c->top->best[by], c->top->best[by] + c->top->size[by]);
+        });
+        size_t keep = std::min<size_t>(cand.size(), kTopKCached);
+        std::partial_sort(cand.begin(), cand.begin() + keep, cand.end(),
+            [by](const PlayerRecord* a, const PlayerRecord* b) { return rankedBefore(a, b, (PlayerRankBy)by); });
+        std::copy(cand.begin(), cand.begin() + keep, n->top->best[by]);
+        n->top->size[by] = (uint8_t)keep;
+    }
+}
+
+PlayerTrie::Tree::Tree(std::shared_ptr<TrackingResource> mem)
+    : memory(std::move(mem)), arena(std::make_shared<ArtArena>(*memory)), root(nullptr) {}
+PlayerTrie::Tree::Tree(const Tree& other)
+    : memory(other.memory), arena(other.arena), root(other.root), count(other.count) {}
+// Records are destroyed in one pass, then the arena goes back in bulk
+PlayerTrie::Tree::~Tree() {}
+
+PlayerTrie::PlayerTrie()
+    : _memory(std::make_shared<TrackingResource>()),
+      _tree([this]() { return new Tree(_memory); }) {}
+PlayerTrie::~PlayerTrie() {}
+void PlayerTrie::Clear() {
+    std::lock_guard<std::mutex> lock(_tree.WriteMutex());
+    _tree.Fresh();
+}
+void PlayerTrie::Publish() {
+    std::lock_guard<std::mutex> lock(_tree.WriteMutex());
+    if (!_tree.Dirty()) return;
+    Tree& tree = _tree.Write();
+    artReuseRetired(*tree.arena);
+    // Once replaced records outnumber live ones, copy the tree into a fresh
+    // arena; the old one goes with the last version or pin using it
+    if (tree.root && tree.arena->staleRecords > tree.count) {
+        auto arena = std::make_shared<ArtArena>(*tree.memory);
+        tree.root = artClone(*arena, tree.root, nullptr);
+        tree.arena = std::move(arena);
+        tree.replaced.clear();
+    }
+    if (tree.root && tree.root->staged) artRebuildTopK(*tree.arena, tree.root);
+
+    // Readers of the version being replaced may still walk its nodes: they
+    // return to the free lists only once that version is freed
+    struct Replaced {
+        std::shared_ptr<TrackingResource> memory;   // outlives the arena
+        std::shared_ptr<ArtArena> arena;
+        std::vector<ArtNode*> nodes;
+    };
+    auto replaced = std::make_shared<Replaced>();
+    replaced->memory = tree.memory;
+    replaced->arena = tree.arena;
+    replaced->nodes.swap(tree.replaced);
+    _tree.Publish();
+    if (!replaced->nodes.empty()) {
+        Rcu_Retire([replaced]() {
+            std::lock_guard<std::mutex> lock(replaced->arena->retiredMut);
+            ArtArena& a = *replaced->arena;
+            a.retiredNodes.insert(a.retiredNodes.end(), replaced->nodes.begin(), replaced->nodes.end());
+        });
+    }
+}
+void PlayerTrie::Insert(PlayerRecord rec) {
+    std::lock_guard<std::mutex> lock(_tree.WriteMutex());
+    // key points into rec.name: read what is needed before rec is moved from
+    const unsigned char* key = reinterpret_cast<const unsigned char*>(rec.name.data());
+    const size_t len = rec.name.size();
+    Tree& tree = _tree.Write();
+    ArtArena& a = *tree.arena;
+    ArtNode** ref = &tree.root;
+    size_t depth = 0;
+    for (;;) {
+        ArtNode* n = *ref;
+        if (!n) {
+            *ref = artMakeLeaf(a, key + depth, len - depth, std::move(rec));
+            ++tree.count;
+            return;
+        }
+        // Every node on the path changes, if only to point at a copied child
+        if (!n->staged) {
+            tree.replaced.push_back(n);
+            *ref = n = artCopyNode(a, n);
+        }
+        const unsigned char* pre = artPrefix(n);
+        size_t plen = n->prefix_len, m = 0;
+        while (m < plen && depth + m < len && pre[m] == key[depth + m]) ++m;
+        if (m < plen) {
+            // Key leaves the compressed path part way: split it at the first mismatch
+            ArtNode* split = artNewNode(a, ART_NODE4);
+            artSetPrefix(a, split, pre, m);
+            unsigned char nb = pre[m];
+            artSetPrefix(a, n, pre + m + 1, plen - m - 1);
+            artAddChild(a, split, nb, n);
+            if (depth + m == len) {
+                split->rec = artNewRecord(a, std::move(rec), nullptr);
+            } else {
+                unsigned char kb = key[depth + m];
+                artAddChild(a, split, kb, artMakeLeaf(a, key + depth + m + 1, len - depth - m - 1, std::move(rec)));
+            }
+            *ref = split;
+            ++tree.count;
+            return;
+        }
+        depth += plen;
+        if (depth == len) {
+            // A known ID gets a new record in its place; another player with
+            // this tag joins the chain
+            ArtRecord* same = n->rec;
+            while (same && same->player.id != rec.id) same = same->older;
+            if (same) {
+                artRetireChain(a, n->rec, same);
+                n->rec = artReplaceInChain(a, n->rec, same, std::move(rec));
+            } else {
+                n->rec = artNewRecord(a, std::move(rec), n->rec);
+                ++tree.count;
+            }
+            return;
+        }
+        ArtNode* const* child = artFindChild(n, key[depth]);
+        if (!child) {
+            unsigned char kb = key[depth];
+            artAddChild(a, *ref, kb, artMakeLeaf(a, key + depth + 1, len - depth - 1, std::move(rec)));
+            ++tree.count;
+            return;
+        }
+        ref = const_cast<ArtNode**>(child);
+        ++depth;
+    }
+}
+// Record of id stored under exactly key, or null
+static const ArtRecord* artFindRecord(const ArtNode* n, const unsigned char* key, size_t len, const std::string& id) {
+    size_t depth = 0;
+    while (n) {
+        size_t plen = n->prefix_len;
+        if (len - depth < plen || std::memcmp(artPrefix(n), key + depth, plen) != 0) return nullptr;
+        depth += plen;
+        if (depth == len) {
+            const ArtRecord* r = n->rec;
+            while (r && r->player.id != id) r = r->older;
+            return r;
+        }
+        ArtNode* const* child = artFindChild(n, key[depth]);
+        if (!child) return nullptr;
+        n = *child;
+        ++depth;
     }
     return nullptr;
 }
-const PlayerRecord* PlayerHashTable::SearchByID(const std::string& id) const {
-    std::lock_guard<std::mutex> lock(mut_);
-    size_t h = hashString(id) & _mask;
-    for (size_t i = 0; i < _byID.size(); ++i) {
-        size_t p = (h + i) & _mask;
-        if (!_byID[p].taken) return nullptr;
-        if (_byID[p].data.id == id) return &_byID[p].data;
+// Nodes never shrink: a node whose chain empties stays on the path with no
+// record, and the next Insert of its key fills it again
+bool PlayerTrie::Erase(const std::string& name, const std::string& id) {
+    std::lock_guard<std::mutex> lock(_tree.WriteMutex());
+    const unsigned char* key = reinterpret_cast<const unsigned char*>(name.data());
+    const size_t len = name.size();
+    Tree& tree = _tree.Write();
+    // Look first, so a miss copies no nodes
+    const ArtRecord* same = artFindRecord(tree.root, key, len, id);
+    if (!same) return false;
+    ArtArena& a = *tree.arena;
+    ArtNode** ref = &tree.root;
+    size_t depth = 0;
+    for (;;) {
+        ArtNode* n = *ref;
+        if (!n->staged) {
+            tree.replaced.push_back(n);
+            *ref = n = artCopyNode(a, n);
+        }
+        depth += n->prefix_len;
+        if (depth == len) {
+            artRetireChain(a, n->rec, same);
+            n->rec = artRemoveFromChain(a, n->rec, same);
+            --tree.count;
+            return true;
+        }
+        ref = const_cast<ArtNode**>(artFindChild(n, key[depth]));
+        ++depth;
+    }
+}
+// Records live in the arena until the last version using it is gone, and a
+// stored record is never written again
+RecordPin PlayerTrie::pinRecords(const Tree& t) {
+    struct Pinned {
+        Pinned(const Tree& t) : memory(t.memory), arena(t.arena) {}
+        std::shared_ptr<TrackingResource> memory;   // outlives the arena
+        std::shared_ptr<ArtArena> arena;
+    };
+    return std::make_shared<const Pinned>(t);
+}
+const PlayerRecord* PlayerTrie::SearchExact(const std::string& name, RecordPin* pin) const {
+    RcuReadGuard guard;
+    const unsigned char* key = reinterpret_cast<const unsigned char*>(name.data());
+    const size_t len = name.size();
+    const Tree* t = _tree.Read();
+    const ArtNode* n = t->root;
+    size_t depth = 0;
+    while (n) {
+        size_t plen = n->prefix_len;
+        if (len - depth < plen || std::memcmp(artPrefix(n), key + depth, plen) != 0) return nullptr;
+        depth += plen;
+        if (depth == len) {
+            if (!n->rec) return nullptr;
+            if (pin) *pin = pinRecords(*t);
+            return &n->rec->player;
+        }
+        ArtNode* const* child = artFindChild(n, key[depth]);
+        if (!child) return nullptr;
+        n = *child;
+        ++depth;
     }
     return nullptr;
 }
-std::vector<PlayerRecord> PlayerHashTable::GetFirstNRecords(size_t n) const {
-    std::lock_guard<std::mutex> lock(mut_);
-    std::vector<PlayerRecord> result;
-    for (const auto& entry : _byName) {
-        if (entry.taken) {
-            result.push_back(entry.data);
-            if (result.size() >= n) break;
+std::vector<const PlayerRecord*> PlayerTrie::SearchExactBatch(const std::vector<std::string>& names) const {
+    RcuReadGuard guard;
+    std::vector<const PlayerRecord*> out(names.size(), nullptr);
+    const ArtNode* root = _tree.Read()->root;
+    if (!root) return out;
+    struct Cursor {
+        const ArtNode* n;   // null once the key is resolved
+        size_t depth;
+    };
+    Cursor cur[kBatchGroup];
+    for (size_t base = 0; base < names.size(); base += kBatchGroup) {
+        const size_t m = std::min(kBatchGroup, names.size() - base);
+        for (size_t i = 0; i < m; ++i) cur[i] = {root, 0};
+        // The steps of SearchExact, but every key takes one per round
+        for (size_t live = m; live > 0; ) {
+            live = 0;
+            for (size_t i = 0; i < m; ++i) {
+                const ArtNode* n = cur[i].n;
+                if (!n) continue;
+                const std::string& name = names[base + i];
+                const unsigned char* key = reinterpret_cast<const unsigned char*>(name.data());
+                size_t depth = cur[i].depth;
+                size_t plen = n->prefix_len;
+                cur[i].n = nullptr;
+                if (name.size() - depth < plen || std::memcmp(artPrefix(n), key + depth, plen) != 0) continue;
+                depth += plen;
+                if (depth == name.size()) {
+                    if (n->rec) out[base + i] = &n->rec->player;
+                    continue;
+                }
+                ArtNode* const* child = artFindChild(n, key[depth]);
+                if (!child) continue;
+                __builtin_prefetch(*child);
+                cur[i] = {*child, depth + 1};
+                ++live;
+            }
         }
     }
-    return result;
+    return out;
 }
-size_t PlayerHashTable::MemoryUsageBytes() const {
-    std::lock_guard<std::mutex> lock(mut_);
-    return _byName.size() * sizeof(Entry) + _byID.size() * sizeof(Entry);
+std::vector<const PlayerRecord*> PlayerTrie::SearchByPrefix(const std::string& prefix) const {
+    RcuReadGuard guard;
+    std::vector<const PlayerRecord*> out;
+    if (const ArtNode* n = artFindPrefix(_tree.Read()->root, prefix))
+        artCollect(n, out, (size_t)-1);
+    return out;
+}
+std::vector<const PlayerRecord*> PlayerTrie::TopKByPrefix(const std::string& prefix, size_t k, PlayerRankBy rank_by) const {
+    RcuReadGuard guard;
+    std::vector<const PlayerRecord*> out;
+    const ArtNode* n = artFindPrefix(_tree.Read()->root, prefix);
+    if (!n || k == 0) return out;
+    if (k <= kTopKCached && n->top) {
+        out.assign(n->top->best[rank_by], n->top->best[rank_by] + std::min<size_t>(k, n->top->size[rank_by]));
+    } else {
+        // Deeper than the cached lists: rank the whole subtree
+        artCollect(n, out, (size_t)-1);
+        size_t keep = std::min(k, out.size());
+        std::partial_sort(out.begin(), out.begin() + keep, out.end(),
+            [rank_by](const PlayerRecord* a, const PlayerRecord* b) { return rankedBefore(a, b, rank_by); });
+        out.resize(keep);
+    }
+    return out;
+}
+// The published tree keeps the old arena until it is reclaimed
+void PlayerTrie::ApplyStats(const PlayerTallyMap& tallies) {
+    std::lock_guard<std::mutex> lock(_tree.WriteMutex());
+    Tree& tree = _tree.Write();
+    auto arena = std::make_shared<ArtArena>(*tree.memory);
+    tree.root = tree.root ? artClone(*arena, tree.root, &tallies) : nullptr;
+    tree.arena = std::move(arena);
+    tree.replaced.clear();   // in the old arena, which goes as a whole
+}
+static void artVisit(const ArtNode* n, const std::function<void(const PlayerRecord&)>& fn) {
+    artForEachInChain(n->rec, [&fn](const PlayerRecord* r) { fn(*r); });
+    artForEachChild(n, [&fn](const ArtNode* c) { artVisit(c, fn); });
 }
+// As artVisit, until fn returns false; returns whether it never did
+static bool artVisitUntil(const ArtNode* n, const std::function<bool(const PlayerRecord&)>& fn) {
+    bool more = true;
+    artForEachInChain(n->rec, [&](const PlayerRecord* r) { if (more) more = fn(*r); });
+    artForEachChild(n, [&](const ArtNode* c) { if (more) more = artVisitUntil(c, fn); });
+    return more;
+}
+void PlayerTrie::ForEachRecord(const std::function<void(const PlayerRecord&)>& fn) const {
+    RcuReadGuard guard;
+    if (const ArtNode* root = _tree.Read()->root) artVisit(root, fn);
+}
+void PlayerTrie::ForEachRecordUntil(const std::function<bool(const PlayerRecord&)>& fn, RecordPin* pin) const {
+    RcuReadGuard guard;
+    const Tree* t = _tree.Read();
+    if (pin) *pin = pinRecords(*t);
+    if (t->root) artVisitUntil(t->root, fn);
+}
+size_t PlayerTrie::Size() const {
+    RcuReadGuard guard;
+    return _tree.Read()->count;
+}
+// Records in key order
+std::vector<const PlayerRecord*> PlayerTrie::GetFirstNRecords(size_t n) const {
+    RcuReadGuard guard;
+    std::vector<const PlayerRecord*> result;
+    if (const ArtNode* root = _tree.Read()->root) artCollect(root, result, n);
+    if (result.size() > n) result.resize(n);
+    return result;
+}
+size_t PlayerTrie::MemoryUsageBytes() const { return _memory->Stats().live_bytes; }
+MemoryStats PlayerTrie::GetMemoryStats() const { return _memory->Stats(); }
 
-// --- PlayerTrie ---
-PlayerTrie::PlayerTrie() { root = new Node(); }
-PlayerTrie::~PlayerTrie() { free(root); }
-void PlayerTrie::Clear()  { std::lock_guard<std::mutex> lock(mut_); free(root); root = new Node(); }
-void PlayerTrie::Insert(const PlayerRecord& rec) {
-    std::lock_guard<std::mutex> lock(mut_);
+// --- LegacyPlayerTrie ---
+LegacyPlayerTrie::LegacyPlayerTrie() { root = new Node(); }
+LegacyPlayerTrie::~LegacyPlayerTrie() { free(root); }
+void LegacyPlayerTrie::Insert(const PlayerRecord& rec) {
     Node* node = root;
     for (char c : rec.name) {
         unsigned idx = (unsigned char)c;
@@ -248,8 +2240,7 @@ void PlayerTrie::Insert(const PlayerRecord& rec) {
     }
     node->rec = std::make_unique<PlayerRecord>(rec);
 }
-const PlayerRecord* PlayerTrie::SearchExact(const std::string& name) const {
-    std::lock_guard<std::mutex> lock(mut_);
+const PlayerRecord* LegacyPlayerTrie::SearchExact(const std::string& name) const {
     const Node* node = root;
     for (char c : name) {
         unsigned idx = (unsigned char)c;
@@ -259,14 +2250,12 @@ const PlayerRecord* PlayerTrie::SearchExact(const std::string& name) const {
     }
     return node->rec ? node->rec.get() : nullptr;
 }
-void PlayerTrie::prefixSearch(Node* n, std::vector<const PlayerRecord*>& out) const {
-    if (!n) return;
+void LegacyPlayerTrie::prefixSearch(const Node* n, std::vector<const PlayerRecord*>& out) {
     if (n->rec) out.push_back(n->rec.get());
     for (int i = 0; i < 128; ++i)
         if (n->next[i]) prefixSearch(n->next[i], out);
 }
-std::vector<const PlayerRecord*> PlayerTrie::SearchByPrefix(const std::string& prefix) const {
-    std::lock_guard<std::mutex> lock(mut_);
+std::vector<const PlayerRecord*> LegacyPlayerTrie::SearchByPrefix(const std::string& prefix) const {
     std::vector<const PlayerRecord*> out;
     const Node* node = root;
     for (char c : prefix) {
@@ -274,36 +2263,21 @@ std::vector<const PlayerRecord*> PlayerTrie::SearchByPrefix(const std::string& p
         if (idx >= 128 || !node->next[idx]) return out;
         node = node->next[idx];
     }
-    prefixSearch(const_cast<Node*>(node), out);
+    prefixSearch(node, out);
     return out;
 }
-void PlayerTrie::free(Node* n) {
+void LegacyPlayerTrie::free(Node* n) {
     if (!n) return;
     for (int i=0; i<128; ++i)
         if (n->next[i]) free(n->next[i]);
     delete n;
 }
-std::vector<const PlayerRecord*> PlayerTrie::GetFirstNRecords(size_t n) const {
-    std::lock_guard<std::mutex> lock(mut_);
-    std::vector<const PlayerRecord*> result;
-    std::queue<const Node*> nodes;
-    nodes.push(root);
-    while (!nodes.empty() && result.size() < n) {
-        const Node* current = nodes.front();
-        nodes.pop();
-        if (current->rec) result.push_back(current->rec.get());
-        for (int i = 0; i < 128; ++i)
-            if (current->next[i]) nodes.push(current->next[i]);
-    }
-    return result;
-}
-size_t PlayerTrie::MemoryUsageBytes() const {
-    std::lock_guard<std::mutex> lock(mut_);
+size_t LegacyPlayerTrie::MemoryUsageBytes() const {
     size_t total = 0;
-    std::queue<Node*> nodes;
+    std::queue<const Node*> nodes;
     nodes.push(root);
     while (!nodes.empty()) {
-        Node* n = nodes.front(); nodes.pop();
+        const Node* n = nodes.front(); nodes.pop();
         total += sizeof(Node);
         if (n->rec) total += sizeof(PlayerRecord);
         for (int i=0; i<128; ++i)
@@ -4,60 +4,466 @@
 #include <memory>
 #include <mutex>
 #include <atomic>
+#include <unordered_map>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <memory_resource>
+#include "rcu.h"
+#include "allocstats.h"
 
-// --- Added for row counter ---
-extern std::atomic<size_t> g_backendRowsVisited;
+// --- Rows indexed or applied by every loader pass so far (see metrics.h) ---
 size_t Backend_GetTotalRowsVisited();
 
+// --- Rows scanned / wall time of the most recent loader pass ---
+size_t Backend_GetLastRowsScanned();
+double Backend_GetLastLoadMillis();
+
+// --- Loader threads: players/sets are split into this many rowid ranges ---
+void Backend_SetLoaderThreads(unsigned threads);
+unsigned Backend_GetLoaderThreads();
+
+// Handle to a string kept once in a process-wide pool that is never freed:
+// copies are a pointer copy and equal values share one address. For fields
+// whose values repeat across many rows: main characters, tournament keys.
+class PooledString {
+public:
+    PooledString();
+    // Lock-free for values this thread has interned before
+    static PooledString Intern(std::string_view value);
+    const std::string& str() const { return *_s; }
+    operator const std::string&() const { return *_s; }
+    const char* c_str() const { return _s->c_str(); }
+    size_t size() const { return _s->size(); }
+    bool empty() const { return _s->empty(); }
+    bool operator==(const PooledString& o) const { return _s == o._s; }
+    bool operator!=(const PooledString& o) const { return _s != o._s; }
+    // Distinct values and their bytes across the whole pool
+    static size_t PoolSize();
+    static size_t PoolBytes();
+private:
+    explicit PooledString(const std::string* s) : _s(s) {}
+    const std::string* _s;
+};
+
 struct PlayerRecord {
     std::string id;
     std::string name;
-    std::string main_character;
+    PooledString main_character;
     int matches_played = -1;
     int matches_won = -1;
     double win_rate = -1.0;
     bool stats_loaded = false;
 };
 
+// Per-player set totals accumulated by the stats loader, keyed by numeric player ID
+struct PlayerTally {
+    int played = 0;
+    int won = 0;
+};
+using PlayerTallyMap = std::unordered_map<long long, PlayerTally>;
+
+// Keeps the records of one published version alive, and unchanged, once the
+// read-side section that found them has ended, for results that hold record
+// pointers across events. Only that version's records are kept; everything
+// else is reclaimed as usual.
+using RecordPin = std::shared_ptr<const void>;
+
+// One row of the sets table as kept for the set-level indexes (player IDs
+// are 0 when the column is NULL)
+struct SetSummary {
+    long long rowid = 0;
+    long long p1 = 0;
+    long long p2 = 0;
+    long long winner = 0;
+    int p1_score = 0;
+    int p2_score = 0;
+    PooledString tournament;
+};
+
+// Every game decoded from the sets' game_data column. Character and stage
+// names are dictionary-coded: a game stores 16-bit codes into Characters()
+// and Stages(). Characters are stored without the "ultimate/" prefix, as in
+// PlayerRecord::main_character.
+class GameTable {
+public:
+    struct Game {
+        long long winner;
+        long long loser;
+        uint16_t winner_char;
+        uint16_t loser_char;
+        uint16_t stage;
+    };
+    static const int kUnknownCode = -1;
+    // Code of names that did not fit in a full dictionary; never a real name
+    static const uint16_t kOtherCode = 0xFFFF;
+
+    void Clear();
+    void Reserve(size_t games) { _games.reserve(games); }
+    // Past 65535 distinct names, new names get kOtherCode
+    uint16_t InternCharacter(const std::string& name) { return intern(_characters, _characterIndex, name); }
+    uint16_t InternStage(const std::string& name) { return intern(_stages, _stageIndex, name); }
+    void AddGame(const Game& game) { _games.push_back(game); }
+    // Appends other's games, remapping its codes into this table's dictionaries
+    void Append(const GameTable& other);
+
+    const std::vector<Game>& Games() const { return _games; }
+    const std::vector<std::string>& Characters() const { return _characters; }
+    const std::vector<std::string>& Stages() const { return _stages; }
+    int CharacterCode(const std::string& name) const;   // kUnknownCode if absent
+    int StageCode(const std::string& name) const;
+    size_t MemoryUsageBytes() const;
+private:
+    using Dictionary = std::unordered_map<std::string, uint16_t>;
+    static uint16_t intern(std::vector<std::string>& names, Dictionary& index, const std::string& name);
+    std::vector<Game> _games;
+    std::vector<std::string> _characters;
+    std::vector<std::string> _stages;
+    Dictionary _characterIndex;
+    Dictionary _stageIndex;
+};
+
+// --- Progress reporting / cancellation shared between a loader and its caller ---
+struct LoadProgress {
+    std::string phase;
+    size_t rows = 0;          // rows processed so far in this phase
+    size_t total = 0;         // expected rows for this phase, 0 if unknown
+    double rows_per_sec = 0.0;
+};
+
+class LoadMonitor {
+public:
+    using Callback = std::function<void(const LoadProgress&)>;
+    // cb is invoked from loader threads, at most once per interval_ms
+    explicit LoadMonitor(Callback cb = nullptr, unsigned interval_ms = 100);
+    void Cancel() { cancelled_ = true; }
+    bool Cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+    // Used by the loaders
+    void BeginPhase(const std::string& phase, size_t total);
+    void AddRows(size_t n);
+private:
+    void report();
+    Callback cb_;
+    std::chrono::steady_clock::duration interval_;
+    std::atomic<bool> cancelled_{false};
+    std::atomic<size_t> rows_{0};
+    std::atomic<std::chrono::steady_clock::rep> next_report_{0};
+    std::mutex phase_mut_;
+    std::string phase_;
+    size_t total_ = 0;
+    std::chrono::steady_clock::time_point phase_start_;
+};
+
 class PlayerHashTable;
 class PlayerTrie;
 
-bool BackendDB_LoadAllPlayers(const std::string& db_path, PlayerHashTable& hash, PlayerTrie& trie);
-bool BackendDB_LoadAllPlayers(const std::string& db_path, PlayerHashTable& hash);
-bool BackendDB_LoadAllPlayers(const std::string& db_path, PlayerTrie& trie);
-// Call after loading players:
-bool BackendDB_LoadPlayerStats(const std::string& db_path, PlayerHashTable& hash, PlayerTrie& trie);
+// Highest rowid each table had when it was last read; rows past it are new.
+// Assumes rows are only appended, as in the weekly tournament imports.
+struct HighWaterMarks {
+    long long players = 0;
+    long long sets = 0;
+};
+
+// A player as a refresh left it, at its position in PlayerHashTable::ForEachRecord order
+struct UpdatedPlayer {
+    size_t row = 0;
+    PlayerRecord record;
+};
+
+// Rows a refresh found past the marks
+struct RefreshDelta {
+    size_t new_players = 0;
+    std::vector<SetSummary> sets;   // rowid order
+    GameTable games;
+    // Every player inserted or given new totals, once each, by row; rows past
+    // the table's previous Size() are the new players, in order
+    std::vector<UpdatedPlayer> players;
+};
+
+// All loaders return false on error or when cancelled through the monitor;
+// a cancelled load leaves the output structures untouched.
+bool BackendDB_LoadAllPlayers(const std::string& db_path, PlayerHashTable& hash, PlayerTrie& trie,
+                              LoadMonitor* monitor = nullptr, HighWaterMarks* marks = nullptr);
+// Single-structure loads build only the structure given
+bool BackendDB_LoadAllPlayers(const std::string& db_path, PlayerHashTable& hash, LoadMonitor* monitor = nullptr);
+bool BackendDB_LoadAllPlayers(const std::string& db_path, PlayerTrie& trie, LoadMonitor* monitor = nullptr);
+// Players and their stats in one load: the sets are tallied first and every
+// record is indexed with its totals already set, so each structure is built
+// and published once. With sets non-null every sets row is also appended to
+// it, in rowid order, from the same pass; with games non-null every game in
+// game_data is decoded into it, also in rowid order. The full loaders record
+// the rowid they read up to in marks, if given.
+bool BackendDB_LoadPlayersWithStats(const std::string& db_path, PlayerHashTable& hash, PlayerTrie& trie,
+                                    LoadMonitor* monitor = nullptr, std::vector<SetSummary>* sets = nullptr,
+                                    GameTable* games = nullptr, HighWaterMarks* marks = nullptr);
+bool BackendDB_LoadPlayersWithStats(const std::string& db_path, PlayerHashTable& hash, LoadMonitor* monitor = nullptr);
+bool BackendDB_LoadPlayersWithStats(const std::string& db_path, PlayerTrie& trie, LoadMonitor* monitor = nullptr);
+// Re-hydrates structures that are already loaded; sets, games and marks as
+// above. Every record changes, so each structure stages a full copy while
+// readers keep the published one: twice the memory until the swap.
+bool BackendDB_LoadPlayerStats(const std::string& db_path, PlayerHashTable& hash, PlayerTrie& trie,
+                               LoadMonitor* monitor = nullptr, std::vector<SetSummary>* sets = nullptr,
+                               GameTable* games = nullptr, HighWaterMarks* marks = nullptr);
+// Reads only players and sets past marks: new players are inserted, the new
+// sets' tallies are added to the players they involve, and marks advance.
+// delta receives what was read and the players it changed, for updating the
+// derived indexes. Only those players are written: the staged structures share
+// everything else with the published ones. Sets added before their player row
+// are not counted for that player until a full load.
+bool BackendDB_Refresh(const std::string& db_path, PlayerHashTable& hash, PlayerTrie& trie,
+                       HighWaterMarks& marks, RefreshDelta& delta, LoadMonitor* monitor = nullptr);
 
+// Player row decoding alone, on one thread over the players table; legacy
+// runs the old copy-per-field decoder for comparison
+struct DecodeBenchmark {
+    size_t rows = 0;
+    double allocs_per_row = -1.0;   // negative unless the build counts allocations
+    double rows_per_sec = 0.0;
+};
+bool Backend_BenchmarkPlayerDecode(const std::string& db_path, bool legacy, DecodeBenchmark& out);
+
+// Records are stored once in a dense array; the name and ID tables hold only a
+// record index, a short fingerprint and the probe distance per slot (Robin Hood
+// hashing). Both tables double once they pass the maximum load factor.
+//
+// Lookups never lock: they read the published version of the table. Insert,
+// Reserve, Clear, ApplyStats, AddStats and ImportSlots go to a staged copy under the
+// writer mutex and become visible to readers only on Publish(). Returned
+// pointers stay valid while the caller holds an RcuReadGuard taken before
+// the lookup, or the RecordPin the lookup filled in.
+//
+// Slots and records are kept in fixed-size pages that versions share: a
+// staged copy starts out as the page list of the published one and copies a
+// page the first time it writes to it, so a small batch of writes costs the
+// pages it touched rather than the table.
+//
+// Pages are allocated through a per-table TrackingResource, so the memory
+// figures are exact and include staged and not yet reclaimed versions.
 class PlayerHashTable {
 public:
-    PlayerHashTable(size_t init_size = 131072);
-    void Insert(const PlayerRecord& record);
-    const PlayerRecord* SearchByName(const std::string& name) const;
-    const PlayerRecord* SearchByID(const std::string& id) const;
+    PlayerHashTable(size_t init_size = 1024, double max_load_factor = 0.75);
+    // Pass an rvalue to move the record in instead of copying it. Returns the
+    // record's row in ForEachRecord order.
+    size_t Insert(PlayerRecord record);
+    const PlayerRecord* SearchByName(const std::string& name, RecordPin* pin = nullptr) const;
+    const PlayerRecord* SearchByID(const std::string& id, RecordPin* pin = nullptr) const;
+    // Batched SearchByName/SearchByID over one read-side section. Keys go in
+    // groups: all are hashed and their home slots prefetched before any is
+    // probed, so the cache misses of a group overlap instead of queueing.
+    // Element i is the match for keys[i] or nullptr.
+    std::vector<const PlayerRecord*> SearchByNames(const std::vector<std::string>& names) const;
+    std::vector<const PlayerRecord*> SearchByIDs(const std::vector<std::string>& ids) const;
     void Clear();
+    // Pre-size for n players so bulk loads do not rehash along the way
+    void Reserve(size_t n);
+    void SetMaxLoadFactor(double lf);
+    // Write stats from tallies into every stored record in one pass
+    void ApplyStats(const PlayerTallyMap& tallies);
+    // Add delta on top of the current stats of the players it names; each
+    // player changed is appended to updated, if given
+    void AddStats(const PlayerTallyMap& delta, std::vector<UpdatedPlayer>* updated = nullptr);
+    // Make staged writes visible to readers in one atomic swap
+    void Publish();
+    // Every stored player, one record per ID, in insertion order (an updated
+    // ID keeps its place). ForEachRecord streams them without copying, inside
+    // its own read-side section; fn must not write to the table.
+    // ForEachRecordUntil stops once fn returns false; with pin, the records
+    // fn was given stay valid after it returns.
+    size_t Size() const;
+    void ForEachRecord(const std::function<void(const PlayerRecord&)>& fn) const;
+    void ForEachRecordUntil(const std::function<bool(const PlayerRecord&)>& fn, RecordPin* pin = nullptr) const;
     std::vector<PlayerRecord> GetFirstNRecords(size_t n) const;
+    // Live bytes held, record strings included (interned main characters are shared)
     size_t MemoryUsageBytes() const;
+    MemoryStats GetMemoryStats() const;
+    // Bytes the same contents took in the old two-table Entry layout
+    size_t LegacyLayoutBytes() const;
+
+    struct ProbeStats {
+        size_t capacity = 0;      // slots per table
+        size_t entries = 0;       // occupied slots, both tables
+        double load_factor = 0.0;
+        double avg_probe = 0.0;   // mean distance from home slot
+        size_t max_probe = 0;
+    };
+    ProbeStats GetProbeStats() const;
+
+    // Slot layout for snapshots: one record index per slot, kEmptySlot if free
+    static constexpr uint32_t kEmptySlot = 0xFFFFFFFFu;
+    void ExportSlots(std::vector<PlayerRecord>& records,
+                     std::vector<uint32_t>& byName, std::vector<uint32_t>& byID) const;
+    // Rebuilds the table from an exported layout without rehashing; the
+    // records are moved in, as on Insert
+    bool ImportSlots(std::vector<PlayerRecord> records,
+                     const uint32_t* byName, const uint32_t* byID, size_t capacity);
 private:
-    struct Entry {
-        PlayerRecord data;
-        bool taken = false;
+    struct Slot {
+        uint32_t index = kEmptySlot;
+        uint16_t fingerprint = 0;
+        uint16_t dist = 0;
+    };
+    static constexpr size_t npos = (size_t)-1;
+    // String payloads a stored value owns, reported to the resource by hand
+    static size_t heapBytes(const Slot&) { return 0; }
+    static size_t heapAllocs(const Slot&) { return 0; }
+    static size_t heapBytes(const PlayerRecord& r);
+    static size_t heapAllocs(const PlayerRecord& r);
+
+    // Array of 2^kPageBits-element pages, each shared by every version that
+    // has not written to it. Reads go through operator[]; writes through
+    // mut(), set() or push_back(), which copy a shared page first.
+    template <typename T, unsigned kPageBits>
+    class PagedArray {
+    public:
+        static constexpr size_t kPageSize = size_t(1) << kPageBits;
+        explicit PagedArray(TrackingResource* memory) : _memory(memory), _pages(memory) {}
+        PagedArray(const PagedArray& other);   // shares every page
+        PagedArray& operator=(const PagedArray&) = delete;
+        ~PagedArray() { clear(); }
+        size_t size() const { return _size; }
+        size_t pageCount() const { return _pages.size(); }
+        const T& operator[](size_t i) const { return _pages[i >> kPageBits]->items[i & (kPageSize - 1)]; }
+        // For edits that leave the element's strings alone
+        T& mut(size_t i) { return own(i >> kPageBits)->items[i & (kPageSize - 1)]; }
+        void set(size_t i, T value);
+        void push_back(T value);
+        void reserve(size_t n) { _pages.reserve((n + kPageSize - 1) >> kPageBits); }
+        // n copies of value, on pages of their own
+        void assign(size_t n, const T& value);
+        void clear();
+        void swap(PagedArray& other);
+    private:
+        struct Page {
+            std::atomic<size_t> refs{1};   // versions holding the page
+            size_t heapBytes = 0;          // string payloads of items
+            T items[kPageSize];
+        };
+        Page* newPage();
+        Page* own(size_t page);
+        void drop(Page* page);
+        void track(Page* page, const T& item, bool add);
+        TrackingResource* _memory;
+        std::pmr::vector<Page*> _pages;
+        size_t _size = 0;
+    };
+    using RecordArray = PagedArray<PlayerRecord, 7>;
+    using SlotArray = PagedArray<Slot, 10>;
+
+    // One immutable-once-published version of the table
+    struct Table {
+        Table(std::shared_ptr<TrackingResource> memory, size_t capacity);
+        Table(const Table& other) = default;
+        Table& operator=(const Table&) = delete;
+        std::shared_ptr<TrackingResource> memory;   // outlives retired versions
+        RecordArray records;
+        SlotArray byName;
+        SlotArray byID;
+        size_t mask;
+        size_t nameCount = 0;
+        size_t idCount = 0;
+        size_t find(const SlotArray& slots, const std::string& key,
+                    std::string PlayerRecord::*field) const;
+        size_t nextCandidate(const SlotArray& slots, size_t p, uint32_t d, uint16_t fp) const;
+        void findBatch(const SlotArray& slots, const std::string* keys, size_t n,
+                       std::string PlayerRecord::*field, const PlayerRecord** out) const;
+        void place(SlotArray& slots, size_t h, uint32_t idx);
+        void erase(SlotArray& slots, size_t p);
+        void growFor(size_t entries, double max_load);
+        void rehash(size_t capacity);
     };
-    std::vector<Entry> _byName;
-    std::vector<Entry> _byID;
-    size_t _mask;
-    size_t hashString(const std::string& s) const;
-    mutable std::mutex mut_;
+    static RecordPin pinRecords(const Table& t);
+    static size_t hashString(const std::string& s);
+    std::shared_ptr<TrackingResource> _memory;
+    size_t _initCapacity;
+    double _maxLoad = 0.75;
+    RcuCell<Table> _table;
 };
 
+struct ArtNode;    // adaptive radix tree node, defined in backend.cpp
+struct ArtArena;   // storage of one tree version, defined in backend.cpp
+
+// Orderings for ranked prefix queries (best first)
+enum PlayerRankBy {
+    RANK_BY_MATCHES_PLAYED = 0,
+    RANK_BY_WIN_RATE
+};
+
+// Adaptive radix tree over the raw bytes of the player name, so UTF-8 tags
+// are indexed in full. Players who share a tag are all kept under its key;
+// SearchExact returns the one inserted last, like PlayerHashTable::SearchByName.
+// Same publication model as PlayerHashTable: lock-free lookups against the
+// published tree, writes staged until Publish(). A staged version starts out
+// as the published root and copies only the nodes on the paths it writes to,
+// so Publish() re-ranks just those paths. Stored records are never changed:
+// an update stores a new record.
+// Nodes and records live in an arena shared by every version staged from the
+// same load, laid out in build order. What a version replaced stays there
+// until Clear() or ApplyStats() starts a new arena and the old one is
+// released in bulk, instead of node by node.
 class PlayerTrie {
 public:
     PlayerTrie();
     ~PlayerTrie();
-    void Insert(const PlayerRecord& record);
-    const PlayerRecord* SearchExact(const std::string& name) const;
+    void Insert(PlayerRecord record);   // moves in an rvalue, as PlayerHashTable::Insert
+    // Removes player id's record from under name, e.g. before re-inserting the
+    // player under a new tag; false if there is none. Staged like Insert.
+    bool Erase(const std::string& name, const std::string& id);
+    const PlayerRecord* SearchExact(const std::string& name, RecordPin* pin = nullptr) const;
+    // Batched SearchExact: a group of keys descends together, one level per
+    // round, with each key's next node prefetched a round before it is read
+    std::vector<const PlayerRecord*> SearchExactBatch(const std::vector<std::string>& names) const;
     std::vector<const PlayerRecord*> SearchByPrefix(const std::string& prefix) const;
+    // Best k players under prefix. Each node caches its top 10 per ranking, so
+    // k <= 10 costs the prefix walk plus k; larger k ranks the whole subtree.
+    std::vector<const PlayerRecord*> TopKByPrefix(const std::string& prefix, size_t k,
+                                                  PlayerRankBy rank_by = RANK_BY_MATCHES_PLAYED) const;
     void Clear();
+    // Write stats from tallies into every stored record: the staged version
+    // becomes a full copy, in a new arena, laid out in key order
+    void ApplyStats(const PlayerTallyMap& tallies);
+    // Rebuilds the cached top-k lists on the written paths, then makes staged
+    // writes visible
+    void Publish();
+    // As on PlayerHashTable; records come in key order, players who share a
+    // tag oldest first
+    size_t Size() const;
+    void ForEachRecord(const std::function<void(const PlayerRecord&)>& fn) const;
+    void ForEachRecordUntil(const std::function<bool(const PlayerRecord&)>& fn, RecordPin* pin = nullptr) const;
     std::vector<const PlayerRecord*> GetFirstNRecords(size_t n) const;
+    // As on PlayerHashTable: nodes, prefixes, top-k lists and records all
+    // come from the trie's own TrackingResource
+    size_t MemoryUsageBytes() const;
+    MemoryStats GetMemoryStats() const;
+private:
+    struct Tree {
+        explicit Tree(std::shared_ptr<TrackingResource> memory);
+        Tree(const Tree& other);   // shares the nodes and the arena
+        Tree& operator=(const Tree&) = delete;
+        ~Tree();
+        std::shared_ptr<TrackingResource> memory;
+        std::shared_ptr<ArtArena> arena;   // records live here too
+        ArtNode* root;
+        size_t count = 0;                  // records reachable from root
+        std::vector<ArtNode*> replaced;    // published nodes this version copied instead of writing
+    };
+    static RecordPin pinRecords(const Tree& t);
+    std::shared_ptr<TrackingResource> _memory;
+    RcuCell<Tree> _tree;
+};
+
+// The original 128-way pointer trie (ASCII bytes only, one 1 KiB node per
+// character). Not thread-safe; kept so the Load Data tab can compare it with
+// the radix tree.
+class LegacyPlayerTrie {
+public:
+    LegacyPlayerTrie();
+    ~LegacyPlayerTrie();
+    LegacyPlayerTrie(const LegacyPlayerTrie&) = delete;
+    LegacyPlayerTrie& operator=(const LegacyPlayerTrie&) = delete;
+    void Insert(const PlayerRecord& record);
+    const PlayerRecord* SearchExact(const std::string& name) const;
+    std::vector<const PlayerRecord*> SearchByPrefix(const std::string& prefix) const;
     size_t MemoryUsageBytes() const;
 private:
     struct Node {
@@ -65,7 +471,6 @@ private:
         std::unique_ptr<PlayerRecord> rec;
     };
     Node* root;
-    void free(Node* n);
-    void prefixSearch(Node* n, std::vector<const PlayerRecord*>& out) const;
-    mutable std::mutex mut_;
+    static void free(Node* n);
+    static void prefixSearch(const Node* n, std::vector<const PlayerRecord*>& out);
 };
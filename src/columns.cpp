@@ -0,0 +1,141 @@
+#include "columns.h"
+#include <algorithm>
+#include <string_view>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+void PlayerColumns::Build(const PlayerHashTable& players) {
+    const size_t n = players.Size();
+    _played.clear();
+    _won.clear();
+    _charCode.clear();
+    _nameOff.assign(1, 0);
+    _played.reserve(n);
+    _won.reserve(n);
+    _charCode.reserve(n);
+    _nameOff.reserve(n + 1);
+    _namePool.clear();
+    _renamed.clear();
+    _charNames.clear();
+    _charIndex.clear();
+
+    // Records are streamed from the table rather than copied out first
+    players.ForEachRecord([this](const PlayerRecord& r) { append(r); });
+}
+
+void PlayerColumns::Update(const std::vector<UpdatedPlayer>& players) {
+    for (const UpdatedPlayer& p : players) {
+        const PlayerRecord& r = p.record;
+        if (p.row == Rows()) {
+            append(r);
+            continue;
+        }
+        if (p.row > Rows()) continue;
+        _played[p.row] = std::max(r.matches_played, 0);
+        _won[p.row] = std::max(r.matches_won, 0);
+        _charCode[p.row] = codeFor(r.main_character);
+        // A new tag goes to the side table; the pool keeps its offsets
+        std::string_view pooled(_namePool.data() + _nameOff[p.row], _nameOff[p.row + 1] - _nameOff[p.row]);
+        if (pooled != r.name) _renamed[p.row] = r.name;
+        else                  _renamed.erase(p.row);
+    }
+}
+
+// Records without stats count as zero, as in the row-wise totals
+void PlayerColumns::append(const PlayerRecord& r) {
+    _played.push_back(std::max(r.matches_played, 0));
+    _won.push_back(std::max(r.matches_won, 0));
+    _charCode.push_back(codeFor(r.main_character));
+    _namePool += r.name;
+    _nameOff.push_back((uint32_t)_namePool.size());
+}
+
+uint16_t PlayerColumns::codeFor(const std::string& main) {
+    auto it = _charIndex.find(main);
+    if (it != _charIndex.end()) return it->second;
+    if (_charNames.size() >= kOtherCode) return kOtherCode;   // dictionary is full
+    uint16_t code = (uint16_t)_charNames.size();
+    _charIndex.emplace(main, code);
+    _charNames.push_back(main);
+    return code;
+}
+
+std::string PlayerColumns::Name(size_t row) const {
+    if (!_renamed.empty()) {
+        auto it = _renamed.find(row);
+        if (it != _renamed.end()) return it->second;
+    }
+    return _namePool.substr(_nameOff[row], _nameOff[row + 1] - _nameOff[row]);
+}
+
+int PlayerColumns::CharacterCode(const std::string& name) const {
+    auto it = _charIndex.find(name);
+    return it == _charIndex.end() ? kUnknownCharacter : it->second;
+}
+
+PlayerColumns::Totals PlayerColumns::SumForCharacter(int code) const {
+    Totals t;
+    if (code < 0 || code >= (int)CharacterCount()) return t;
+    const size_t n = Rows();
+    size_t i = 0;
+#ifdef __SSE2__
+    // 8 rows per step: compare the 16-bit codes, widen the match mask to
+    // 32 bits and add the masked played/won lanes. Lane sums are folded into
+    // 64 bits every block so they cannot overflow.
+    const __m128i target = _mm_set1_epi16((short)code);
+    const size_t kBlock = 1 << 14;
+    while (i + 8 <= n) {
+        __m128i accP = _mm_setzero_si128(), accW = _mm_setzero_si128();
+        size_t stop = std::min(n - (n - i) % 8, i + kBlock);
+        for (; i < stop; i += 8) {
+            __m128i codes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&_charCode[i]));
+            __m128i eq = _mm_cmpeq_epi16(codes, target);
+            __m128i lo = _mm_unpacklo_epi16(eq, eq), hi = _mm_unpackhi_epi16(eq, eq);
+            const __m128i* p = reinterpret_cast<const __m128i*>(&_played[i]);
+            const __m128i* w = reinterpret_cast<const __m128i*>(&_won[i]);
+            accP = _mm_add_epi32(accP, _mm_and_si128(lo, _mm_loadu_si128(p)));
+            accP = _mm_add_epi32(accP, _mm_and_si128(hi, _mm_loadu_si128(p + 1)));
+            accW = _mm_add_epi32(accW, _mm_and_si128(lo, _mm_loadu_si128(w)));
+            accW = _mm_add_epi32(accW, _mm_and_si128(hi, _mm_loadu_si128(w + 1)));
+        }
+        alignas(16) int32_t lanes[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), accP);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes + 4), accW);
+        t.played += (int64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        t.won    += (int64_t)lanes[4] + lanes[5] + lanes[6] + lanes[7];
+    }
+#endif
+    for (; i < n; ++i) {
+        if (_charCode[i] != code) continue;
+        t.played += _played[i];
+        t.won += _won[i];
+    }
+    return t;
+}
+
+std::vector<PlayerColumns::Totals> PlayerColumns::SumByCharacter() const {
+    // One pass over three narrow columns; the per-code table stays in L1.
+    // kOtherCode only occurs once the dictionary is full, where it is the
+    // extra last entry, dropped before returning.
+    std::vector<Totals> totals(CharacterCount() + 1);
+    const uint16_t* code = _charCode.data();
+    const int32_t* played = _played.data();
+    const int32_t* won = _won.data();
+    for (size_t i = 0, n = Rows(); i < n; ++i) {
+        Totals& t = totals[code[i]];
+        t.played += played[i];
+        t.won += won[i];
+    }
+    totals.pop_back();
+    return totals;
+}
+
+size_t PlayerColumns::MemoryUsageBytes() const {
+    size_t total = _played.capacity() * sizeof(int32_t) + _won.capacity() * sizeof(int32_t)
+                 + _charCode.capacity() * sizeof(uint16_t) + _namePool.capacity()
+                 + _nameOff.capacity() * sizeof(uint32_t);
+    for (const auto& c : _charNames) total += sizeof(std::string) + c.capacity();
+    for (const auto& r : _renamed) total += sizeof(r) + r.second.capacity();
+    return total;
+}
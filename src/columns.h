@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "backend.h"
+
+//--------------------------------------------------
+// Column-oriented copy of the hydrated player stats
+//--------------------------------------------------
+// Built once after a stats load for the character and stage tabs. Each field
+// is its own contiguous array, indexed by row; main_character is stored as a
+// small integer code into a dictionary of distinct character names (rows
+// past the dictionary's 65535 names get kOtherCode, which no name has). Filter
+// and group-by queries scan the int columns directly (SSE2 where available)
+// instead of copying PlayerRecords and comparing strings.
+// Build() lays out every row; after a refresh, Update() patches the rows it
+// changed and appends the new ones, so the columns keep the table's row order.
+
+class PlayerColumns {
+public:
+    static const int kUnknownCharacter = -1;
+    // Code of mains that did not fit in the dictionary; never a real character
+    static const uint16_t kOtherCode = 0xFFFF;
+
+    struct Totals {
+        int64_t played = 0;
+        int64_t won = 0;
+    };
+
+    void Build(const PlayerHashTable& players);
+    // Rows past Rows() must follow on from it, in order (RefreshDelta::players)
+    void Update(const std::vector<UpdatedPlayer>& players);
+    size_t Rows() const { return _played.size(); }
+
+    // --- Character dictionary ---
+    size_t CharacterCount() const { return _charNames.size(); }
+    int CharacterCode(const std::string& name) const;   // kUnknownCharacter if absent
+    const std::string& CharacterName(int code) const { return _charNames[code]; }
+
+    // --- Kernels ---
+    // Sum of played/won over rows whose main is code
+    Totals SumForCharacter(int code) const;
+    // Same sums for every character at once, indexed by code (kOtherCode rows excluded)
+    std::vector<Totals> SumByCharacter() const;
+
+    // --- Column access ---
+    const int32_t*  Played() const { return _played.data(); }
+    const int32_t*  Won() const { return _won.data(); }
+    const uint16_t* CharacterCodes() const { return _charCode.data(); }
+    std::string Name(size_t row) const;
+    double WinRate(size_t row) const { return _played[row] > 0 ? (double)_won[row] / _played[row] : 0.0; }
+
+    size_t MemoryUsageBytes() const;
+private:
+    uint16_t codeFor(const std::string& main);
+    void append(const PlayerRecord& r);
+    std::vector<int32_t>  _played;
+    std::vector<int32_t>  _won;
+    std::vector<uint16_t> _charCode;
+    std::string           _namePool;   // all names back to back
+    std::vector<uint32_t> _nameOff;    // Rows() + 1 offsets into _namePool
+    std::unordered_map<size_t, std::string> _renamed;   // rows whose tag changed since Build()
+    std::vector<std::string> _charNames;
+    std::unordered_map<std::string, uint16_t> _charIndex;
+};
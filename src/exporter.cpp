@@ -0,0 +1,325 @@
+#include "exporter.h"
+#include "matchups.h"
+#include "pairs.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+const char     kColumnarMagic[8] = {'S','M','C','O','L','\0','\0','\0'};
+const uint32_t kColumnarVersion  = 1;
+const size_t   kWriteBufferBytes = 1 << 20;
+const size_t   kProgressRows     = 4096;   // rows between progress reports and cancel checks
+
+enum ColumnType : uint8_t {
+    COL_INT64  = 1,
+    COL_DOUBLE = 2,
+    COL_STRING = 3
+};
+struct ExportColumn {
+    const char* name;
+    ColumnType type;
+};
+
+// Appends to a fixed buffer and hands it to the file whenever it fills
+class BufferedWriter {
+public:
+    bool Open(const std::string& path) {
+        _out.open(path, std::ios::binary | std::ios::trunc);
+        _buf.reserve(kWriteBufferBytes);
+        return (bool)_out;
+    }
+    void Write(const void* data, size_t bytes) {
+        if (_buf.size() + bytes > kWriteBufferBytes) flush();
+        if (bytes >= kWriteBufferBytes) {
+            _out.write(static_cast<const char*>(data), bytes);
+            return;
+        }
+        const char* p = static_cast<const char*>(data);
+        _buf.insert(_buf.end(), p, p + bytes);
+    }
+    void Put(char c) {
+        if (_buf.size() == kWriteBufferBytes) flush();
+        _buf.push_back(c);
+    }
+    template<class T> void Pod(const T& v) { Write(&v, sizeof(v)); }
+    bool Close() {
+        flush();
+        _out.close();
+        return !_out.fail();
+    }
+    bool Failed() const { return _out.fail(); }
+private:
+    void flush() {
+        if (!_buf.empty()) _out.write(_buf.data(), _buf.size());
+        _buf.clear();
+    }
+    std::ofstream _out;
+    std::vector<char> _buf;
+};
+
+// Receives one row at a time, one value per column in column order. EndRow
+// reports progress and notices cancellation; after that (or a write error)
+// Stopped() is true and the exporters stop producing rows.
+class RowSink {
+public:
+    RowSink(const std::vector<ExportColumn>& columns, LoadMonitor* monitor)
+        : _columns(columns), _monitor(monitor) {}
+    virtual ~RowSink() = default;
+    virtual bool Open(const std::string& path) = 0;
+    virtual void Int(long long v) = 0;
+    virtual void Real(double v) = 0;
+    virtual void Str(std::string_view v) = 0;
+    virtual bool Close() = 0;
+
+    void EndRow() {
+        endRow();
+        ++_rows;
+        if (_rows % kProgressRows == 0) {
+            if (_monitor) {
+                _monitor->AddRows(kProgressRows);
+                if (_monitor->Cancelled()) _stopped = true;
+            }
+            if (failed()) _stopped = true;
+        }
+    }
+    bool Stopped() const { return _stopped; }
+    size_t Rows() const { return _rows; }
+protected:
+    virtual void endRow() = 0;
+    virtual bool failed() const = 0;
+    const std::vector<ExportColumn>& _columns;
+private:
+    LoadMonitor* _monitor;
+    size_t _rows = 0;
+    bool _stopped = false;
+};
+
+class CsvSink : public RowSink {
+public:
+    using RowSink::RowSink;
+    bool Open(const std::string& path) override {
+        if (!_w.Open(path)) return false;
+        for (size_t c = 0; c < _columns.size(); ++c) {
+            if (c) _w.Put(',');
+            _w.Write(_columns[c].name, std::strlen(_columns[c].name));
+        }
+        _w.Put('\n');
+        return true;
+    }
+    void Int(long long v) override {
+        char buf[24];
+        field(buf, (size_t)std::snprintf(buf, sizeof(buf), "%lld", v));
+    }
+    void Real(double v) override {
+        char buf[32];
+        field(buf, (size_t)std::snprintf(buf, sizeof(buf), "%.6g", v));
+    }
+    void Str(std::string_view v) override {
+        separator();
+        // Quoted only when needed, with embedded quotes doubled
+        if (v.find_first_of(",\"\r\n") == std::string_view::npos) {
+            _w.Write(v.data(), v.size());
+            return;
+        }
+        _w.Put('"');
+        for (char c : v) {
+            if (c == '"') _w.Put('"');
+            _w.Put(c);
+        }
+        _w.Put('"');
+    }
+    bool Close() override { return _w.Close(); }
+protected:
+    void endRow() override {
+        _w.Put('\n');
+        _first = true;
+    }
+    bool failed() const override { return _w.Failed(); }
+private:
+    void separator() {
+        if (!_first) _w.Put(',');
+        _first = false;
+    }
+    void field(const char* s, size_t n) {
+        separator();
+        _w.Write(s, n);
+    }
+    BufferedWriter _w;
+    bool _first = true;
+};
+
+// Buffers one block of rows column by column and writes it when full
+class ColumnarSink : public RowSink {
+public:
+    ColumnarSink(const std::vector<ExportColumn>& columns, LoadMonitor* monitor)
+        : RowSink(columns, monitor), _data(columns.size()), _offsets(columns.size()) {}
+    bool Open(const std::string& path) override {
+        if (!_w.Open(path)) return false;
+        _w.Write(kColumnarMagic, sizeof(kColumnarMagic));
+        _w.Pod(kColumnarVersion);
+        _w.Pod((uint32_t)_columns.size());
+        for (const ExportColumn& col : _columns) {
+            uint16_t len = (uint16_t)std::strlen(col.name);
+            _w.Pod((uint8_t)col.type);
+            _w.Pod(len);
+            _w.Write(col.name, len);
+        }
+        return true;
+    }
+    void Int(long long v) override { number((int64_t)v); }
+    void Real(double v) override { number(v); }
+    void Str(std::string_view v) override {
+        std::vector<char>& d = _data[_col];
+        d.insert(d.end(), v.begin(), v.end());
+        _offsets[_col].push_back((uint32_t)d.size());
+        ++_col;
+    }
+    bool Close() override {
+        if (_blockRows > 0) writeBlock();
+        _w.Pod((uint32_t)0);
+        return _w.Close();
+    }
+protected:
+    void endRow() override {
+        _col = 0;
+        if (++_blockRows == kExportBlockRows) writeBlock();
+    }
+    bool failed() const override { return _w.Failed(); }
+private:
+    template<class T> void number(T v) {
+        std::vector<char>& d = _data[_col++];
+        const char* p = reinterpret_cast<const char*>(&v);
+        d.insert(d.end(), p, p + sizeof(v));
+    }
+    void writeBlock() {
+        _w.Pod((uint32_t)_blockRows);
+        for (size_t c = 0; c < _columns.size(); ++c) {
+            const std::vector<uint32_t>& off = _offsets[c];
+            _w.Pod((uint64_t)(off.size() * sizeof(uint32_t) + _data[c].size()));
+            _w.Write(off.data(), off.size() * sizeof(uint32_t));
+            _w.Write(_data[c].data(), _data[c].size());
+            _data[c].clear();
+            _offsets[c].clear();
+        }
+        _blockRows = 0;
+    }
+    BufferedWriter _w;
+    std::vector<std::vector<char>> _data;         // per column, values or string bytes
+    std::vector<std::vector<uint32_t>> _offsets;  // per string column, end of each value
+    size_t _col = 0;
+    size_t _blockRows = 0;
+};
+
+// Opens the sink, lets produce() stream every row into it and closes it.
+// Rows go to a temporary file that replaces path only once every row made
+// it to disk, so a cancelled or failed export leaves an existing file alone.
+template<class Produce>
+bool exportRows(const std::string& path, ExportFormat format, const std::vector<ExportColumn>& columns,
+                LoadMonitor* monitor, const std::string& phase, size_t total, size_t* rows, Produce produce) {
+    std::unique_ptr<RowSink> sink;
+    if (format == EXPORT_COLUMNAR) sink.reset(new ColumnarSink(columns, monitor));
+    else                           sink.reset(new CsvSink(columns, monitor));
+    std::string tmp = path + ".tmp";
+    if (!sink->Open(tmp)) {
+        std::cerr << "Export: cannot open " << tmp << std::endl;
+        return false;
+    }
+    if (monitor) monitor->BeginPhase(phase, total);
+    produce(*sink);
+    bool cancelled = monitor && monitor->Cancelled();
+    bool ok = sink->Close() && !cancelled;
+    if (!ok) {
+        if (!cancelled) std::cerr << "Export: write failed for " << tmp << std::endl;
+        std::remove(tmp.c_str());
+        return false;
+    }
+    std::remove(path.c_str());
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Export: cannot rename " << tmp << std::endl;
+        std::remove(tmp.c_str());
+        return false;
+    }
+    if (monitor) monitor->AddRows(sink->Rows() % kProgressRows);
+    if (rows) *rows = sink->Rows();
+    return true;
+}
+
+} // namespace
+
+bool Export_Players(const std::string& path, ExportFormat format, const PlayerHashTable& players,
+                    LoadMonitor* monitor, size_t* rows) {
+    static const std::vector<ExportColumn> columns = {
+        {"id", COL_STRING}, {"name", COL_STRING}, {"main", COL_STRING},
+        {"played", COL_INT64}, {"won", COL_INT64}, {"win_rate", COL_DOUBLE}};
+    return exportRows(path, format, columns, monitor, "Exporting players", players.Size(), rows,
+        [&players](RowSink& sink) {
+            players.ForEachRecord([&sink](const PlayerRecord& r) {
+                if (sink.Stopped()) return;
+                sink.Str(r.id);
+                sink.Str(r.name);
+                sink.Str(r.main_character.str());
+                sink.Int(r.matches_played);
+                sink.Int(r.matches_won);
+                sink.Real(r.win_rate);
+                sink.EndRow();
+            });
+        });
+}
+
+bool Export_Matchups(const std::string& path, ExportFormat format, const MatchupMatrix& matchups,
+                     LoadMonitor* monitor, size_t* rows) {
+    static const std::vector<ExportColumn> columns = {
+        {"character", COL_STRING}, {"opponent", COL_STRING},
+        {"games", COL_INT64}, {"wins", COL_INT64}, {"win_rate", COL_DOUBLE}};
+    const int n = (int)matchups.CharacterCount();
+    auto met = [&matchups](int a, int b) {
+        return !matchups.CharacterName(a).empty() && !matchups.CharacterName(b).empty()
+            && matchups.Matchup(a, b).games > 0;
+    };
+    size_t total = 0;
+    for (int a = 0; a < n; ++a)
+        for (int b = 0; b < n; ++b) total += met(a, b);
+    return exportRows(path, format, columns, monitor, "Exporting matchups", total, rows,
+        [&matchups, &met, n](RowSink& sink) {
+            for (int a = 0; a < n && !sink.Stopped(); ++a) {
+                for (int b = 0; b < n; ++b) {
+                    if (!met(a, b)) continue;
+                    MatchupMatrix::Totals t = matchups.Matchup(a, b);
+                    sink.Str(matchups.CharacterName(a));
+                    sink.Str(matchups.CharacterName(b));
+                    sink.Int((long long)t.games);
+                    sink.Int((long long)t.wins);
+                    sink.Real(t.WinRate());
+                    sink.EndRow();
+                }
+            }
+        });
+}
+
+bool Export_HeadToHead(const std::string& path, ExportFormat format, const SetPairIndex& pairs,
+                       LoadMonitor* monitor, size_t* rows) {
+    static const std::vector<ExportColumn> columns = {
+        {"rowid", COL_INT64}, {"p1", COL_INT64}, {"p2", COL_INT64}, {"winner", COL_INT64},
+        {"p1_score", COL_INT64}, {"p2_score", COL_INT64}, {"tournament", COL_STRING}};
+    return exportRows(path, format, columns, monitor, "Exporting head-to-head sets", pairs.SetCount(), rows,
+        [&pairs](RowSink& sink) {
+            pairs.ForEachPair([&](const SetPairIndex::Set* first, const SetPairIndex::Set* last) {
+                for (const SetPairIndex::Set* s = first; s != last && !sink.Stopped(); ++s) {
+                    sink.Int(s->rowid);
+                    sink.Int(s->p1);
+                    sink.Int(s->p2);
+                    sink.Int(s->winner);
+                    sink.Int(s->p1_score);
+                    sink.Int(s->p2_score);
+                    sink.Str(pairs.Tournament(s->tournament));
+                    sink.EndRow();
+                }
+            });
+        });
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include "backend.h"
+
+class MatchupMatrix;
+class SetPairIndex;
+
+//--------------------------------------------------
+// Streaming export of full query results
+//--------------------------------------------------
+// Rows are read straight from the in-memory structures and written through
+// a fixed-size buffer, so memory use does not grow with the result. Meant to
+// run on a background thread: progress goes to the monitor. Rows are written
+// to path + ".tmp" and renamed over path at the end, so a cancelled or failed
+// export leaves whatever was at path untouched.
+//
+// CSV files start with a header line. The columnar format (.smcol) is, all
+// little-endian:
+//   "SMCOL\0\0\0", uint32 version, uint32 column count,
+//   per column: uint8 type (1 int64, 2 double, 3 string), uint16 name length, name;
+//   blocks of up to kExportBlockRows rows: uint32 rows, then per column a
+//   uint64 byte length and the values (8 bytes each for numbers; for strings
+//   uint32 end offsets, one per row, followed by the bytes);
+//   a block of 0 rows ends the file.
+
+enum ExportFormat {
+    EXPORT_CSV = 0,
+    EXPORT_COLUMNAR
+};
+
+const size_t kExportBlockRows = 65536;
+
+// Every hydrated player: id, name, main, played, won, win_rate
+bool Export_Players(const std::string& path, ExportFormat format, const PlayerHashTable& players,
+                    LoadMonitor* monitor = nullptr, size_t* rows = nullptr);
+// Every character pair that met: character, opponent, games, wins, win_rate
+bool Export_Matchups(const std::string& path, ExportFormat format, const MatchupMatrix& matchups,
+                     LoadMonitor* monitor = nullptr, size_t* rows = nullptr);
+// Every set between two players, grouped by pair: rowid, p1, p2, winner,
+// p1_score, p2_score, tournament
+bool Export_HeadToHead(const std::string& path, ExportFormat format, const SetPairIndex& pairs,
+                       LoadMonitor* monitor = nullptr, size_t* rows = nullptr);
@@ -0,0 +1,182 @@
+#include "fuzzy.h"
+#include <algorithm>
+#include <iterator>
+
+std::string PlayerFuzzyIndex::NormalizeTag(const std::string& tag) {
+    auto fold = [](const std::string& s, size_t from) {
+        std::string out;
+        out.reserve(s.size() - from);
+        for (size_t i = from; i < s.size(); ++i) {
+            unsigned char c = (unsigned char)s[i];
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') continue;
+            out.push_back((c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : (char)c);
+        }
+        return out;
+    };
+    size_t bar = tag.rfind('|');
+    if (bar != std::string::npos) {
+        std::string rest = fold(tag, bar + 1);
+        if (!rest.empty()) return rest;
+    }
+    return fold(tag, 0);
+}
+
+int PlayerFuzzyIndex::DefaultMaxDistance(size_t query_len) {
+    if (query_len < 3) return 0;
+    if (query_len < 6) return 1;
+    return 2;
+}
+
+void PlayerFuzzyIndex::Build(const PlayerHashTable& players) {
+    _main = Part();
+    _recent = Part();
+    _main.entries.reserve(players.Size());
+    players.ForEachRecord([this](const PlayerRecord& r) {
+        std::string key = NormalizeTag(r.name);
+        if (key.empty()) return;
+        _main.entries.push_back({std::move(key), r.name, r.id, r.matches_played});
+    });
+    _main.build();
+}
+
+void PlayerFuzzyIndex::Update(const std::vector<UpdatedPlayer>& players) {
+    std::vector<Entry> added;
+    for (const UpdatedPlayer& p : players) {
+        const PlayerRecord& r = p.record;
+        std::string key = NormalizeTag(r.name);
+        if (key.empty()) continue;
+        Entry* e = _main.find(key, r.id);
+        if (!e) e = _recent.find(key, r.id);
+        if (e) e->matches_played = r.matches_played;
+        else   added.push_back({std::move(key), r.name, r.id, r.matches_played});
+    }
+    if (added.empty()) return;
+    std::move(added.begin(), added.end(), std::back_inserter(_recent.entries));
+    if (_recent.entries.size() > _main.entries.size() / 8) {
+        std::move(_recent.entries.begin(), _recent.entries.end(), std::back_inserter(_main.entries));
+        _recent = Part();
+        _main.build();
+    } else {
+        _recent.build();
+    }
+}
+
+void PlayerFuzzyIndex::Part::build() {
+    nodes.clear();
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.key < b.key; });
+
+    keyCount = 0;
+    maxKeyLen = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (i == 0 || entries[i].key != entries[i - 1].key) ++keyCount;
+        maxKeyLen = std::max(maxKeyLen, entries[i].key.size());
+    }
+    nodes.reserve(keyCount * 2 + 1);
+    nodes.emplace_back();
+    buildChildren(0, 0, entries.size(), 0);
+}
+
+// The built entry for this player under key, if any
+PlayerFuzzyIndex::Entry* PlayerFuzzyIndex::Part::find(const std::string& key, const std::string& id) {
+    if (nodes.empty()) return nullptr;
+    auto it = std::lower_bound(entries.begin(), entries.end(), key,
+                               [](const Entry& e, const std::string& k) { return e.key < k; });
+    for (; it != entries.end() && it->key == key; ++it)
+        if (it->id == id) return &*it;
+    return nullptr;
+}
+
+// Entries [lo, hi) share their first depth bytes, the path to node
+void PlayerFuzzyIndex::Part::buildChildren(uint32_t node, size_t lo, size_t hi, size_t depth) {
+    size_t end = lo;
+    while (end < hi && entries[end].key.size() == depth) ++end;
+    nodes[node].entry_lo = (uint32_t)lo;
+    nodes[node].entry_hi = (uint32_t)end;
+
+    // Lay out all children first so they stay contiguous, then descend
+    std::vector<std::pair<size_t, size_t>> groups;
+    for (size_t i = end; i < hi; ) {
+        size_t j = i + 1;
+        while (j < hi && entries[j].key[depth] == entries[i].key[depth]) ++j;
+        groups.emplace_back(i, j);
+        i = j;
+    }
+    uint32_t first = (uint32_t)nodes.size();
+    nodes[node].first_child = first;
+    nodes[node].child_count = (uint32_t)groups.size();
+    for (const auto& g : groups) {
+        Node child;
+        child.byte = (unsigned char)entries[g.first].key[depth];
+        nodes.push_back(child);
+    }
+    for (size_t c = 0; c < groups.size(); ++c)
+        buildChildren(first + (uint32_t)c, groups[c].first, groups[c].second, depth + 1);
+}
+
+std::vector<FuzzyMatch> PlayerFuzzyIndex::Search(const std::string& query, int max_distance, size_t limit) const {
+    std::vector<FuzzyMatch> out;
+    std::string q = NormalizeTag(query);
+    if (q.empty() || limit == 0) return out;
+    if (max_distance < 0) max_distance = 0;
+    _main.search(q, max_distance, out);
+    _recent.search(q, max_distance, out);
+
+    auto better = [](const FuzzyMatch& a, const FuzzyMatch& b) {
+        if (a.distance != b.distance) return a.distance < b.distance;
+        if (a.matches_played != b.matches_played) return a.matches_played > b.matches_played;
+        return a.name < b.name;
+    };
+    size_t keep = std::min(limit, out.size());
+    std::partial_sort(out.begin(), out.begin() + keep, out.end(), better);
+    out.resize(keep);
+    return out;
+}
+
+// Appends every entry within max_distance of the normalized query q
+void PlayerFuzzyIndex::Part::search(const std::string& q, int max_distance, std::vector<FuzzyMatch>& out) const {
+    if (nodes.empty()) return;
+    // rows[d] is the DP row after matching d trie bytes against q
+    const size_t m = q.size();
+    std::vector<std::vector<int>> rows(maxKeyLen + 1, std::vector<int>(m + 1));
+    for (size_t j = 0; j <= m; ++j) rows[0][j] = (int)j;
+
+    struct Frame { uint32_t node; uint32_t depth; };
+    std::vector<Frame> stack;
+    const Node& root = nodes[0];
+    for (uint32_t c = 0; c < root.child_count; ++c) stack.push_back({root.first_child + c, 1});
+
+    while (!stack.empty()) {
+        Frame f = stack.back();
+        stack.pop_back();
+        const Node& n = nodes[f.node];
+        const std::vector<int>& prev = rows[f.depth - 1];
+        std::vector<int>& row = rows[f.depth];
+        row[0] = (int)f.depth;
+        int best = row[0];
+        for (size_t j = 1; j <= m; ++j) {
+            int sub = prev[j - 1] + ((unsigned char)q[j - 1] != n.byte);
+            row[j] = std::min(std::min(row[j - 1], prev[j]) + 1, sub);
+            best = std::min(best, row[j]);
+        }
+        if (row[m] <= max_distance) {
+            for (uint32_t e = n.entry_lo; e < n.entry_hi; ++e) {
+                const Entry& en = entries[e];
+                out.push_back({en.name, en.id, row[m], en.matches_played});
+            }
+        }
+        if (best > max_distance) continue;
+        for (uint32_t c = 0; c < n.child_count; ++c)
+            stack.push_back({n.first_child + c, f.depth + 1});
+    }
+}
+
+size_t PlayerFuzzyIndex::MemoryUsageBytes() const {
+    return _main.memoryUsageBytes() + _recent.memoryUsageBytes();
+}
+size_t PlayerFuzzyIndex::Part::memoryUsageBytes() const {
+    size_t total = entries.capacity() * sizeof(Entry) + nodes.capacity() * sizeof(Node);
+    for (const Entry& e : entries)
+        total += e.key.capacity() + e.name.capacity() + e.id.capacity();
+    return total;
+}
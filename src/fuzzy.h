@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "backend.h"
+
+//--------------------------------------------------
+// Typo-tolerant tag search
+//--------------------------------------------------
+// Tags are normalized before indexing and before every query: the sponsor
+// prefix ("Team | Tag") is dropped, ASCII letters are lower-cased and
+// whitespace is removed. The normalized keys form a compact trie that is
+// walked with one Levenshtein DP row per level; a branch is abandoned as soon
+// as no cell of its row is within the allowed distance, so a query touches
+// only the part of the trie that can still match. Distances count bytes, so
+// a non-ASCII character costs one edit per UTF-8 byte.
+//
+// Build() indexes every player. Update() takes what a refresh changed: new
+// tags go to a small second trie, searched alongside the first and merged
+// into it once it passes an eighth of its size, and players already indexed
+// get their new matches_played. A tag a player no longer has stays listed
+// until the next Build().
+
+struct FuzzyMatch {
+    std::string name;          // tag as stored in the database
+    std::string id;
+    int distance = 0;          // edits between the normalized query and tag
+    int matches_played = 0;    // as of the last Build() or Update(), used to rank equal distances
+};
+
+class PlayerFuzzyIndex {
+public:
+    void Build(const PlayerHashTable& players);
+    void Update(const std::vector<UpdatedPlayer>& players);
+    // Best matches within max_distance edits: closest first, then most active
+    std::vector<FuzzyMatch> Search(const std::string& query, int max_distance, size_t limit) const;
+    // Edit budget that suits a query of this many normalized bytes
+    static int DefaultMaxDistance(size_t query_len);
+    static std::string NormalizeTag(const std::string& tag);
+    // Distinct keys in each trie, summed
+    size_t KeyCount() const { return _main.keyCount + _recent.keyCount; }
+    size_t MemoryUsageBytes() const;
+private:
+    struct Entry {
+        std::string key;
+        std::string name;
+        std::string id;
+        int matches_played;
+    };
+    // Children of a node are contiguous in _nodes and sorted by byte
+    struct Node {
+        uint32_t first_child = 0;
+        uint32_t child_count = 0;
+        uint32_t entry_lo = 0;     // entries whose key ends here: [entry_lo, entry_hi)
+        uint32_t entry_hi = 0;
+        unsigned char byte = 0;
+    };
+    struct Part {
+        std::vector<Entry> entries;   // sorted by key once built
+        std::vector<Node> nodes;      // nodes[0] is the root
+        size_t keyCount = 0;
+        size_t maxKeyLen = 0;
+        void build();
+        void buildChildren(uint32_t node, size_t lo, size_t hi, size_t depth);
+        void search(const std::string& q, int max_distance, std::vector<FuzzyMatch>& out) const;
+        Entry* find(const std::string& key, const std::string& id);
+        size_t memoryUsageBytes() const;
+    };
+    Part _main;
+    Part _recent;   // tags added by Update() since the last merge
+};
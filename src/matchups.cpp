@@ -0,0 +1,97 @@
+#include "matchups.h"
+#include <algorithm>
+#include <cctype>
+#include <thread>
+
+void MatchupMatrix::Build(const GameTable& games, unsigned threads) {
+    const std::vector<GameTable::Game>& all = games.Games();
+    _names = games.Characters();
+    const size_t n = _names.size();
+    const size_t cells = n * n;
+
+    // Counting is a few ns per game; under ~256k games per thread, spawning
+    // and merging costs more than it saves
+    const size_t kMinGamesPerThread = 1 << 18;
+    size_t parts = std::max<size_t>(1, std::min<size_t>(threads, all.size() / kMinGamesPerThread));
+    std::vector<std::vector<uint32_t>> partials(parts);
+    auto countSlice = [&](size_t p) {
+        std::vector<uint32_t>& m = partials[p];
+        m.assign(cells, 0);
+        size_t lo = all.size() * p / parts, hi = all.size() * (p + 1) / parts;
+        for (size_t i = lo; i < hi; ++i)
+            if (all[i].winner_char != GameTable::kOtherCode && all[i].loser_char != GameTable::kOtherCode)
+                ++m[(size_t)all[i].winner_char * n + all[i].loser_char];
+    };
+    if (parts == 1) {
+        countSlice(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (size_t p = 0; p < parts; ++p) workers.emplace_back(countSlice, p);
+        for (auto& t : workers) t.join();
+    }
+
+    _wins = std::move(partials[0]);
+    for (size_t p = 1; p < parts; ++p)
+        for (size_t c = 0; c < cells; ++c) _wins[c] += partials[p][c];
+
+    _overall.assign(n, Totals());
+    for (size_t a = 0; a < n; ++a)
+        for (size_t b = 0; b < n; ++b) {
+            Totals t = Matchup((int)a, (int)b);
+            _overall[a].games += t.games;
+            _overall[a].wins += t.wins;
+        }
+}
+
+void MatchupMatrix::AddGames(const GameTable& games) {
+    // Map the delta's dictionary onto ours; new characters widen the matrix
+    // until it holds as many names as a GameTable can code
+    const size_t oldN = _names.size();
+    std::vector<uint32_t> map(games.Characters().size());
+    for (size_t i = 0; i < map.size(); ++i) {
+        const std::string& name = games.Characters()[i];
+        auto it = std::find(_names.begin(), _names.end(), name);
+        map[i] = (uint32_t)(it - _names.begin());
+        if (it == _names.end() && _names.size() < GameTable::kOtherCode) _names.push_back(name);
+        else if (it == _names.end()) map[i] = GameTable::kOtherCode;
+    }
+    const size_t n = _names.size();
+    if (n != oldN) {
+        std::vector<uint32_t> wider(n * n, 0);
+        for (size_t a = 0; a < oldN; ++a)
+            std::copy(_wins.begin() + a * oldN, _wins.begin() + (a + 1) * oldN, wider.begin() + a * n);
+        _wins.swap(wider);
+        _overall.resize(n);
+    }
+    for (const GameTable::Game& g : games.Games()) {
+        if (g.winner_char == GameTable::kOtherCode || g.loser_char == GameTable::kOtherCode) continue;
+        uint32_t w = map[g.winner_char], l = map[g.loser_char];
+        if (w == GameTable::kOtherCode || l == GameTable::kOtherCode) continue;   // no row for it
+        ++_wins[(size_t)w * n + l];
+        ++_overall[w].wins;
+        ++_overall[w].games;
+        ++_overall[l].games;
+    }
+}
+
+int MatchupMatrix::CharacterCode(const std::string& name) const {
+    auto sameLetter = [](char x, char y) { return std::tolower((unsigned char)x) == std::tolower((unsigned char)y); };
+    for (size_t c = 0; c < _names.size(); ++c)
+        if (!name.empty() && _names[c].size() == name.size() &&
+            std::equal(name.begin(), name.end(), _names[c].begin(), sameLetter))
+            return (int)c;
+    return GameTable::kUnknownCode;
+}
+
+MatchupMatrix::Totals MatchupMatrix::Matchup(int a, int b) const {
+    Totals t;
+    t.wins = Wins(a, b);
+    t.games = (uint64_t)Wins(a, b) + Wins(b, a);   // a mirror game is one win and one loss
+    return t;
+}
+
+size_t MatchupMatrix::MemoryUsageBytes() const {
+    size_t total = _wins.capacity() * sizeof(uint32_t) + _overall.capacity() * sizeof(Totals);
+    for (const auto& name : _names) total += sizeof(std::string) + name.capacity();
+    return total;
+}
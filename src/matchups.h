@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "backend.h"
+
+//--------------------------------------------------
+// Character-vs-character matchup matrix over the decoded games
+//--------------------------------------------------
+// One dense N x N table of game wins, N being the GameTable's character
+// dictionary: Wins(a, b) is the number of games character a won against
+// character b, so any matchup is two loads. Games with a GameTable::kOtherCode
+// character are not counted. Built in parallel: every loader thread counts a
+// slice of the games into its own matrix and the matrices are summed at the
+// end. AddGames folds in a refresh in O(new games).
+
+class MatchupMatrix {
+public:
+    struct Totals {
+        uint64_t games = 0;
+        uint64_t wins = 0;
+        double WinRate() const { return games ? (double)wins / games : 0.0; }
+    };
+
+    void Build(const GameTable& games, unsigned threads);
+    void AddGames(const GameTable& games);
+
+    size_t CharacterCount() const { return _names.size(); }
+    const std::string& CharacterName(int code) const { return _names[code]; }
+    // Case-insensitive; GameTable::kUnknownCode if absent
+    int CharacterCode(const std::string& name) const;
+
+    uint32_t Wins(int a, int b) const { return _wins[(size_t)a * _names.size() + b]; }
+    // a's record against b; in the mirror every game counts from both sides
+    Totals Matchup(int a, int b) const;
+    // a's record against every character
+    const Totals& Overall(int a) const { return _overall[a]; }
+
+    size_t MemoryUsageBytes() const;
+private:
+    std::vector<std::string> _names;
+    std::vector<uint32_t> _wins;       // row-major, N x N
+    std::vector<Totals> _overall;
+};
@@ -0,0 +1,254 @@
+#include "metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+// Values below 2^kSubBits get a bucket each; above that every power of two
+// is split into 2^kSubBits buckets. Latencies are capped at 2^48 ns (~3 days).
+const unsigned kSubBits = 5;
+const uint64_t kSubBuckets = 1ull << kSubBits;
+const unsigned kMaxBits = 48;
+const size_t kBuckets = (kMaxBits - kSubBits + 1) * kSubBuckets;
+
+size_t bucketOf(uint64_t v) {
+    if (v < kSubBuckets) return (size_t)v;
+    if (v >> kMaxBits) v = (1ull << kMaxBits) - 1;
+    unsigned e = 63 - (unsigned)__builtin_clzll(v);
+    return (size_t)((e - kSubBits + 1) * kSubBuckets + ((v >> (e - kSubBits)) - kSubBuckets));
+}
+// Largest value that lands in bucket i
+uint64_t bucketHigh(size_t i) {
+    if (i < kSubBuckets) return i;
+    unsigned shift = (unsigned)(i / kSubBuckets) - 1;
+    uint64_t low = (kSubBuckets + i % kSubBuckets) << shift;
+    return low + (1ull << shift) - 1;
+}
+
+// Written only by the owning thread, so a plain load and store is enough
+inline void bump(std::atomic<uint64_t>& a, uint64_t n) {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct Histogram {
+    std::atomic<uint64_t> buckets[kBuckets]{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+};
+
+struct alignas(64) Shard {
+    std::atomic<uint64_t> counters[kMetricCounters]{};
+    std::atomic<Histogram*> hist[kMetricOps][kMetricBackends]{};   // allocated on first use
+    ~Shard() {
+        for (auto& row : hist)
+            for (auto& h : row) delete h.load();
+    }
+};
+
+// Plain sums, for exited threads, the reset baseline and reads
+struct HistTotals {
+    uint64_t buckets[kBuckets];
+    uint64_t count;
+    uint64_t total_ns;
+};
+struct Totals {
+    uint64_t counters[kMetricCounters];
+    HistTotals hist[kMetricOps][kMetricBackends];
+
+    void add(const Shard& s) {
+        for (size_t c = 0; c < kMetricCounters; ++c) counters[c] += s.counters[c].load(std::memory_order_relaxed);
+        for (size_t o = 0; o < kMetricOps; ++o) {
+            for (size_t b = 0; b < kMetricBackends; ++b) {
+                const Histogram* h = s.hist[o][b].load(std::memory_order_acquire);
+                if (!h) continue;
+                HistTotals& t = hist[o][b];
+                for (size_t i = 0; i < kBuckets; ++i) t.buckets[i] += h->buckets[i].load(std::memory_order_relaxed);
+                t.count += h->count.load(std::memory_order_relaxed);
+                t.total_ns += h->total_ns.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    void subtract(const Totals& base) {
+        for (size_t c = 0; c < kMetricCounters; ++c) counters[c] -= base.counters[c];
+        for (size_t o = 0; o < kMetricOps; ++o) {
+            for (size_t b = 0; b < kMetricBackends; ++b) {
+                HistTotals& t = hist[o][b];
+                const HistTotals& bt = base.hist[o][b];
+                for (size_t i = 0; i < kBuckets; ++i) t.buckets[i] -= bt.buckets[i];
+                t.count -= bt.count;
+                t.total_ns -= bt.total_ns;
+            }
+        }
+    }
+};
+
+std::mutex g_shardMut;
+std::vector<Shard*> g_shards;
+Totals g_exited;     // shards of threads that have exited
+Totals g_baseline;   // sums at the last reset
+std::chrono::steady_clock::time_point g_windowStart = std::chrono::steady_clock::now();
+
+struct ThreadShard {
+    Shard* shard = nullptr;
+    ~ThreadShard() {
+        if (!shard) return;
+        std::lock_guard<std::mutex> lock(g_shardMut);
+        g_exited.add(*shard);
+        g_shards.erase(std::find(g_shards.begin(), g_shards.end(), shard));
+        delete shard;
+    }
+};
+thread_local ThreadShard t_shard;
+
+Shard& localShard() {
+    if (!t_shard.shard) {
+        Shard* s = new Shard();
+        std::lock_guard<std::mutex> lock(g_shardMut);
+        g_shards.push_back(s);
+        t_shard.shard = s;
+    }
+    return *t_shard.shard;
+}
+
+// Sums since the last reset
+std::unique_ptr<Totals> snapshot() {
+    std::unique_ptr<Totals> t(new Totals());   // too large for the stack
+    std::lock_guard<std::mutex> lock(g_shardMut);
+    *t = g_exited;
+    for (const Shard* s : g_shards) t->add(*s);
+    t->subtract(g_baseline);
+    return t;
+}
+
+uint64_t percentile(const HistTotals& h, double p) {
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p * (double)h.count + 0.999999));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += h.buckets[i];
+        if (seen >= rank) return bucketHigh(i);
+    }
+    return 0;
+}
+
+std::string jsonNumber(double v) {
+    std::ostringstream os;
+    os << v;
+    return os.str();
+}
+
+} // namespace
+
+void Metrics_Add(MetricCounter counter, uint64_t n) {
+    bump(localShard().counters[counter], n);
+}
+
+uint64_t Metrics_Counter(MetricCounter counter) {
+    std::lock_guard<std::mutex> lock(g_shardMut);
+    uint64_t sum = g_exited.counters[counter];
+    for (const Shard* s : g_shards) sum += s->counters[counter].load(std::memory_order_relaxed);
+    return sum - g_baseline.counters[counter];
+}
+
+void Metrics_RecordLatency(MetricOp op, MetricBackend backend, uint64_t ns) {
+    Shard& s = localShard();
+    Histogram* h = s.hist[op][backend].load(std::memory_order_relaxed);
+    if (!h) {
+        h = new Histogram();
+        s.hist[op][backend].store(h, std::memory_order_release);
+    }
+    bump(h->buckets[bucketOf(ns)], 1);
+    bump(h->count, 1);
+    bump(h->total_ns, ns);
+}
+
+const char* Metrics_CounterName(MetricCounter counter) {
+    static const char* const names[kMetricCounters] = {
+        "rows_visited", "player_rows", "set_rows", "games_decoded",
+        "cache_hits", "cache_misses", "cache_evictions"};
+    return names[counter];
+}
+const char* Metrics_OpName(MetricOp op) {
+    static const char* const names[kMetricOps] = {
+        "exact_lookup", "prefix_search", "stats_hydration", "char_aggregate", "head_to_head"};
+    return names[op];
+}
+const char* Metrics_BackendName(MetricBackend backend) {
+    static const char* const names[kMetricBackends] = {"hash", "trie", "hash+trie", "columns"};
+    return names[backend];
+}
+
+std::vector<LatencySummary> Metrics_Latencies() {
+    std::unique_ptr<Totals> t = snapshot();
+    std::vector<LatencySummary> out;
+    for (size_t o = 0; o < kMetricOps; ++o) {
+        for (size_t b = 0; b < kMetricBackends; ++b) {
+            const HistTotals& h = t->hist[o][b];
+            if (h.count == 0) continue;
+            LatencySummary s;
+            s.op = (MetricOp)o;
+            s.backend = (MetricBackend)b;
+            s.count = h.count;
+            s.mean_ns = (double)h.total_ns / h.count;
+            s.p50_ns = percentile(h, 0.50);
+            s.p99_ns = percentile(h, 0.99);
+            s.p999_ns = percentile(h, 0.999);
+            for (size_t i = kBuckets; i-- > 0;)
+                if (h.buckets[i]) { s.max_ns = bucketHigh(i); break; }
+            s.ops_per_sec = h.total_ns ? h.count * 1e9 / (double)h.total_ns : 0.0;
+            out.push_back(s);
+        }
+    }
+    return out;
+}
+
+double Metrics_WindowSeconds() {
+    std::lock_guard<std::mutex> lock(g_shardMut);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - g_windowStart).count();
+}
+
+void Metrics_Reset() {
+    std::unique_ptr<Totals> base(new Totals());
+    std::lock_guard<std::mutex> lock(g_shardMut);
+    *base = g_exited;
+    for (const Shard* s : g_shards) base->add(*s);
+    g_baseline = *base;
+    g_windowStart = std::chrono::steady_clock::now();
+}
+
+std::string Metrics_Json() {
+    std::ostringstream js;
+    js << "{\n  \"window_sec\": " << jsonNumber(Metrics_WindowSeconds()) << ",\n  \"counters\": {";
+    for (size_t c = 0; c < kMetricCounters; ++c)
+        js << (c ? ", " : "") << "\"" << Metrics_CounterName((MetricCounter)c) << "\": "
+           << Metrics_Counter((MetricCounter)c);
+    js << "},\n  \"latencies\": [";
+    std::vector<LatencySummary> lat = Metrics_Latencies();
+    for (size_t i = 0; i < lat.size(); ++i) {
+        const LatencySummary& s = lat[i];
+        js << (i ? ",\n    " : "\n    ")
+           << "{\"op\": \"" << Metrics_OpName(s.op) << "\""
+           << ", \"backend\": \"" << Metrics_BackendName(s.backend) << "\""
+           << ", \"count\": " << s.count
+           << ", \"mean_ns\": " << jsonNumber(s.mean_ns)
+           << ", \"p50_ns\": " << s.p50_ns << ", \"p99_ns\": " << s.p99_ns
+           << ", \"p999_ns\": " << s.p999_ns << ", \"max_ns\": " << s.max_ns
+           << ", \"ops_per_sec\": " << jsonNumber(s.ops_per_sec) << "}";
+    }
+    js << "\n  ]\n}\n";
+    return js.str();
+}
+
+bool Metrics_WriteJson(const std::string& path) {
+    std::ofstream f(path);
+    f << Metrics_Json();
+    if (!f) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
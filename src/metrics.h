@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+
+//--------------------------------------------------
+// Hot-path counters and query latency histograms
+//--------------------------------------------------
+// Each thread writes to its own shard, so counting never shares a cache line
+// between threads; reads sum every live shard plus what exited threads left
+// behind. Latencies go to log-linear histograms (32 buckets per power of
+// two, about 3% resolution) per operation and backend, from which
+// percentiles are read without keeping samples.
+
+enum MetricCounter {
+    METRIC_ROWS_VISITED = 0,   // rows indexed or applied by the loaders
+    METRIC_PLAYER_ROWS,        // players rows read
+    METRIC_SET_ROWS,           // sets rows read
+    METRIC_GAMES_DECODED,      // games decoded from game_data
+    METRIC_CACHE_HITS,         // query results served from the QueryCache
+    METRIC_CACHE_MISSES,
+    METRIC_CACHE_EVICTIONS,
+    kMetricCounters
+};
+
+enum MetricOp {
+    METRIC_OP_EXACT_LOOKUP = 0,
+    METRIC_OP_PREFIX_SEARCH,
+    METRIC_OP_STATS_HYDRATION,
+    METRIC_OP_CHAR_AGGREGATE,
+    METRIC_OP_HEAD_TO_HEAD,
+    kMetricOps
+};
+
+// Structure that served the operation; names match the benchmark's
+enum MetricBackend {
+    METRIC_HASH = 0,
+    METRIC_TRIE,
+    METRIC_HASH_AND_TRIE,   // loaders that fill both
+    METRIC_COLUMNS,         // column store and matchup matrix
+    kMetricBackends
+};
+
+void Metrics_Add(MetricCounter counter, uint64_t n = 1);
+uint64_t Metrics_Counter(MetricCounter counter);
+void Metrics_RecordLatency(MetricOp op, MetricBackend backend, uint64_t ns);
+
+const char* Metrics_CounterName(MetricCounter counter);
+const char* Metrics_OpName(MetricOp op);
+const char* Metrics_BackendName(MetricBackend backend);
+
+struct LatencySummary {
+    MetricOp op;
+    MetricBackend backend;
+    uint64_t count = 0;
+    double mean_ns = 0;
+    uint64_t p50_ns = 0, p99_ns = 0, p999_ns = 0, max_ns = 0;
+    double ops_per_sec = 0;   // count over the time spent in the operation
+};
+// Every operation/backend pair recorded since the last reset
+std::vector<LatencySummary> Metrics_Latencies();
+// Seconds since start-up or the last reset
+double Metrics_WindowSeconds();
+// Counters and histograms count from zero again
+void Metrics_Reset();
+
+std::string Metrics_Json();
+bool Metrics_WriteJson(const std::string& path);
+
+// Records the lifetime of the scope as one operation
+class MetricTimer {
+public:
+    MetricTimer(MetricOp op, MetricBackend backend)
+        : _op(op), _backend(backend), _start(std::chrono::steady_clock::now()) {}
+    ~MetricTimer() {
+        Metrics_RecordLatency(_op, _backend, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - _start).count());
+    }
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+private:
+    MetricOp _op;
+    MetricBackend _backend;
+    std::chrono::steady_clock::time_point _start;
+};
@@ -0,0 +1,118 @@
+#include "pairs.h"
+#include <algorithm>
+
+bool SetPairIndex::pairOrder(const Set& a, const Set& b) {
+    PairKey ka = keyFor(a.p1, a.p2), kb = keyFor(b.p1, b.p2);
+    if (ka.lo != kb.lo) return ka.lo < kb.lo;
+    if (ka.hi != kb.hi) return ka.hi < kb.hi;
+    return a.rowid < b.rowid;
+}
+
+uint32_t SetPairIndex::internTournament(const std::string& name) {
+    auto it = _tournamentIndex.find(name);
+    if (it == _tournamentIndex.end()) {
+        it = _tournamentIndex.emplace(name, (uint32_t)_tournaments.size()).first;
+        _tournaments.push_back(name);
+    }
+    return it->second;
+}
+
+void SetPairIndex::Build(const std::vector<SetSummary>& sets) {
+    _sets.clear();
+    _dead = 0;
+    _ranges.clear();
+    _tournaments.clear();
+    _tournamentIndex.clear();
+    _sets.reserve(sets.size());
+
+    for (const SetSummary& s : sets) {
+        if (s.p1 == s.p2) continue;   // missing or identical players: not a pairing
+        _sets.push_back({s.rowid, s.p1, s.p2, s.winner, s.p1_score, s.p2_score, internTournament(s.tournament)});
+    }
+    std::sort(_sets.begin(), _sets.end(), pairOrder);
+
+    for (size_t i = 0; i < _sets.size(); ) {
+        PairKey k = keyFor(_sets[i].p1, _sets[i].p2);
+        size_t j = i + 1;
+        while (j < _sets.size() && keyFor(_sets[j].p1, _sets[j].p2) == k) ++j;
+        _ranges.emplace(k, std::make_pair((uint32_t)i, (uint32_t)j));
+        i = j;
+    }
+}
+
+void SetPairIndex::AddSets(const std::vector<SetSummary>& sets) {
+    std::vector<Set> added;
+    for (const SetSummary& s : sets) {
+        if (s.p1 == s.p2) continue;
+        added.push_back({s.rowid, s.p1, s.p2, s.winner, s.p1_score, s.p2_score, internTournament(s.tournament)});
+    }
+    std::sort(added.begin(), added.end(), pairOrder);
+
+    for (size_t i = 0; i < added.size(); ) {
+        PairKey k = keyFor(added[i].p1, added[i].p2);
+        size_t j = i + 1;
+        while (j < added.size() && keyFor(added[j].p1, added[j].p2) == k) ++j;
+        auto it = _ranges.find(k);
+        uint32_t first = (uint32_t)_sets.size();
+        if (it != _ranges.end() && it->second.second == _sets.size()) {
+            first = it->second.first;   // already the last run: extend in place
+        } else if (it != _ranges.end()) {
+            uint32_t lo = it->second.first, hi = it->second.second;
+            for (uint32_t p = lo; p < hi; ++p) _sets.push_back(_sets[p]);
+            _dead += hi - lo;
+        }
+        _sets.insert(_sets.end(), added.begin() + i, added.begin() + j);
+        _ranges[k] = std::make_pair(first, (uint32_t)_sets.size());
+        i = j;
+    }
+    if (_dead > _sets.size() / 2) compact();
+}
+
+// Drops the vacated slots, keeping each run contiguous
+void SetPairIndex::compact() {
+    std::vector<Set> live;
+    live.reserve(_sets.size() - _dead);
+    for (auto& kv : _ranges) {
+        uint32_t first = (uint32_t)live.size();
+        live.insert(live.end(), _sets.begin() + kv.second.first, _sets.begin() + kv.second.second);
+        kv.second = std::make_pair(first, (uint32_t)live.size());
+    }
+    _sets.swap(live);
+    _dead = 0;
+}
+
+std::pair<const SetPairIndex::Set*, const SetPairIndex::Set*>
+SetPairIndex::SetsBetween(long long a, long long b) const {
+    auto it = _ranges.find(keyFor(a, b));
+    if (it == _ranges.end()) return {nullptr, nullptr};
+    return {_sets.data() + it->second.first, _sets.data() + it->second.second};
+}
+
+SetPairIndex::HeadToHead SetPairIndex::Record(long long a, long long b) const {
+    HeadToHead h;
+    auto range = SetsBetween(a, b);
+    for (const Set* s = range.first; s != range.second; ++s) {
+        ++h.sets;
+        if (s->winner == a) ++h.set_wins_a;
+        else if (s->winner == b) ++h.set_wins_b;
+        int score_a = (s->p1 == a) ? s->p1_score : s->p2_score;
+        int score_b = (s->p1 == a) ? s->p2_score : s->p1_score;
+        h.games_a += std::max(score_a, 0);   // DQs are recorded as negative scores
+        h.games_b += std::max(score_b, 0);
+    }
+    return h;
+}
+
+void SetPairIndex::ForEachPair(const std::function<void(const Set*, const Set*)>& fn) const {
+    for (const auto& kv : _ranges)
+        fn(_sets.data() + kv.second.first, _sets.data() + kv.second.second);
+}
+
+size_t SetPairIndex::MemoryUsageBytes() const {
+    size_t total = _sets.capacity() * sizeof(Set)
+                 + _tournamentIndex.size() * (sizeof(std::string) + sizeof(uint32_t) + 2 * sizeof(void*))
+                 + _ranges.size() * (sizeof(PairKey) + sizeof(std::pair<uint32_t, uint32_t>) + 2 * sizeof(void*))
+                 + _ranges.bucket_count() * sizeof(void*);
+    for (const auto& t : _tournaments) total += sizeof(std::string) + t.capacity();
+    return total;
+}
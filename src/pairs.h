@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <functional>
+#include <cstdint>
+#include "backend.h"
+
+//--------------------------------------------------
+// Head-to-head index over the sets table
+//--------------------------------------------------
+// Sets are grouped by their unordered player pair (smaller ID first) in one
+// contiguous array; a hash map from the pair to its [begin, end) range makes
+// "every set between A and B" one probe, with no scan of the sets table.
+// Built from the SetSummary rows collected by the stats load. AddSets folds
+// in a refresh: a pair that gains sets has its run moved to the end of the
+// array, so the cost follows the new sets, and the holes left behind are
+// compacted once they make up half the array.
+
+class SetPairIndex {
+public:
+    struct Set {
+        long long rowid;
+        long long p1;
+        long long p2;
+        long long winner;
+        int p1_score;
+        int p2_score;
+        uint32_t tournament;   // index for Tournament()
+    };
+    // Totals from a's point of view versus b
+    struct HeadToHead {
+        int sets = 0;
+        int set_wins_a = 0;
+        int set_wins_b = 0;
+        int games_a = 0;       // summed from the set scores
+        int games_b = 0;
+    };
+
+    void Build(const std::vector<SetSummary>& sets);
+    // Sets newer (higher rowid) than everything already indexed
+    void AddSets(const std::vector<SetSummary>& sets);
+    // Sets between a and b in rowid order, as [first, last)
+    std::pair<const Set*, const Set*> SetsBetween(long long a, long long b) const;
+    HeadToHead Record(long long a, long long b) const;
+    // Every pair's sets as [first, last), pairs in no particular order
+    void ForEachPair(const std::function<void(const Set*, const Set*)>& fn) const;
+    const std::string& Tournament(uint32_t index) const { return _tournaments[index]; }
+
+    size_t SetCount() const { return _sets.size() - _dead; }
+    size_t PairCount() const { return _ranges.size(); }
+    size_t MemoryUsageBytes() const;
+private:
+    struct PairKey {
+        long long lo;
+        long long hi;
+        bool operator==(const PairKey& o) const { return lo == o.lo && hi == o.hi; }
+    };
+    struct PairKeyHash {
+        size_t operator()(const PairKey& k) const {
+            uint64_t h = (uint64_t)k.lo * 0x9E3779B97F4A7C15ull ^ ((uint64_t)k.hi + 0x632BE59BD9B4E019ull);
+            return (size_t)(h ^ (h >> 29));
+        }
+    };
+    static PairKey keyFor(long long a, long long b) { return a < b ? PairKey{a, b} : PairKey{b, a}; }
+    static bool pairOrder(const Set& a, const Set& b);
+    uint32_t internTournament(const std::string& name);
+    void compact();
+
+    std::vector<Set> _sets;   // grouped by pair, rowid order within a pair
+    size_t _dead = 0;         // slots vacated by runs that moved to the end
+    std::unordered_map<PairKey, std::pair<uint32_t, uint32_t>, PairKeyHash> _ranges;
+    std::vector<std::string> _tournaments;
+    std::unordered_map<std::string, uint32_t> _tournamentIndex;
+};
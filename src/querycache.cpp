@@ -0,0 +1,51 @@
+#include "querycache.h"
+#include "metrics.h"
+
+std::string QueryCache::keyFor(QueryKind kind, const std::string& params) {
+    std::string key(1, (char)kind);
+    key += '\n';
+    key += params;
+    return key;
+}
+
+void QueryCache::checkVersion(uint64_t version) {
+    if (version == _version) return;
+    Clear();
+    _version = version;
+}
+
+void QueryCache::Clear() {
+    _lru.clear();
+    _index.clear();
+}
+
+std::shared_ptr<const void> QueryCache::find(QueryKind kind, const std::string& params, uint64_t version) {
+    checkVersion(version);
+    auto it = _index.find(keyFor(kind, params));
+    if (it == _index.end()) {
+        Metrics_Add(METRIC_CACHE_MISSES);
+        return nullptr;
+    }
+    Metrics_Add(METRIC_CACHE_HITS);
+    _lru.splice(_lru.begin(), _lru, it->second);
+    return it->second->result;
+}
+
+void QueryCache::put(QueryKind kind, const std::string& params, uint64_t version, std::shared_ptr<const void> result) {
+    checkVersion(version);
+    if (_capacity == 0) return;
+    std::string key = keyFor(kind, params);
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+        it->second->result = std::move(result);
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return;
+    }
+    if (_lru.size() >= _capacity) {
+        _index.erase(_lru.back().key);
+        _lru.pop_back();
+        Metrics_Add(METRIC_CACHE_EVICTIONS);
+    }
+    _lru.push_front({key, std::move(result)});
+    _index.emplace(std::move(key), _lru.begin());
+}
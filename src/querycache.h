@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+//--------------------------------------------------
+// Bounded LRU cache of analytical query results
+//--------------------------------------------------
+// Results are keyed by query kind and normalized parameters within one
+// dataset version. The owner bumps the version whenever a load or refresh
+// replaces the data; the first lookup at a newer version drops every entry,
+// so a stale result is never returned. Hits, misses and evictions are counted
+// in the metrics module. Used from the GUI thread only.
+
+enum QueryKind {
+    QUERY_HEAD_TO_HEAD = 0,
+    QUERY_CHAR_MATCHUP,
+    QUERY_CHAR_ALL,
+    QUERY_STAGE
+};
+
+class QueryCache {
+public:
+    explicit QueryCache(size_t capacity = 64) : _capacity(capacity) {}
+
+    // Each kind always stores the same result type T
+    template<class T>
+    std::shared_ptr<const T> Find(QueryKind kind, const std::string& params, uint64_t version) {
+        return std::static_pointer_cast<const T>(find(kind, params, version));
+    }
+    template<class T>
+    void Put(QueryKind kind, const std::string& params, uint64_t version, std::shared_ptr<const T> result) {
+        put(kind, params, version, std::move(result));
+    }
+    void Clear();
+    size_t Size() const { return _lru.size(); }
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const void> result;
+    };
+    static std::string keyFor(QueryKind kind, const std::string& params);
+    void checkVersion(uint64_t version);
+    std::shared_ptr<const void> find(QueryKind kind, const std::string& params, uint64_t version);
+    void put(QueryKind kind, const std::string& params, uint64_t version, std::shared_ptr<const void> result);
+
+    size_t _capacity;
+    uint64_t _version = 0;
+    std::list<Entry> _lru;   // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+};
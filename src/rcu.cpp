@@ -0,0 +1,123 @@
+#include "rcu.h"
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// One slot per reader thread, on its own cache line so readers never share
+// a written line. epoch is the global epoch seen on entry, 0 when quiescent.
+struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> in_use{false};
+};
+
+const size_t kReaderSlots = 1024;
+ReaderSlot g_slots[kReaderSlots];
+std::atomic<size_t> g_slotHighWater{0};   // slots [0, high) have been handed out
+std::atomic<uint64_t> g_epoch{1};
+
+struct Retired {
+    uint64_t epoch;
+    std::function<void()> free_fn;
+};
+std::mutex g_retireMut;
+std::vector<Retired> g_retired;
+
+ReaderSlot* acquireSlot() {
+    for (;;) {
+        for (size_t i = 0; i < kReaderSlots; ++i) {
+            bool expected = false;
+            if (!g_slots[i].in_use.load(std::memory_order_relaxed) &&
+                g_slots[i].in_use.compare_exchange_strong(expected, true)) {
+                size_t hw = g_slotHighWater.load();
+                while (hw < i + 1 && !g_slotHighWater.compare_exchange_weak(hw, i + 1)) {}
+                return &g_slots[i];
+            }
+        }
+        // Every slot taken: wait for a reader thread to exit
+        std::this_thread::yield();
+    }
+}
+
+struct ThreadReader {
+    ReaderSlot* slot = nullptr;
+    unsigned depth = 0;
+    ~ThreadReader() {
+        if (!slot) return;
+        slot->epoch.store(0);
+        slot->in_use.store(false, std::memory_order_release);
+    }
+};
+thread_local ThreadReader t_reader;
+
+uint64_t minActiveEpoch() {
+    uint64_t m = std::numeric_limits<uint64_t>::max();
+    size_t hw = g_slotHighWater.load(std::memory_order_acquire);
+    for (size_t i = 0; i < hw; ++i) {
+        uint64_t e = g_slots[i].epoch.load(std::memory_order_seq_cst);
+        if (e != 0 && e < m) m = e;
+    }
+    return m;
+}
+
+// Moves every retired entry no reader can still see into ready; g_retireMut held
+void collect(std::vector<std::function<void()>>& ready) {
+    uint64_t oldest = minActiveEpoch();
+    size_t keep = 0;
+    for (size_t i = 0; i < g_retired.size(); ++i) {
+        if (g_retired[i].epoch < oldest)
+            ready.push_back(std::move(g_retired[i].free_fn));
+        else
+            g_retired[keep++] = std::move(g_retired[i]);
+    }
+    g_retired.resize(keep);
+}
+
+} // namespace
+
+RcuReadGuard::RcuReadGuard() {
+    ThreadReader& t = t_reader;
+    if (t.depth++ > 0) return;
+    if (!t.slot) t.slot = acquireSlot();
+    // The seq_cst store orders the announcement before any pointer the caller loads next
+    t.slot->epoch.store(g_epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+}
+
+RcuReadGuard::~RcuReadGuard() {
+    ThreadReader& t = t_reader;
+    if (--t.depth == 0) t.slot->epoch.store(0, std::memory_order_release);
+}
+
+void Rcu_Retire(std::function<void()> free_fn) {
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(g_retireMut);
+        // Readers that could hold the unpublished version announced an epoch <= e
+        uint64_t e = g_epoch.fetch_add(1);
+        g_retired.push_back({e, std::move(free_fn)});
+        collect(ready);
+    }
+    for (auto& fn : ready) fn();
+}
+
+void Rcu_Synchronize() {
+    for (;;) {
+        std::vector<std::function<void()>> ready;
+        bool empty;
+        {
+            std::lock_guard<std::mutex> lock(g_retireMut);
+            collect(ready);
+            empty = g_retired.empty();
+        }
+        for (auto& fn : ready) fn();
+        if (empty) return;
+        std::this_thread::yield();
+    }
+}
+
+size_t Rcu_PendingRetired() {
+    std::lock_guard<std::mutex> lock(g_retireMut);
+    return g_retired.size();
+}
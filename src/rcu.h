@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+//--------------------------------------------------
+// Epoch-based read-copy-update for the player indexes
+//--------------------------------------------------
+// Readers enter a read-side section (RcuReadGuard) and load the published
+// version of a structure without taking any lock. Writers stage changes in a
+// private copy and publish it with one atomic swap; the version it replaces
+// is retired and freed once every reader that could still see it has left
+// its read-side section.
+
+// Read-side section; nests, and costs one store on entry and exit
+class RcuReadGuard {
+public:
+    RcuReadGuard();
+    ~RcuReadGuard();
+    RcuReadGuard(const RcuReadGuard&) = delete;
+    RcuReadGuard& operator=(const RcuReadGuard&) = delete;
+};
+
+// Run free_fn once no reader can still observe what it frees
+void Rcu_Retire(std::function<void()> free_fn);
+// Blocks until everything retired so far has been freed
+void Rcu_Synchronize();
+// Retired versions still waiting for readers to move on
+size_t Rcu_PendingRetired();
+
+// One published, immutable T plus a writer-private staging copy.
+// Read() needs an RcuReadGuard held by the caller; Write()/Fresh()/Publish()
+// need WriteMutex() held. make builds the initial and every Fresh() version,
+// for types that need constructor arguments.
+template <typename T>
+class RcuCell {
+public:
+    explicit RcuCell(std::function<T*()> make = []() { return new T(); })
+        : make_(std::move(make)), published_(make_()) {}
+    ~RcuCell() {
+        // The owner guarantees no readers remain
+        delete staging_;
+        delete published_.load();
+    }
+    RcuCell(const RcuCell&) = delete;
+    RcuCell& operator=(const RcuCell&) = delete;
+
+    // seq_cst, like the reader's epoch announcement, so the load cannot move
+    // ahead of it and miss a version Rcu_Synchronize is about to free
+    const T* Read() const { return published_.load(std::memory_order_seq_cst); }
+
+    // Staged copy of the published version, cloned on the first write after a publish
+    T& Write() {
+        if (!staging_) staging_ = new T(*published_.load(std::memory_order_relaxed));
+        return *staging_;
+    }
+    // Empty staged version, for writers that rebuild from scratch
+    T& Fresh() {
+        delete staging_;
+        staging_ = make_();
+        return *staging_;
+    }
+    bool Dirty() const { return staging_ != nullptr; }
+
+    void Publish() {
+        if (!staging_) return;
+        T* old = published_.exchange(staging_, std::memory_order_seq_cst);
+        staging_ = nullptr;
+        Rcu_Retire([old]() { delete old; });
+    }
+
+    std::mutex& WriteMutex() const { return write_mut_; }
+private:
+    std::function<T*()> make_;
+    std::atomic<T*> published_;
+    T* staging_ = nullptr;
+    mutable std::mutex write_mut_;
+};
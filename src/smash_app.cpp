@@ -1,23 +1,288 @@
 #include "smash_app.h"
+#include "snapshot.h"
+#include "fuzzy.h"
+#include "columns.h"
+#include "pairs.h"
+#include "stages.h"
+#include "matchups.h"
+#include "metrics.h"
+#include "exporter.h"
 #include <wx/filedlg.h>
 #include <wx/artprov.h>
+#include <wx/textcompleter.h>
 #include <algorithm>
+#include <numeric>
 #include <set>
-#include <map>
-#include <tuple>
+#include <iostream>
+#include <chrono>
+#include <limits>
+#include <cstdlib>
 
 bool setsLoaded = false;
 
+wxDEFINE_EVENT(EVT_LOAD_PROGRESS, wxThreadEvent);
+wxDEFINE_EVENT(EVT_LOAD_DONE, wxThreadEvent);
+
 enum {
-    ID_ExportResults = wxID_HIGHEST + 1,
+    ID_ExportPlayers = wxID_HIGHEST + 1,
+    ID_ExportMatchups,
+    ID_ExportHeadToHead,
 };
 
 wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
-    EVT_MENU(ID_ExportResults, MainFrame::OnMenuExport)
+    EVT_MENU(ID_ExportPlayers,    MainFrame::OnMenuExport)
+    EVT_MENU(ID_ExportMatchups,   MainFrame::OnMenuExport)
+    EVT_MENU(ID_ExportHeadToHead, MainFrame::OnMenuExport)
     EVT_MENU(wxID_EXIT,        MainFrame::OnMenuExit)
     EVT_MENU(wxID_ABOUT,       MainFrame::OnAbout)
 wxEND_EVENT_TABLE()
 
+// Search-as-you-type for the player tag boxes: the most active players whose tag
+// starts with the typed text. wxMSW may ask for completions from a worker thread,
+// so the trie is fetched with atomic_load and queried lock-free.
+class PlayerTagCompleter : public wxTextCompleterSimple {
+public:
+    explicit PlayerTagCompleter(const std::shared_ptr<PlayerTrie>* trie) : m_trie(trie) {}
+    void GetCompletions(const wxString& prefix, wxArrayString& res) override {
+        std::shared_ptr<PlayerTrie> trie = std::atomic_load(m_trie);
+        if (!trie || prefix.empty()) return;
+        RcuReadGuard guard;
+        std::vector<const PlayerRecord*> top;
+        {
+            MetricTimer timer(METRIC_OP_PREFIX_SEARCH, METRIC_TRIE);
+            top = trie->TopKByPrefix(std::string(prefix.utf8_str()), kSuggestions);
+        }
+        for (const PlayerRecord* rec : top)
+            res.Add(wxString::FromUTF8(rec->name));
+    }
+private:
+    static const size_t kSuggestions = 10;
+    const std::shared_ptr<PlayerTrie>* m_trie;
+};
+
+// Report list that holds no rows of its own: the control asks for the cells
+// it is about to draw, and a header click sorts an index over the rows rather
+// than the rows themselves. Rows only move within their group, so section
+// headings stay above their section.
+class VirtualResultList : public wxListCtrl {
+public:
+    explicit VirtualResultList(wxWindow* parent)
+        : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize,
+                     wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL | wxLC_HRULES | wxLC_VRULES) {
+        Bind(wxEVT_LIST_COL_CLICK, &VirtualResultList::OnColClick, this);
+    }
+    void ClearRows() {
+        ReleaseRows();
+        ShowRows(0);
+    }
+    // A single line in the first column in place of any rows
+    void ShowMessage(const wxString& message) {
+        ReleaseRows();
+        m_message = message;
+        m_order.clear();
+        SetItemCount(1);
+        Refresh();
+    }
+
+protected:
+    // Called by derived lists after they replace their rows; the current sort is kept
+    void ShowRows(size_t rows) {
+        m_message.clear();
+        m_order.resize(rows);
+        std::iota(m_order.begin(), m_order.end(), 0u);
+        if (m_sortColumn >= 0) SortOrder();
+        SetItemCount((long)rows);
+        Refresh();
+    }
+    virtual wxString CellText(size_t row, long column) const = 0;
+    virtual bool Less(size_t a, size_t b, int column) const = 0;
+    virtual int Group(size_t) const { return 0; }
+    // Drops the rows once nothing is shown from them
+    virtual void ReleaseRows() {}
+
+private:
+    wxString OnGetItemText(long item, long column) const override {
+        if (!m_message.empty()) return column == 0 ? m_message : wxString();
+        return CellText(m_order[item], column);
+    }
+    void OnColClick(wxListEvent& event) {
+        int column = event.GetColumn();
+        if (column < 0 || m_order.empty()) return;
+        m_ascending = column == m_sortColumn ? !m_ascending : true;
+        m_sortColumn = column;
+        SortOrder();
+        Refresh();
+    }
+    void SortOrder() {
+        std::stable_sort(m_order.begin(), m_order.end(), [this](uint32_t a, uint32_t b) {
+            int ga = Group(a), gb = Group(b);
+            if (ga != gb) return ga < gb;
+            return m_ascending ? Less(a, b, m_sortColumn) : Less(b, a, m_sortColumn);
+        });
+    }
+
+    std::vector<uint32_t> m_order;   // displayed line -> row
+    wxString m_message;
+    int m_sortColumn = -1;
+    bool m_ascending = true;
+};
+
+// Player Stats results: ID, name, main, played, won, win rate. Rows point
+// into the structure they were read from; the pins keep those records alive
+// and unchanged while they are listed.
+class PlayerResultList : public VirtualResultList {
+public:
+    using VirtualResultList::VirtualResultList;
+    void SetRecords(std::vector<const PlayerRecord*> records, std::vector<RecordPin> pins) {
+        m_records = std::move(records);
+        m_pins = std::move(pins);
+        ShowRows(m_records.size());
+    }
+
+private:
+    void ReleaseRows() override {
+        m_records.clear();
+        m_pins.clear();
+    }
+    wxString CellText(size_t row, long column) const override {
+        const PlayerRecord& rec = *m_records[row];
+        switch (column) {
+            case 0: return rec.id;
+            case 1: return wxString::FromUTF8(rec.name);
+            case 2: return wxString::FromUTF8(rec.main_character.c_str());
+            case 3: return wxString::Format("%d", rec.matches_played);
+            case 4: return wxString::Format("%d", rec.matches_won);
+            case 5: return wxString::Format("%.2f", rec.win_rate*100.0);
+        }
+        return wxString();
+    }
+    bool Less(size_t a, size_t b, int column) const override {
+        const PlayerRecord& x = *m_records[a];
+        const PlayerRecord& y = *m_records[b];
+        switch (column) {
+            case 0:   // IDs are decimal numbers
+                return x.id.size() != y.id.size() ? x.id.size() < y.id.size() : x.id < y.id;
+            case 1: return x.name < y.name;
+            case 2: return x.main_character.str() < y.main_character.str();
+            case 3: return x.matches_played < y.matches_played;
+            case 4: return x.matches_won < y.matches_won;
+            case 5: return x.win_rate < y.win_rate;
+        }
+        return false;
+    }
+
+    std::vector<const PlayerRecord*> m_records;
+    std::vector<RecordPin> m_pins;
+};
+
+// Stage Analysis results: a label, an optional win rate and a game count.
+// Each heading starts a group, so sorting reorders only the rows under it.
+struct StageRows {
+    struct Row {
+        wxString label;
+        double rate;      // negative when the row has none
+        uint64_t games;   // 0 when the row has none
+        int group;
+    };
+    std::vector<Row> rows;
+    int group = 0;
+
+    void AddHeading(const wxString& label, uint64_t games = 0) {
+        group += 2;
+        rows.push_back({label, -1.0, games, group});
+    }
+    void AddRow(const wxString& label, double rate, uint64_t games) {
+        rows.push_back({label, rate, games, group + 1});
+    }
+};
+
+class StageResultList : public VirtualResultList {
+public:
+    using VirtualResultList::VirtualResultList;
+    void SetRows(std::shared_ptr<const StageRows> rows) {
+        m_rows = std::move(rows);
+        ShowRows(m_rows->rows.size());
+    }
+
+private:
+    using Row = StageRows::Row;
+    wxString CellText(size_t row, long column) const override {
+        const Row& r = m_rows->rows[row];
+        if (column == 0) return r.label;
+        if (column == 1) return r.rate >= 0 ? wxString::Format("%.2f", r.rate*100.0) : wxString();
+        if (column == 2) return r.games > 0 ? wxString::Format("%llu", (unsigned long long)r.games) : wxString();
+        return wxString();
+    }
+    bool Less(size_t a, size_t b, int column) const override {
+        const Row& x = m_rows->rows[a];
+        const Row& y = m_rows->rows[b];
+        if (column == 0) return x.label.CmpNoCase(y.label) < 0;
+        if (column == 1) return x.rate < y.rate;
+        return x.games < y.games;
+    }
+    int Group(size_t row) const override { return m_rows->rows[row].group; }
+
+    std::shared_ptr<const StageRows> m_rows;
+};
+
+// Cached results of the analytical tabs (see QueryCache)
+struct HeadToHeadResult {
+    bool found = false;
+    PlayerRecord rec1, rec2;
+    bool hasPairs = false;
+    long long id1 = 0, id2 = 0;
+    SetPairIndex::HeadToHead h2h;
+    std::vector<SetPairIndex::Set> sets;   // between the two, in rowid order
+};
+struct CharMatchupResult {
+    bool found = false;
+    std::string name1, name2;
+    MatchupMatrix::Totals ab, ba;
+    PlayerColumns::Totals t1, t2;
+};
+
+// Character and stage names match case-insensitively (ASCII only, as in
+// the indexes), so they are cached under their lowercase form
+static std::string cacheKeyLower(std::string s) {
+    for (char& c : s) c = (char)std::tolower((unsigned char)c);
+    return s;
+}
+
+// Read-only indexes derived from the hydrated players and sets, rebuilt with the stats
+struct DerivedIndexes {
+    std::shared_ptr<PlayerFuzzyIndex> fuzzy;
+    std::shared_ptr<PlayerColumns> columns;
+    std::shared_ptr<SetPairIndex> pairs;
+    std::shared_ptr<StageIndex> stages;
+    std::shared_ptr<MatchupMatrix> matchups;
+};
+static DerivedIndexes buildDerivedIndexes(const PlayerHashTable& hash, const std::vector<SetSummary>& sets,
+                                          const GameTable& games) {
+    DerivedIndexes out;
+    out.fuzzy = std::make_shared<PlayerFuzzyIndex>();
+    out.fuzzy->Build(hash);
+    out.columns = std::make_shared<PlayerColumns>();
+    out.columns->Build(hash);
+    out.pairs = std::make_shared<SetPairIndex>();
+    out.pairs->Build(sets);
+    out.stages = std::make_shared<StageIndex>();
+    out.stages->Build(games);
+    out.matchups = std::make_shared<MatchupMatrix>();
+    out.matchups->Build(games, Backend_GetLoaderThreads());
+    return out;
+}
+
+static double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+static uint64_t nsSince(std::chrono::steady_clock::time_point start) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+// Queries that go through FindPlayer are served by the selected structure
+static MetricBackend metricBackend(DataStructureChoice ds) {
+    return ds == HASH_TABLE ? METRIC_HASH : METRIC_TRIE;
+}
+
 bool SmashApp::OnInit() {
     MainFrame* frame = new MainFrame("Smash Ultimate Data Analysis Tool");
     frame->Show(true);
@@ -26,10 +291,13 @@ bool SmashApp::OnInit() {
 
 MainFrame::MainFrame(const wxString& title)
     : wxFrame(nullptr, wxID_ANY, title, wxDefaultPosition, wxSize(1200,700)),
-      playerHash(), playerTrie(), currentDS(HASH_TABLE), m_loadingDialog(nullptr)
+      playerHash(std::make_shared<PlayerHashTable>()), playerTrie(std::make_shared<PlayerTrie>()),
+      currentDS(HASH_TABLE), m_loadingDialog(nullptr)
 {
     wxMenu* fileMenu = new wxMenu;
-    fileMenu->Append(ID_ExportResults, "&Export Query Results...");
+    fileMenu->Append(ID_ExportPlayers, "&Export Players...");
+    fileMenu->Append(ID_ExportMatchups, "Export Character &Matchups...");
+    fileMenu->Append(ID_ExportHeadToHead, "Export &Head-to-Head Sets...");
     fileMenu->AppendSeparator();
     fileMenu->Append(wxID_EXIT, "E&xit");
 
@@ -49,6 +317,8 @@ MainFrame::MainFrame(const wxString& title)
     notebook->AddPage(CreateHeadToHeadPanel(notebook),          "Head-to-Head");
     notebook->AddPage(CreateCharacterMatchupPanel(notebook),    "Character Matchups");
     notebook->AddPage(CreateStageAnalysisPanel(notebook),       "Stage Analysis");
+    notebook->AddPage(CreateMetricsPanel(notebook),             "Metrics");
+    notebook->Bind(wxEVT_NOTEBOOK_PAGE_CHANGED, &MainFrame::OnPageChanged, this);
 
     CreateStatusBar(2);
     SetStatusText("Welcome to Smash Analyzer!");
@@ -56,36 +326,238 @@ MainFrame::MainFrame(const wxString& title)
     SetStatusText("Loaded DB: " + dbPath, 0);
     UpdateVisitedRowsCounter();
 
+    Bind(EVT_LOAD_PROGRESS, &MainFrame::OnLoadProgress, this);
+    Bind(EVT_LOAD_DONE, &MainFrame::OnLoadDone, this);
+    Bind(wxEVT_CLOSE_WINDOW, &MainFrame::OnClose, this);
+
     setsLoaded = false;
+    CallAfter([this]() { LoadStartupSnapshot(); });
+}
+
+// Map the snapshot written by the last stats load, if it still matches the DB.
+// Runs once the window is up, in two jobs: the hash table and trie are
+// rebuilt from the snapshot and swapped in first, so player searches work
+// straight away, then the sets and games are read back for the derived
+// indexes. Only the tabs built on those wait for the second job (see
+// SetIndexesReady). A stale snapshot is rebuilt by a background stats load;
+// without one the app starts empty.
+void MainFrame::LoadStartupSnapshot() {
+    std::string path = dbPath.ToStdString();
+    if (!wxFileExists(wxString::FromUTF8(BackendSnapshot_PathFor(path)))) return;
+    struct Loaded {
+        std::shared_ptr<PlayerHashTable> hash;
+        std::shared_ptr<PlayerTrie> trie;
+        HighWaterMarks marks;
+        SnapshotStatus status = SNAPSHOT_MISSING;
+        long snapshotMs = 0;
+    };
+    auto res = std::make_shared<Loaded>();
+
+    auto work = [path, res](LoadMonitor& monitor) {
+        wxStopWatch watch;
+        res->hash = std::make_shared<PlayerHashTable>();
+        res->trie = std::make_shared<PlayerTrie>();
+        monitor.BeginPhase("Mapping snapshot", 0);
+        res->status = BackendSnapshot_Load(path, *res->hash, *res->trie, &res->marks);
+        res->snapshotMs = watch.Time();
+        return res->status == SNAPSHOT_OK && !monitor.Cancelled();
+    };
+
+    auto done = [this, res](bool ok, bool cancelled) {
+        if (cancelled) return;
+        if (res->status == SNAPSHOT_STALE) {
+            SetStatusText("Snapshot is out of date; rebuilding...", 0);
+            CallAfter([this]() { StartSetsLoad(false); });
+            return;
+        }
+        if (!ok) return;
+        playerHash = res->hash;
+        std::atomic_store(&playerTrie, res->trie);
+        loadMarks = res->marks;
+        setsLoaded = true;
+        ++dataVersion;
+        SetStatusText(wxString::Format("Loaded snapshot of %s in %ld ms; building set indexes...",
+            dbPath, res->snapshotMs), 0);
+        LoadSnapshotIndexes(res->marks, res->snapshotMs);
+    };
+
+    StartLoadJob("Loading snapshot...", work, done);
+}
+
+// Second startup job: the derived indexes, from the sets and games of the
+// snapshot the players came from. The job blocks refreshes, so nothing moves
+// the players or the snapshot past marks meanwhile; if the snapshot has moved
+// anyway, everything is reloaded from the database.
+void MainFrame::LoadSnapshotIndexes(const HighWaterMarks& marks, long snapshotMs) {
+    std::string path = dbPath.ToStdString();
+    struct Built {
+        std::shared_ptr<PlayerHashTable> hash;
+        DerivedIndexes derived;
+        long indexesMs = 0;
+    };
+    auto res = std::make_shared<Built>();
+    res->hash = playerHash;
+
+    auto work = [path, marks, res](LoadMonitor& monitor) {
+        wxStopWatch watch;
+        std::vector<SetSummary> sets;
+        GameTable games;
+        monitor.BeginPhase("Reading sets", 0);
+        if (BackendSnapshot_LoadSets(path, marks, sets, games) != SNAPSHOT_OK || monitor.Cancelled())
+            return false;
+        monitor.BeginPhase("Building indexes", 0);
+        res->derived = buildDerivedIndexes(*res->hash, sets, games);
+        res->indexesMs = watch.Time();
+        return true;
+    };
+
+    auto done = [this, res, snapshotMs](bool ok, bool cancelled) {
+        if (res->hash != playerHash) return;
+        if (cancelled) {
+            SetStatusText("Set indexes not built; press 'Load Sets' for head-to-head, character and stage data.", 0);
+            return;
+        }
+        if (!ok) {
+            SetStatusText("Snapshot sets could not be read; rebuilding...", 0);
+            CallAfter([this]() { StartSetsLoad(false); });
+            return;
+        }
+        playerFuzzy = res->derived.fuzzy;
+        playerColumns = res->derived.columns;
+        playerPairs = res->derived.pairs;
+        stageIndex = res->derived.stages;
+        matchupMatrix = res->derived.matchups;
+        ++dataVersion;
+        SetStatusText(wxString::Format("Loaded snapshot of %s in %ld ms (indexes %ld ms)",
+            dbPath, snapshotMs, res->indexesMs), 0);
+    };
+
+    StartLoadJob("Building set indexes...", work, done);
+}
+
+// Head-to-head, character and stage queries need the set-level indexes,
+// which a startup from the snapshot builds after the players are searchable
+bool MainFrame::SetIndexesReady() {
+    if (playerPairs && stageIndex && matchupMatrix) return true;
+    if (m_loadThread.joinable())
+        wxMessageBox("The set indexes are still being built. Try again once the load finishes.",
+            "Indexes Not Ready", wxOK|wxICON_INFORMATION, this);
+    else
+        wxMessageBox("The set indexes were not built. Press 'Load Sets' to build them.",
+            "Indexes Not Ready", wxOK|wxICON_WARNING, this);
+    return false;
+}
+
+MainFrame::~MainFrame() {
+    if (m_loadThread.joinable()) {
+        m_loadMonitor->Cancel();
+        m_loadThread.join();
+    }
 }
 
 //----------------- Visited Rows (Backend global version) --------------
 void MainFrame::UpdateVisitedRowsCounter() {
-    SetStatusText(wxString::Format("Rows Visited: %zu", Backend_GetTotalRowsVisited()), 1);
+    SetStatusText(wxString::Format("Rows Visited: %zu (last load: %zu rows, %.1f ms)",
+        Backend_GetTotalRowsVisited(), Backend_GetLastRowsScanned(), Backend_GetLastLoadMillis()), 1);
 }
 
 //---------------- BUSY/LOADING HANDLING ----------------
 void MainFrame::BusyStart(const wxString& label) {
     if (!m_loadingDialog) {
-        m_loadingDialog = new wxDialog(this, wxID_ANY, label, wxDefaultPosition, wxSize(280,80),
+        m_loadingDialog = new wxDialog(this, wxID_ANY, label, wxDefaultPosition, wxSize(360,150),
                                       wxSTAY_ON_TOP|wxCAPTION|wxDIALOG_NO_PARENT);
         auto* box = new wxBoxSizer(wxVERTICAL);
-        box->Add(new wxStaticText(m_loadingDialog, wxID_ANY, label));
-        auto* gauge = new wxGauge(m_loadingDialog, wxID_ANY, 100);
-        box->Add(gauge, 1, wxEXPAND | wxALL, 10);
+        box->Add(new wxStaticText(m_loadingDialog, wxID_ANY, label), 0, wxLEFT|wxRIGHT|wxTOP, 10);
+        m_loadingGauge = new wxGauge(m_loadingDialog, wxID_ANY, 100);
+        box->Add(m_loadingGauge, 0, wxEXPAND | wxALL, 10);
+        m_loadingText = new wxStaticText(m_loadingDialog, wxID_ANY, "Starting...");
+        box->Add(m_loadingText, 0, wxEXPAND | wxLEFT|wxRIGHT, 10);
+        auto* cancelBtn = new wxButton(m_loadingDialog, wxID_ANY, "Cancel");
+        cancelBtn->Bind(wxEVT_BUTTON, &MainFrame::OnLoadCancel, this);
+        box->Add(cancelBtn, 0, wxALIGN_RIGHT | wxALL, 10);
         m_loadingDialog->SetSizer(box);
     }
     m_loadingDialog->Raise();
     m_loadingDialog->Show();
     m_loadingDialog->Update();
-    wxYield();
 }
 void MainFrame::BusyEnd() {
     if (m_loadingDialog) {
         m_loadingDialog->Hide();
-        delete m_loadingDialog;
+        m_loadingDialog->Destroy();
         m_loadingDialog = nullptr;
+        m_loadingGauge = nullptr;
+        m_loadingText = nullptr;
+    }
+}
+
+//---------------- BACKGROUND LOAD JOBS ----------------
+bool MainFrame::StartLoadJob(const wxString& label,
+                             std::function<bool(LoadMonitor&)> work,
+                             std::function<void(bool, bool)> done)
+{
+    if (m_loadThread.joinable()) {
+        wxMessageBox("A load is already running. Wait for it to finish or cancel it first.",
+            "Busy", wxOK|wxICON_WARNING, this);
+        return false;
+    }
+    m_loadMonitor = std::make_shared<LoadMonitor>([this](const LoadProgress& p) {
+        wxThreadEvent* evt = new wxThreadEvent(EVT_LOAD_PROGRESS);
+        evt->SetPayload(p);
+        wxQueueEvent(this, evt);
+    });
+    m_loadDone = std::move(done);
+    BusyStart(label);
+
+    std::shared_ptr<LoadMonitor> monitor = m_loadMonitor;
+    m_loadThread = std::thread([this, monitor, work]() {
+        bool ok = work(*monitor);
+        wxThreadEvent* evt = new wxThreadEvent(EVT_LOAD_DONE);
+        evt->SetInt(ok ? 1 : 0);
+        wxQueueEvent(this, evt);
+    });
+    return true;
+}
+
+void MainFrame::OnLoadProgress(wxThreadEvent& event) {
+    LoadProgress p = event.GetPayload<LoadProgress>();
+    if (m_loadingGauge) {
+        if (p.total > 0)
+            m_loadingGauge->SetValue((int)std::min<size_t>(100, p.rows * 100 / p.total));
+        else
+            m_loadingGauge->Pulse();
     }
+    wxString text = wxString::Format("%s: %zu rows (%.0f rows/s)", p.phase.c_str(), p.rows, p.rows_per_sec);
+    if (m_loadingText) m_loadingText->SetLabel(text);
+    SetStatusText(text, 0);
+}
+
+void MainFrame::OnLoadDone(wxThreadEvent& event) {
+    if (m_loadThread.joinable()) m_loadThread.join();
+    bool cancelled = m_loadMonitor && m_loadMonitor->Cancelled();
+    bool ok = event.GetInt() == 1 && !cancelled;
+    auto done = std::move(m_loadDone);
+    m_loadDone = nullptr;
+    m_loadMonitor.reset();
+    BusyEnd();
+
+    if (cancelled) SetStatusText("Load cancelled; previous data kept.", 0);
+    else           SetStatusText("Loaded DB: " + dbPath, 0);
+    if (done) done(ok, cancelled);
+    UpdateVisitedRowsCounter();
+}
+
+void MainFrame::OnLoadCancel(wxCommandEvent&) {
+    if (m_loadMonitor) m_loadMonitor->Cancel();
+    if (m_loadingText) m_loadingText->SetLabel("Cancelling...");
+}
+
+void MainFrame::OnClose(wxCloseEvent& event) {
+    if (m_loadThread.joinable()) {
+        m_loadMonitor->Cancel();
+        m_loadThread.join();
+    }
+    event.Skip();
 }
 void MainFrame::SetEfficiency(wxStaticText* label, double ms) {
     if (ms < 1.0)
@@ -94,6 +566,41 @@ void MainFrame::SetEfficiency(wxStaticText* label, double ms) {
         label->SetLabel(wxString::Format("Efficiency: %.2f ms", ms));
 }
 
+// Average wall time of lookup(key) over all keys, in nanoseconds
+template <typename Fn>
+static double nsPerLookup(const std::vector<std::string>& keys, Fn lookup) {
+    if (keys.empty()) return 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& k : keys)
+        lookup(k);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / keys.size();
+}
+
+// Aggregate lookups per second (millions) with `threads` readers each walking
+// every key from its own starting offset; each reader holds one RcuReadGuard.
+template <typename Fn>
+static double lookupMops(unsigned threads, const std::vector<std::string>& keys, Fn lookup) {
+    if (keys.empty() || threads == 0) return 0.0;
+    const size_t rounds = 4;
+    std::atomic<size_t> hits{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> readers;
+    for (unsigned t = 0; t < threads; ++t) {
+        readers.emplace_back([&, t]() {
+            RcuReadGuard guard;
+            size_t found = 0, n = keys.size(), offset = n * t / threads;
+            for (size_t r = 0; r < rounds; ++r)
+                for (size_t i = 0; i < n; ++i)
+                    found += lookup(keys[(offset + i) % n]) != nullptr;
+            hits += found;
+        });
+    }
+    for (auto& th : readers) th.join();
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() > 0 ? (double)threads * rounds * keys.size() / elapsed.count() : 0.0;
+}
+
 //------------------ LOAD DATA TAB ----------------------
 wxPanel* MainFrame::CreateLoadDataPanel(wxWindow* parent) {
     wxPanel* panel = new wxPanel(parent);
@@ -101,7 +608,10 @@ wxPanel* MainFrame::CreateLoadDataPanel(wxWindow* parent) {
 
     auto* desc = new wxStaticText(panel, wxID_ANY,
         "Load the database and benchmark performance of data structures (Hash Table vs Trie):\n"
-        "- Build/load time\n- Memory usage (if available)");
+        "- Build/load time\n- Memory usage (if available)\n"
+        "- Radix-tree trie vs the old 128-way trie (memory, exact lookup)\n"
+        "- Loader thread scaling (players/sets split into rowid ranges, one read-only connection per thread)\n"
+        "- Lock-free lookup throughput from 1, 2, 4, ... reader threads");
     vbox->Add(desc, 0, wxEXPAND | wxALL, 10);
 
     // Add choice for DS type
@@ -113,7 +623,13 @@ wxPanel* MainFrame::CreateLoadDataPanel(wxWindow* parent) {
     m_perfDSChoice->SetSelection(2);
     hbox->Add(m_perfDSChoice, 0, wxALIGN_CENTER_VERTICAL|wxRIGHT, 10);
     m_perfRunBtn = new wxButton(panel, wxID_ANY, "Load Database and Benchmark");
-    hbox->Add(m_perfRunBtn, 0, wxALIGN_CENTER_VERTICAL);
+    hbox->Add(m_perfRunBtn, 0, wxALIGN_CENTER_VERTICAL|wxRIGHT, 20);
+    hbox->Add(new wxStaticText(panel, wxID_ANY, "Loader Threads:"), 0, wxALIGN_CENTER_VERTICAL|wxRIGHT, 5);
+    m_perfThreadsSpin = new wxSpinCtrl(panel, wxID_ANY, wxEmptyString, wxDefaultPosition, wxSize(70,-1),
+                                       wxSP_ARROW_KEYS, 1, 256, (int)Backend_GetLoaderThreads());
+    hbox->Add(m_perfThreadsSpin, 0, wxALIGN_CENTER_VERTICAL|wxRIGHT, 10);
+    m_perfScaleBtn = new wxButton(panel, wxID_ANY, "Thread Scaling");
+    hbox->Add(m_perfScaleBtn, 0, wxALIGN_CENTER_VERTICAL);
 
     vbox->Add(hbox, 0, wxALIGN_LEFT | wxALL, 10);
 
@@ -128,15 +644,109 @@ wxPanel* MainFrame::CreateLoadDataPanel(wxWindow* parent) {
     m_perfResultList->InsertColumn(0, "Metric", wxLIST_FORMAT_LEFT, 250);
     m_perfResultList->InsertColumn(1, "Hash Table", wxLIST_FORMAT_LEFT, 120);
     m_perfResultList->InsertColumn(2, "Trie", wxLIST_FORMAT_LEFT, 120);
+    m_perfResultList->InsertColumn(3, "Old 128-way Trie", wxLIST_FORMAT_LEFT, 140);
     vbox->Add(m_perfResultList, 1, wxEXPAND | wxLEFT|wxRIGHT|wxBOTTOM, 10);
 
     panel->SetSizer(vbox);
 
     m_perfDSChoice->Bind(wxEVT_CHOICE, &MainFrame::OnPerfDSChoice, this);
     m_perfRunBtn->Bind(wxEVT_BUTTON, &MainFrame::OnPerfRun, this);
+    m_perfThreadsSpin->Bind(wxEVT_SPINCTRL, &MainFrame::OnPerfThreads, this);
+    m_perfScaleBtn->Bind(wxEVT_BUTTON, &MainFrame::OnPerfScale, this);
     return panel;
 }
 
+void MainFrame::OnPerfThreads(wxSpinEvent&) {
+    Backend_SetLoaderThreads((unsigned)m_perfThreadsSpin->GetValue());
+}
+
+// Load players + sets into scratch structures at 1, 2, 4, ... threads up to the
+// configured count and report wall time and speedup over the 1-thread run, then
+// run exact lookups from the same numbers of reader threads.
+void MainFrame::OnPerfScale(wxCommandEvent&) {
+    unsigned maxThreads = (unsigned)m_perfThreadsSpin->GetValue();
+    std::vector<unsigned> steps;
+    for (unsigned t = 1; t < maxThreads; t *= 2) steps.push_back(t);
+    steps.push_back(maxThreads);
+
+    struct ScaleStep { unsigned threads; double hash_ms, trie_ms; double hash_mops = 0, trie_mops = 0; };
+    auto results = std::make_shared<std::vector<ScaleStep>>();
+    std::string path = dbPath.ToStdString();
+
+    m_perfResultList->DeleteAllItems();
+    m_perfStatusLabel->SetLabel("Measuring loader thread scaling...");
+
+    auto work = [path, steps, maxThreads, results](LoadMonitor& monitor) {
+        bool ok = true;
+        for (unsigned t : steps) {
+            Backend_SetLoaderThreads(t);
+            wxStopWatch stopwatch;
+
+            PlayerHashTable scratchHash;
+            stopwatch.Start();
+            ok = ok && BackendDB_LoadPlayersWithStats(path, scratchHash, &monitor);
+            double hash_ms = stopwatch.Time();
+
+            PlayerTrie scratchTrie;
+            stopwatch.Start();
+            ok = ok && BackendDB_LoadPlayersWithStats(path, scratchTrie, &monitor);
+            double trie_ms = stopwatch.Time();
+
+            if (!ok) break;
+            results->push_back({t, hash_ms, trie_ms});
+        }
+        Backend_SetLoaderThreads(maxThreads);
+        if (!ok) return false;
+
+        // Readers never lock, so throughput should grow with the reader count
+        PlayerHashTable hash; PlayerTrie trie;
+        if (!BackendDB_LoadAllPlayers(path, hash, trie, &monitor)) return false;
+        std::vector<std::string> names;
+        names.reserve(hash.Size());
+        hash.ForEachRecord([&names](const PlayerRecord& r) { names.push_back(r.name); });
+        monitor.BeginPhase("Lookup scaling", results->size());
+        for (ScaleStep& st : *results) {
+            if (monitor.Cancelled()) return false;
+            st.hash_mops = lookupMops(st.threads, names, [&hash](const std::string& k) { return hash.SearchByName(k); });
+            st.trie_mops = lookupMops(st.threads, names, [&trie](const std::string& k) { return trie.SearchExact(k); });
+            monitor.AddRows(1);
+        }
+        return true;
+    };
+
+    auto done = [this, maxThreads, results](bool ok, bool cancelled) {
+        double hash_base = results->empty() ? 0 : results->front().hash_ms;
+        double trie_base = results->empty() ? 0 : results->front().trie_ms;
+        long row = 0;
+        for (const ScaleStep& st : *results) {
+            m_perfResultList->InsertItem(row, wxString::Format("Load @ %u thread(s) (ms)", st.threads));
+            m_perfResultList->SetItem(row, 1, wxString::Format("%.2f", st.hash_ms));
+            m_perfResultList->SetItem(row, 2, wxString::Format("%.2f", st.trie_ms));
+            ++row;
+            m_perfResultList->InsertItem(row, wxString::Format("Speedup @ %u thread(s)", st.threads));
+            m_perfResultList->SetItem(row, 1, wxString::Format("%.2fx (%.0f%% eff.)",
+                st.hash_ms > 0 ? hash_base / st.hash_ms : 0.0, st.hash_ms > 0 ? 100.0 * hash_base / st.hash_ms / st.threads : 0.0));
+            m_perfResultList->SetItem(row, 2, wxString::Format("%.2fx (%.0f%% eff.)",
+                st.trie_ms > 0 ? trie_base / st.trie_ms : 0.0, st.trie_ms > 0 ? 100.0 * trie_base / st.trie_ms / st.threads : 0.0));
+            ++row;
+        }
+        for (const ScaleStep& st : *results) {
+            if (st.hash_mops <= 0 && st.trie_mops <= 0) continue;
+            m_perfResultList->InsertItem(row, wxString::Format("Lookups @ %u thread(s) (Mops/s)", st.threads));
+            m_perfResultList->SetItem(row, 1, wxString::Format("%.2f", st.hash_mops));
+            m_perfResultList->SetItem(row, 2, wxString::Format("%.2f", st.trie_mops));
+            ++row;
+        }
+        if (cancelled)
+            m_perfStatusLabel->SetLabel("Thread scaling cancelled.");
+        else
+            m_perfStatusLabel->SetLabel(ok ? wxString::Format("Thread scaling measured up to %u thread(s).", maxThreads)
+                                           : wxString("Failed to load database!"));
+    };
+
+    StartLoadJob("Measuring loader thread scaling...", work, done);
+}
+
 void MainFrame::OnPerfDSChoice(wxCommandEvent&) {
     int sel = m_perfDSChoice->GetSelection();
     switch (sel) {
@@ -148,91 +758,167 @@ void MainFrame::OnPerfDSChoice(wxCommandEvent&) {
 
 void MainFrame::OnPerfRun(wxCommandEvent&) {
     int sel = m_perfDSChoice->GetSelection();
-    BusyStart("Loading database and benchmarking...");
+    Backend_SetLoaderThreads((unsigned)m_perfThreadsSpin->GetValue());
     m_perfStatusLabel->SetLabel("Loading database from file...");
     m_perfResultList->DeleteAllItems();
-    wxStopWatch stopwatch;
-
-    if(sel == 0) playerHash.Clear();
-    if(sel == 1) playerTrie.Clear();
-    if(sel == 2) { playerHash.Clear(); playerTrie.Clear(); }
-
-    bool ok = false;
-    size_t record_count = 0;
-    double hash_ms = 0, trie_ms = 0;
-    size_t hash_mem = 0, trie_mem = 0;
-
-    if (sel == 0) {   // Hash Table only
-        stopwatch.Start();
-        ok = BackendDB_LoadAllPlayers(dbPath.ToStdString(), playerHash);
-        hash_ms = stopwatch.Time();
-        record_count = playerHash.GetFirstNRecords(3'000'000).size();
-        hash_mem = playerHash.MemoryUsageBytes();
-        m_perfResultList->DeleteAllItems();
-        m_perfResultList->InsertItem(0, "Build Time (ms)");
-        m_perfResultList->SetItem(0, 1, wxString::Format("%.2f", hash_ms));
-        m_perfResultList->InsertItem(1, "Memory (KiB)");
-        m_perfResultList->SetItem(1, 1, wxString::Format("%zu", hash_mem/1024));
-        m_perfStatusLabel->SetLabel(wxString::Format("Loaded %zu player records (Hash Table).", record_count));
-    }
-    else if (sel == 1) {  // Trie only
-        stopwatch.Start();
-        ok = BackendDB_LoadAllPlayers(dbPath.ToStdString(), playerTrie);
-        trie_ms = stopwatch.Time();
-        record_count = playerTrie.GetFirstNRecords(3'000'000).size();
-        trie_mem = playerTrie.MemoryUsageBytes();
-        m_perfResultList->DeleteAllItems();
-        m_perfResultList->InsertItem(0, "Build Time (ms)");
-        m_perfResultList->SetItem(0, 2, wxString::Format("%.2f", trie_ms));
-        m_perfResultList->InsertItem(1, "Memory (KiB)");
-        m_perfResultList->SetItem(1, 2, wxString::Format("%zu", trie_mem/1024));
-        m_perfStatusLabel->SetLabel(wxString::Format("Loaded %zu player records (Trie).", record_count));
-    }
-    else { // BOTH
-        ok = BackendDB_LoadAllPlayers(dbPath.ToStdString(), playerHash, playerTrie);
-        record_count = playerHash.GetFirstNRecords(3'000'000).size();
-
-        stopwatch.Start();
-        playerHash.Clear();
-        BackendDB_LoadAllPlayers(dbPath.ToStdString(), playerHash);
-        hash_ms = stopwatch.Time();
-
-        stopwatch.Start();
-        playerTrie.Clear();
-        BackendDB_LoadAllPlayers(dbPath.ToStdString(), playerTrie);
-        trie_ms = stopwatch.Time();
 
-        hash_mem = playerHash.MemoryUsageBytes();
-        trie_mem = playerTrie.MemoryUsageBytes();
+    // Filled on the loader thread, rendered once the job is done
+    struct PerfResult {
+        std::shared_ptr<PlayerHashTable> hash;
+        std::shared_ptr<PlayerTrie> trie;
+        size_t record_count = 0;
+        double hash_ms = 0, trie_ms = 0;
+        MemoryStats hash_mem, trie_mem;
+        size_t hash_legacy_mem = 0;
+        double hash_lookup_ns = 0, trie_lookup_ns = 0;
+        double legacy_ms = 0, legacy_lookup_ns = 0;
+        size_t legacy_mem = 0;
+        PlayerHashTable::ProbeStats hash_probe;
+        DecodeBenchmark decode, legacy_decode;
+    };
+    auto res = std::make_shared<PerfResult>();
+    std::string path = dbPath.ToStdString();
+
+    auto work = [sel, path, res](LoadMonitor& monitor) {
+        res->hash = std::make_shared<PlayerHashTable>();
+        res->trie = std::make_shared<PlayerTrie>();
+        PlayerHashTable& hash = *res->hash;
+        PlayerTrie& trie = *res->trie;
+        wxStopWatch stopwatch;
+        bool ok = false;
+
+        if (sel == 0) {   // Hash Table only
+            stopwatch.Start();
+            ok = BackendDB_LoadAllPlayers(path, hash, &monitor);
+            res->hash_ms = stopwatch.Time();
+            res->record_count = hash.Size();
+        }
+        else if (sel == 1) {  // Trie only
+            stopwatch.Start();
+            ok = BackendDB_LoadAllPlayers(path, trie, &monitor);
+            res->trie_ms = stopwatch.Time();
+            res->record_count = trie.Size();
+        }
+        else { // BOTH
+            ok = BackendDB_LoadAllPlayers(path, hash, trie, &monitor);
+            res->record_count = hash.Size();
+
+            stopwatch.Start();
+            hash.Clear();
+            ok = ok && BackendDB_LoadAllPlayers(path, hash, &monitor);
+            res->hash_ms = stopwatch.Time();
+
+            stopwatch.Start();
+            trie.Clear();
+            ok = ok && BackendDB_LoadAllPlayers(path, trie, &monitor);
+            res->trie_ms = stopwatch.Time();
+        }
+        // Versions replaced by the reloads are freed first so only live data counts
+        Rcu_Synchronize();
+        res->hash_mem = hash.GetMemoryStats();
+        res->trie_mem = trie.GetMemoryStats();
+
+        // Exact-lookup latency over every loaded name
+        RcuReadGuard guard;
+        std::vector<std::string> names;
+        auto addName = [&names](const PlayerRecord& r) { names.push_back(r.name); };
+        if (sel == 1) trie.ForEachRecord(addName);
+        else          hash.ForEachRecord(addName);
+        if (sel != 1) {
+            res->hash_legacy_mem = hash.LegacyLayoutBytes();
+            res->hash_probe = hash.GetProbeStats();
+            res->hash_lookup_ns = nsPerLookup(names, [&hash](const std::string& k) { return hash.SearchByName(k); });
+        }
+        if (sel != 0) {
+            res->trie_lookup_ns = nsPerLookup(names, [&trie](const std::string& k) { return trie.SearchExact(k); });
+
+            // Same records in the old 128-way trie, for comparison
+            LegacyPlayerTrie legacy;
+            stopwatch.Start();
+            trie.ForEachRecord([&legacy](const PlayerRecord& r) { legacy.Insert(r); });
+            res->legacy_ms = stopwatch.Time();
+            res->legacy_mem = legacy.MemoryUsageBytes();
+            res->legacy_lookup_ns = nsPerLookup(names, [&legacy](const std::string& k) { return legacy.SearchExact(k); });
+        }
+
+        // Row decoding on its own, current decoder against the old one
+        ok = ok && Backend_BenchmarkPlayerDecode(path, false, res->decode)
+                && Backend_BenchmarkPlayerDecode(path, true, res->legacy_decode);
+        return ok;
+    };
+
+    auto done = [this, sel, res](bool ok, bool cancelled) {
+        if (cancelled) {
+            m_perfStatusLabel->SetLabel("Load cancelled; previous data kept.");
+            return;
+        }
+        if (!ok || res->record_count == 0) {
+            m_perfStatusLabel->SetLabel("Failed to load database!");
+            return;
+        }
+        // Players were reloaded without stats
+        if (sel == 0 || sel == 2) playerHash = res->hash;
+        if (sel == 1 || sel == 2) std::atomic_store(&playerTrie, res->trie);
+        setsLoaded = false;
+        ++dataVersion;
 
         m_perfResultList->DeleteAllItems();
         m_perfResultList->InsertItem(0, "Build Time (ms)");
-        m_perfResultList->SetItem(0, 1, wxString::Format("%.2f", hash_ms));
-        m_perfResultList->SetItem(0, 2, wxString::Format("%.2f", trie_ms));
-
         m_perfResultList->InsertItem(1, "Memory (KiB)");
-        m_perfResultList->SetItem(1, 1, wxString::Format("%zu", hash_mem/1024));
-        m_perfResultList->SetItem(1, 2, wxString::Format("%zu", trie_mem/1024));
-        m_perfStatusLabel->SetLabel(wxString::Format("Loaded %zu player records (Both).", record_count));
-    }
-
-    if (!ok || record_count == 0) {
-        m_perfStatusLabel->SetLabel("Failed to load database!");
-        BusyEnd();
-        UpdateVisitedRowsCounter();
-        return;
-    }
-
-    // Counter auto-updated
-    UpdateVisitedRowsCounter();
-
-    double eff = 0.0;
-    if (sel == 0) eff = hash_ms;
-    else if (sel == 1) eff = trie_ms;
-    else eff = std::max(hash_ms, trie_ms);
-
-    SetEfficiency(m_perfEfficiencyLabel, eff);
-    BusyEnd();
+        m_perfResultList->InsertItem(2, "Memory, old 2-table layout (KiB)");
+        m_perfResultList->InsertItem(3, "Exact Lookup (ns/op)");
+        if (sel == 0 || sel == 2) {
+            m_perfResultList->SetItem(0, 1, wxString::Format("%.2f", res->hash_ms));
+            m_perfResultList->SetItem(1, 1, wxString::Format("%zu", res->hash_mem.live_bytes/1024));
+            m_perfResultList->SetItem(2, 1, wxString::Format("%zu", res->hash_legacy_mem/1024));
+            m_perfResultList->SetItem(3, 1, wxString::Format("%.1f", res->hash_lookup_ns));
+            m_perfResultList->InsertItem(4, "Load Factor / Capacity");
+            m_perfResultList->SetItem(4, 1, wxString::Format("%.2f / %zu", res->hash_probe.load_factor, res->hash_probe.capacity));
+            m_perfResultList->InsertItem(5, "Probe Distance (avg / max)");
+            m_perfResultList->SetItem(5, 1, wxString::Format("%.2f / %zu", res->hash_probe.avg_probe, res->hash_probe.max_probe));
+        }
+        if (sel == 1 || sel == 2) {
+            m_perfResultList->SetItem(0, 2, wxString::Format("%.2f", res->trie_ms));
+            m_perfResultList->SetItem(1, 2, wxString::Format("%zu", res->trie_mem.live_bytes/1024));
+            m_perfResultList->SetItem(3, 2, wxString::Format("%.1f", res->trie_lookup_ns));
+            m_perfResultList->SetItem(0, 3, wxString::Format("%.2f (from memory)", res->legacy_ms));
+            m_perfResultList->SetItem(1, 3, wxString::Format("%zu", res->legacy_mem/1024));
+            m_perfResultList->SetItem(3, 3, wxString::Format("%.1f", res->legacy_lookup_ns));
+        }
+        long row = m_perfResultList->GetItemCount();
+        m_perfResultList->InsertItem(row, "Memory, peak (KiB)");
+        m_perfResultList->InsertItem(row + 1, "Allocations");
+        if (sel == 0 || sel == 2) {
+            m_perfResultList->SetItem(row, 1, wxString::Format("%zu", res->hash_mem.peak_bytes/1024));
+            m_perfResultList->SetItem(row + 1, 1, wxString::Format("%zu", res->hash_mem.allocations));
+        }
+        if (sel == 1 || sel == 2) {
+            m_perfResultList->SetItem(row, 2, wxString::Format("%zu", res->trie_mem.peak_bytes/1024));
+            m_perfResultList->SetItem(row + 1, 2, wxString::Format("%zu", res->trie_mem.allocations));
+        }
+        row += 2;
+        m_perfResultList->InsertItem(row, "Row Decode (allocs/row, now / before)");
+        // Allocations are only counted in the benchmark build
+        m_perfResultList->SetItem(row, 1, res->decode.allocs_per_row < 0 ? wxString("n/a (make bench)")
+            : wxString::Format("%.2f / %.2f", res->decode.allocs_per_row, res->legacy_decode.allocs_per_row));
+        m_perfResultList->InsertItem(row + 1, "Row Decode (rows/s, now / before)");
+        m_perfResultList->SetItem(row + 1, 1, wxString::Format("%.0f / %.0f",
+            res->decode.rows_per_sec, res->legacy_decode.rows_per_sec));
+        m_perfResultList->InsertItem(row + 2, "Interned Main Characters");
+        m_perfResultList->SetItem(row + 2, 1, wxString::Format("%zu (%zu B)",
+            PooledString::PoolSize(), PooledString::PoolBytes()));
+
+        const char* which = (sel == 0) ? "Hash Table" : (sel == 1) ? "Trie" : "Both";
+        m_perfStatusLabel->SetLabel(wxString::Format("Loaded %zu player records (%s).", res->record_count, which));
+
+        double eff = 0.0;
+        if (sel == 0) eff = res->hash_ms;
+        else if (sel == 1) eff = res->trie_ms;
+        else eff = std::max(res->hash_ms, res->trie_ms);
+        SetEfficiency(m_perfEfficiencyLabel, eff);
+    };
+
+    StartLoadJob("Loading database and benchmarking...", work, done);
 }
 
 
@@ -257,6 +943,7 @@ wxPanel* MainFrame::CreatePlayerStatsPanel(wxWindow* parent) {
     auto* hbox = new wxBoxSizer(wxHORIZONTAL);
     hbox->Add(new wxStaticText(panel, wxID_ANY, "Player Name or ID:"), 0, wxALIGN_CENTER_VERTICAL|wxRIGHT, 5);
     m_playerSearchText = new wxTextCtrl(panel, wxID_ANY);
+    m_playerSearchText->AutoComplete(new PlayerTagCompleter(&playerTrie));
     hbox->Add(m_playerSearchText, 1);
     m_playerSearchBtn = new wxButton(panel, wxID_ANY, "Search");
     hbox->Add(m_playerSearchBtn, 0, wxLEFT, 10);
@@ -264,11 +951,12 @@ wxPanel* MainFrame::CreatePlayerStatsPanel(wxWindow* parent) {
     hbox->Add(m_playerLoadBtn, 0, wxLEFT, 10);
     m_playerLoadSetsBtn = new wxButton(panel, wxID_ANY, "Load Sets");
     hbox->Add(m_playerLoadSetsBtn, 0, wxLEFT, 10);
+    m_playerRefreshBtn = new wxButton(panel, wxID_ANY, "Refresh");
+    hbox->Add(m_playerRefreshBtn, 0, wxLEFT, 10);
 
     vbox->Add(hbox, 0, wxEXPAND | wxALL, 5);
 
-    m_playerResultList = new wxListCtrl(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize,
-                      wxLC_REPORT | wxLC_SINGLE_SEL | wxLC_HRULES | wxLC_VRULES);
+    m_playerResultList = new PlayerResultList(panel);
 
     m_playerResultList->InsertColumn(0, "ID",             wxLIST_FORMAT_LEFT, 80);
     m_playerResultList->InsertColumn(1, "Name",           wxLIST_FORMAT_LEFT, 140);
@@ -284,6 +972,7 @@ wxPanel* MainFrame::CreatePlayerStatsPanel(wxWindow* parent) {
     m_playerSearchBtn->Bind(wxEVT_BUTTON, &MainFrame::OnPlayerSearch, this);
     m_playerLoadBtn->Bind(wxEVT_BUTTON, &MainFrame::OnPlayerLoad, this);
     m_playerLoadSetsBtn->Bind(wxEVT_BUTTON, &MainFrame::OnPlayerLoadSets, this);
+    m_playerRefreshBtn->Bind(wxEVT_BUTTON, &MainFrame::OnPlayerRefresh, this);
 
     return panel;
 }
@@ -299,90 +988,220 @@ void MainFrame::OnPlayerSearch(wxCommandEvent&) {
         return;
     }
     wxString query = m_playerSearchText->GetValue();
-    m_playerResultList->DeleteAllItems();
+    m_playerResultList->ClearRows();
     if (query.IsEmpty()) return;
-    std::string q = std::string(query.mb_str());
+    std::string q = std::string(query.utf8_str());
     wxStopWatch watch;
-    PlayerRecord record;
-    bool found = false;
-    if (currentDS == HASH_TABLE) {
-        if (auto* rec = playerHash.SearchByName(q))    { record = *rec; found=true; }
-        else if (auto* rec = playerHash.SearchByID(q)) { record = *rec; found=true; }
-    } else {
-        if (auto* rec = playerTrie.SearchExact(q))     { record = *rec; found=true; }
+    std::vector<const PlayerRecord*> records;
+    std::vector<RecordPin> pins;
+    RecordPin pin;
+    if (const PlayerRecord* rec = FindPlayer(q, &pin)) {
+        records.push_back(rec);
+        pins.push_back(std::move(pin));
+    } else if (playerFuzzy) {
+        // No exact tag: list the closest tags instead
+        const std::string norm = PlayerFuzzyIndex::NormalizeTag(q);
+        for (const FuzzyMatch& m : playerFuzzy->Search(q, PlayerFuzzyIndex::DefaultMaxDistance(norm.size()), 10)) {
+            if (const PlayerRecord* rec = FindPlayer(m.name, &pin)) {
+                records.push_back(rec);
+                pins.push_back(std::move(pin));
+            }
+        }
+        if (!records.empty())
+            SetStatusText(wxString::Format("No exact match for \"%s\"; showing %zu similar tag(s)", query, records.size()), 0);
     }
     double ms = watch.Time();
     SetEfficiency(m_playerEfficiencyLabel, ms);
 
-    if (!found) {
-        m_playerResultList->InsertItem(0, "Not found");
-        UpdateVisitedRowsCounter();
-        return;
-    }
-    m_playerResultList->InsertItem(0, record.id);
-    m_playerResultList->SetItem(0, 1, record.name);
-    m_playerResultList->SetItem(0, 2, record.main_character);
-    m_playerResultList->SetItem(0, 3, wxString::Format("%d", record.matches_played));
-    m_playerResultList->SetItem(0, 4, wxString::Format("%d", record.matches_won));
-    m_playerResultList->SetItem(0, 5, wxString::Format("%.2f", record.win_rate*100.0));
+    if (records.empty())
+        m_playerResultList->ShowMessage("Not found");
+    else
+        m_playerResultList->SetRecords(std::move(records), std::move(pins));
 
     UpdateVisitedRowsCounter();
 }
 
-void MainFrame::OnPlayerLoad(wxCommandEvent&) {
-    m_playerResultList->DeleteAllItems();
-
-    setsLoaded = false; // must reload sets after this
-    wxStopWatch watch;
-    BusyStart("Loading Players Only...");
-    bool ok;
-    if (currentDS == HASH_TABLE)
-        ok = BackendDB_LoadAllPlayers(dbPath.ToStdString(), playerHash);
-    else
-        ok = BackendDB_LoadAllPlayers(dbPath.ToStdString(), playerTrie);
-    BusyEnd();
-    if (!ok)
-        wxMessageBox("Failed to load players!", "Error", wxOK|wxICON_ERROR, this);
-    SetEfficiency(m_playerEfficiencyLabel, watch.Time());
+// Exact tag (or, on the hash table, ID) lookup in the active structure.
+// The caller holds an RcuReadGuard, or the pin filled in, for as long as it
+// uses the result.
+const PlayerRecord* MainFrame::FindPlayer(const std::string& query, RecordPin* pin) const {
+    MetricTimer timer(METRIC_OP_EXACT_LOOKUP, metricBackend(currentDS));
+    if (currentDS == HASH_TABLE) {
+        if (const PlayerRecord* rec = playerHash->SearchByName(query, pin)) return rec;
+        return playerHash->SearchByID(query, pin);
+    }
+    return playerTrie->SearchExact(query, pin);
+}
 
-    UpdateVisitedRowsCounter();
+void MainFrame::OnPlayerLoad(wxCommandEvent&) {
+    m_playerResultList->ClearRows();
+
+    DataStructureChoice ds = currentDS;
+    std::string path = dbPath.ToStdString();
+    struct Loaded { std::shared_ptr<PlayerHashTable> hash; std::shared_ptr<PlayerTrie> trie; };
+    auto res = std::make_shared<Loaded>();
+    auto watch = std::make_shared<wxStopWatch>();
+
+    StartLoadJob("Loading Players Only...",
+        [ds, path, res](LoadMonitor& monitor) {
+            if (ds == HASH_TABLE) {
+                res->hash = std::make_shared<PlayerHashTable>();
+                return BackendDB_LoadAllPlayers(path, *res->hash, &monitor);
+            }
+            res->trie = std::make_shared<PlayerTrie>();
+            return BackendDB_LoadAllPlayers(path, *res->trie, &monitor);
+        },
+        [this, ds, res, watch](bool ok, bool cancelled) {
+            if (cancelled) return;
+            if (!ok) {
+                wxMessageBox("Failed to load players!", "Error", wxOK|wxICON_ERROR, this);
+                return;
+            }
+            if (ds == HASH_TABLE) playerHash = res->hash;
+            else                  std::atomic_store(&playerTrie, res->trie);
+            setsLoaded = false; // must reload sets after this
+            ++dataVersion;
+            SetEfficiency(m_playerEfficiencyLabel, watch->Time());
+        });
 }
 
 void MainFrame::OnPlayerLoadSets(wxCommandEvent&) {
-    BusyStart("Loading Sets and Player Stats...");
-    bool ok = BackendDB_LoadPlayerStats(dbPath.ToStdString(), playerHash, playerTrie);
-    BusyEnd();
-    if (!ok) {
-        wxMessageBox("Failed to load set stats!\nAre players loaded already?", "Error", wxOK | wxICON_ERROR, this);
-        setsLoaded = false;
-        UpdateVisitedRowsCounter();
+    StartSetsLoad(true);
+}
+
+// Applies only the players and sets added since the last load to the live
+// structures, then brings the snapshot up to date so the next start maps it.
+// Every derived index takes the delta in place on the GUI thread.
+void MainFrame::OnPlayerRefresh(wxCommandEvent&) {
+    if (!setsLoaded) {
+        wxMessageBox("You must press 'Load Sets' before refreshing.",
+            "Sets Not Loaded!", wxOK|wxICON_WARNING, this);
         return;
     }
-    setsLoaded = true;
-    wxMessageBox("Set information loaded! You can now search/view player stats.", "Success", wxOK|wxICON_INFORMATION, this);
+    std::string path = dbPath.ToStdString();
+    struct Refreshed {
+        std::shared_ptr<PlayerHashTable> hash;
+        std::shared_ptr<PlayerTrie> trie;
+        HighWaterMarks from;
+        HighWaterMarks marks;
+        RefreshDelta delta;
+        bool applied = false;
+        bool saved = false;
+        long refreshMs = 0;
+        long saveMs = 0;
+    };
+    auto res = std::make_shared<Refreshed>();
+    res->hash = playerHash;
+    res->trie = std::atomic_load(&playerTrie);
+    res->from = loadMarks;
+    res->marks = loadMarks;
+
+    auto work = [path, res](LoadMonitor& monitor) {
+        wxStopWatch watch;
+        SnapshotStamp stamp;
+        bool stamped = BackendSnapshot_StampDB(path, stamp);
+        res->applied = BackendDB_Refresh(path, *res->hash, *res->trie, res->marks, res->delta, &monitor);
+        res->refreshMs = watch.Time();
+        if (!res->applied) return false;
+        monitor.BeginPhase("Saving snapshot", 0);
+        watch.Start();
+        res->saved = stamped && BackendSnapshot_SaveRefresh(path, stamp, *res->hash, *res->trie, res->from,
+                                                            res->delta, res->marks);
+        res->saveMs = watch.Time();
+        if (!res->saved)
+            std::cerr << "Could not update snapshot for " << path << std::endl;
+        return true;
+    };
+
+    // Once the structures took the new rows, the marks and indexes must follow
+    // even if Cancel was pressed afterwards
+    auto done = [this, res](bool, bool cancelled) {
+        if (!res->applied) {
+            if (!cancelled)
+                wxMessageBox("Failed to refresh!\nIs the database path correct?", "Error", wxOK | wxICON_ERROR, this);
+            return;
+        }
+        loadMarks = res->marks;
+        if (playerPairs) playerPairs->AddSets(res->delta.sets);
+        if (stageIndex) stageIndex->AddGames(res->delta.games);
+        if (matchupMatrix) matchupMatrix->AddGames(res->delta.games);
+        if (playerColumns) playerColumns->Update(res->delta.players);
+        if (playerFuzzy) playerFuzzy->Update(res->delta.players);
+        ++dataVersion;
+        SetEfficiency(m_playerEfficiencyLabel, res->refreshMs);
+        if (res->saved)
+            SetStatusText(wxString::Format("Refreshed: %zu new players, %zu new sets in %ld ms (snapshot saved in %ld ms)",
+                res->delta.new_players, res->delta.sets.size(), res->refreshMs, res->saveMs), 0);
+        else
+            SetStatusText(wxString::Format("Refreshed: %zu new players, %zu new sets in %ld ms (snapshot not updated)",
+                res->delta.new_players, res->delta.sets.size(), res->refreshMs), 0);
+    };
+
+    StartLoadJob("Refreshing new players and sets...", work, done);
+}
 
-    // Immediately fill the list with all players with stats!
-    m_playerResultList->DeleteAllItems();
-    size_t maxRecords = 1000000;
-    std::vector<PlayerRecord> batch;
-    if (currentDS == HASH_TABLE)
-        batch = playerHash.GetFirstNRecords(maxRecords);
-    else
-        for (auto* pr : playerTrie.GetFirstNRecords(maxRecords)) batch.push_back(*pr);
-
-    size_t i = 0;
-    for (const auto& rec : batch) {
-        if (rec.matches_won < 1)
-            continue; // Only show players with one or more wins
-        m_playerResultList->InsertItem(i, rec.id);
-        m_playerResultList->SetItem(i, 1, rec.name);
-        m_playerResultList->SetItem(i, 2, rec.main_character);
-        m_playerResultList->SetItem(i, 3, wxString::Format("%d", rec.matches_played));
-        m_playerResultList->SetItem(i, 4, wxString::Format("%d", rec.matches_won));
-        m_playerResultList->SetItem(i, 5, wxString::Format("%.2f", rec.win_rate*100.0));
-        ++i;
-    }
-    UpdateVisitedRowsCounter();
+void MainFrame::StartSetsLoad(bool interactive) {
+    // Players are re-read into fresh structures alongside the stats so the
+    // current ones stay queryable until the new data is swapped in.
+    std::string path = dbPath.ToStdString();
+    struct Loaded {
+        std::shared_ptr<PlayerHashTable> hash;
+        std::shared_ptr<PlayerTrie> trie;
+        DerivedIndexes derived;
+        HighWaterMarks marks;
+    };
+    auto res = std::make_shared<Loaded>();
+
+    auto work = [path, res](LoadMonitor& monitor) {
+        res->hash = std::make_shared<PlayerHashTable>();
+        res->trie = std::make_shared<PlayerTrie>();
+        std::vector<SetSummary> sets;
+        GameTable games;
+        SnapshotStamp stamp;
+        bool stamped = BackendSnapshot_StampDB(path, stamp);
+        bool ok = BackendDB_LoadPlayersWithStats(path, *res->hash, *res->trie, &monitor, &sets, &games, &res->marks);
+        if (ok && !(stamped && BackendSnapshot_Save(path, stamp, *res->hash, *res->trie, &sets, &games, &res->marks)))
+            std::cerr << "Could not write snapshot for " << path << std::endl;
+        if (ok) res->derived = buildDerivedIndexes(*res->hash, sets, games);
+        return ok;
+    };
+
+    auto done = [this, res, interactive](bool ok, bool cancelled) {
+        if (cancelled) return;
+        if (!ok) {
+            wxMessageBox("Failed to load set stats!\nIs the database path correct?", "Error", wxOK | wxICON_ERROR, this);
+            return;
+        }
+        playerHash = res->hash;
+        std::atomic_store(&playerTrie, res->trie);
+        loadMarks = res->marks;
+        playerFuzzy = res->derived.fuzzy;
+        playerColumns = res->derived.columns;
+        playerPairs = res->derived.pairs;
+        stageIndex = res->derived.stages;
+        matchupMatrix = res->derived.matchups;
+        setsLoaded = true;
+        ++dataVersion;
+        SetEfficiency(m_playerEfficiencyLabel, Backend_GetLastLoadMillis());
+        UpdateVisitedRowsCounter();
+        if (!interactive) return;
+        wxMessageBox("Set information loaded! You can now search/view player stats.", "Success", wxOK|wxICON_INFORMATION, this);
+
+        // Immediately fill the list with all players with stats! The list
+        // points at the records of the pinned version, one pointer per row,
+        // so every player is listed; the control formats only the rows on screen.
+        std::vector<const PlayerRecord*> rows;
+        RecordPin pin;
+        auto addRow = [&rows](const PlayerRecord& rec) {
+            if (rec.matches_won >= 1) rows.push_back(&rec); // Only players with one or more wins
+            return true;
+        };
+        if (currentDS == HASH_TABLE) playerHash->ForEachRecordUntil(addRow, &pin);
+        else                         playerTrie->ForEachRecordUntil(addRow, &pin);
+        m_playerResultList->SetRecords(std::move(rows), {std::move(pin)});
+    };
+
+    StartLoadJob("Loading Sets and Player Stats...", work, done);
 }
 
 //----------------- HEAD-TO-HEAD TAB ----------------------
@@ -406,9 +1225,11 @@ wxPanel* MainFrame::CreateHeadToHeadPanel(wxWindow* parent) {
     auto* hbox = new wxBoxSizer(wxHORIZONTAL);
     hbox->Add(new wxStaticText(panel, wxID_ANY, "Player 1:"), 0, wxALIGN_CENTER_VERTICAL|wxRIGHT, 5);
     m_headP1Text = new wxTextCtrl(panel, wxID_ANY);
+    m_headP1Text->AutoComplete(new PlayerTagCompleter(&playerTrie));
     hbox->Add(m_headP1Text, 1, wxRIGHT, 10);
     hbox->Add(new wxStaticText(panel, wxID_ANY, "Player 2:"), 0, wxALIGN_CENTER_VERTICAL|wxRIGHT, 5);
     m_headP2Text = new wxTextCtrl(panel, wxID_ANY);
+    m_headP2Text->AutoComplete(new PlayerTagCompleter(&playerTrie));
     hbox->Add(m_headP2Text, 1, wxRIGHT, 10);
     m_headCompareBtn = new wxButton(panel, wxID_ANY, "Compare");
     hbox->Add(m_headCompareBtn, 0);
@@ -435,39 +1256,93 @@ void MainFrame::OnHeadCompare(wxCommandEvent&) {
             "Sets Not Loaded!", wxOK|wxICON_WARNING, this);
         return;
     }
-    wxString q1 = m_headP1Text->GetValue();
-    wxString q2 = m_headP2Text->GetValue();
+    if (!SetIndexesReady()) return;
     m_headResultList->DeleteAllItems();
-    wxStopWatch watch;
-    PlayerRecord rec1, rec2; bool f1=false, f2=false;
-    std::string s1 = q1.ToStdString(), s2 = q2.ToStdString();
-    if (currentDS == HASH_TABLE) {
-        if (auto* r = playerHash.SearchByName(s1)) { rec1=*r; f1=true; } else if (auto* r=playerHash.SearchByID(s1)) { rec1=*r; f1=true; }
-        if (auto* r = playerHash.SearchByName(s2)) { rec2=*r; f2=true; }
-        if (auto* r = playerHash.SearchByID(s2)) { rec2=*r; f2=true; }
-    } else {
-        if (auto* r = playerTrie.SearchExact(s1)) { rec1=*r; f1=true; }
-        if (auto* r = playerTrie.SearchExact(s2)) { rec2=*r; f2=true; }
+    auto start = std::chrono::steady_clock::now();
+    std::string s1 = std::string(m_headP1Text->GetValue().Trim().Trim(false).utf8_str());
+    std::string s2 = std::string(m_headP2Text->GetValue().Trim().Trim(false).utf8_str());
+    // Tags match exactly, so only the structure and the trimmed text form the key
+    std::string params = std::to_string((int)currentDS) + '\n' + s1 + '\n' + s2;
+    std::shared_ptr<const HeadToHeadResult> res = queryCache.Find<HeadToHeadResult>(QUERY_HEAD_TO_HEAD, params, dataVersion);
+    if (!res) {
+        auto r = std::make_shared<HeadToHeadResult>();
+        RcuReadGuard guard;
+        // Fall back to the closest tag when there is no exact match
+        auto resolve = [this](const std::string& q) -> const PlayerRecord* {
+            if (const PlayerRecord* r = FindPlayer(q)) return r;
+            if (!playerFuzzy) return nullptr;
+            auto best = playerFuzzy->Search(q, PlayerFuzzyIndex::DefaultMaxDistance(PlayerFuzzyIndex::NormalizeTag(q).size()), 1);
+            return best.empty() ? nullptr : FindPlayer(best[0].name);
+        };
+        const PlayerRecord* p1 = resolve(s1);
+        const PlayerRecord* p2 = resolve(s2);
+        if (p1 && p2) {
+            r->found = true;
+            r->rec1 = *p1;
+            r->rec2 = *p2;
+        }
+        // Sets the two actually played against each other, from the pair index
+        if (r->found && playerPairs) {
+            r->hasPairs = true;
+            r->id1 = std::strtoll(r->rec1.id.c_str(), nullptr, 10);
+            r->id2 = std::strtoll(r->rec2.id.c_str(), nullptr, 10);
+            r->h2h = playerPairs->Record(r->id1, r->id2);
+            auto range = playerPairs->SetsBetween(r->id1, r->id2);
+            r->sets.assign(range.first, range.second);
+        }
+        res = r;
+        queryCache.Put(QUERY_HEAD_TO_HEAD, params, dataVersion, res);
     }
-    double ms = watch.Time();
-    SetEfficiency(m_headEfficiencyLabel, ms);
-    if (!f1 || !f2) {
+    Metrics_RecordLatency(METRIC_OP_HEAD_TO_HEAD, metricBackend(currentDS), nsSince(start));
+    SetEfficiency(m_headEfficiencyLabel, msSince(start));
+    if (!res->found) {
         m_headResultList->InsertItem(0, "One or both players not found.");
         UpdateVisitedRowsCounter();
         return;
     }
 
+    const PlayerRecord& rec1 = res->rec1;
+    const PlayerRecord& rec2 = res->rec2;
     m_headResultList->InsertItem(0, "ID");             m_headResultList->SetItem(0,1,rec1.id);   m_headResultList->SetItem(0,2,rec2.id);
-    m_headResultList->InsertItem(1, "Name");           m_headResultList->SetItem(1,1,rec1.name); m_headResultList->SetItem(1,2,rec2.name);
-    m_headResultList->InsertItem(2, "Main");           m_headResultList->SetItem(2,1,rec1.main_character); m_headResultList->SetItem(2,2,rec2.main_character);
+    m_headResultList->InsertItem(1, "Name");           m_headResultList->SetItem(1,1,wxString::FromUTF8(rec1.name)); m_headResultList->SetItem(1,2,wxString::FromUTF8(rec2.name));
+    m_headResultList->InsertItem(2, "Main");           m_headResultList->SetItem(2,1,rec1.main_character.str()); m_headResultList->SetItem(2,2,rec2.main_character.str());
     m_headResultList->InsertItem(3, "Played");         m_headResultList->SetItem(3,1,wxString::Format("%d",rec1.matches_played)); m_headResultList->SetItem(3,2,wxString::Format("%d",rec2.matches_played));
     m_headResultList->InsertItem(4, "Won");            m_headResultList->SetItem(4,1,wxString::Format("%d",rec1.matches_won));    m_headResultList->SetItem(4,2,wxString::Format("%d",rec2.matches_won));
     m_headResultList->InsertItem(5, "Win Rate");       m_headResultList->SetItem(5,1,wxString::Format("%.2f%%",rec1.win_rate*100)); m_headResultList->SetItem(5,2,wxString::Format("%.2f%%",rec2.win_rate*100));
 
+    if (res->hasPairs) {
+        const SetPairIndex::HeadToHead& h2h = res->h2h;
+        m_headResultList->InsertItem(6, "H2H Sets");       m_headResultList->SetItem(6,1,wxString::Format("%d",h2h.sets));       m_headResultList->SetItem(6,2,wxString::Format("%d",h2h.sets));
+        m_headResultList->InsertItem(7, "H2H Set Wins");   m_headResultList->SetItem(7,1,wxString::Format("%d",h2h.set_wins_a)); m_headResultList->SetItem(7,2,wxString::Format("%d",h2h.set_wins_b));
+        m_headResultList->InsertItem(8, "H2H Game Wins");  m_headResultList->SetItem(8,1,wxString::Format("%d",h2h.games_a));    m_headResultList->SetItem(8,2,wxString::Format("%d",h2h.games_b));
+        long row = 9;
+        for (const SetPairIndex::Set& set : res->sets) {
+            int score1 = (set.p1 == res->id1) ? set.p1_score : set.p2_score;
+            int score2 = (set.p1 == res->id1) ? set.p2_score : set.p1_score;
+            m_headResultList->InsertItem(row, wxString::FromUTF8(playerPairs->Tournament(set.tournament)));
+            m_headResultList->SetItem(row,1,wxString::Format("%d",score1));
+            m_headResultList->SetItem(row,2,wxString::Format("%d",score2));
+            ++row;
+        }
+    }
+
     UpdateVisitedRowsCounter();
 }
 
 //--------------- CHARACTER MATCHUP TAB ---------------
+// Character / Played / Won / Win Rate, then one win-rate column per opponent
+// when the full matrix is shown
+static void setCharacterColumns(wxListCtrl* list, const MatchupMatrix* matrix, const std::vector<int>& opponents) {
+    list->DeleteAllColumns();
+    list->InsertColumn(0, "Character", wxLIST_FORMAT_LEFT, 140);
+    list->InsertColumn(1, "Played", wxLIST_FORMAT_RIGHT, 100);
+    list->InsertColumn(2, "Won", wxLIST_FORMAT_RIGHT, 100);
+    list->InsertColumn(3, "Win Rate (%)", wxLIST_FORMAT_RIGHT, 110);
+    for (size_t i = 0; i < opponents.size(); ++i)
+        list->InsertColumn((long)(4 + i), "vs " + wxString::FromUTF8(matrix->CharacterName(opponents[i])),
+                           wxLIST_FORMAT_RIGHT, 80);
+}
+
 wxPanel* MainFrame::CreateCharacterMatchupPanel(wxWindow* parent) {
     wxPanel* panel = new wxPanel(parent);
     auto* vbox = new wxBoxSizer(wxVERTICAL);
@@ -500,10 +1375,7 @@ wxPanel* MainFrame::CreateCharacterMatchupPanel(wxWindow* parent) {
 
     m_charResultList = new wxListCtrl(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize,
         wxLC_REPORT | wxLC_SINGLE_SEL | wxLC_HRULES | wxLC_VRULES);
-    m_charResultList->InsertColumn(0, "Character", wxLIST_FORMAT_LEFT, 140);
-    m_charResultList->InsertColumn(1, "Played", wxLIST_FORMAT_RIGHT, 100);
-    m_charResultList->InsertColumn(2, "Won", wxLIST_FORMAT_RIGHT, 100);
-    m_charResultList->InsertColumn(3, "Win Rate (%)", wxLIST_FORMAT_RIGHT, 110);
+    setCharacterColumns(m_charResultList, nullptr, {});
 
     vbox->Add(m_charResultList, 1, wxEXPAND | wxLEFT|wxRIGHT|wxBOTTOM, 5);
     panel->SetSizer(vbox);
@@ -521,34 +1393,55 @@ void MainFrame::OnCharAnalyze(wxCommandEvent&) {
             "Sets Not Loaded!", wxOK|wxICON_WARNING, this);
         return;
     }
+    if (!SetIndexesReady()) return;
     m_charResultList->DeleteAllItems();
-    std::string char1 = m_char1Text->GetValue().ToStdString();
-    std::string char2 = m_char2Text->GetValue().ToStdString();
-    wxStopWatch watch;
-    if (char1.empty() || char2.empty()) {
-        m_charResultList->InsertItem(0, "Enter both character names");
-        SetEfficiency(m_charEfficiencyLabel, watch.Time());
+    setCharacterColumns(m_charResultList, nullptr, {});
+    std::string char1 = std::string(m_char1Text->GetValue().Trim().Trim(false).utf8_str());
+    std::string char2 = std::string(m_char2Text->GetValue().Trim().Trim(false).utf8_str());
+    auto start = std::chrono::steady_clock::now();
+    std::string params = cacheKeyLower(char1) + '\n' + cacheKeyLower(char2);
+    std::shared_ptr<const CharMatchupResult> res = queryCache.Find<CharMatchupResult>(QUERY_CHAR_MATCHUP, params, dataVersion);
+    if (!res) {
+        auto r = std::make_shared<CharMatchupResult>();
+        int a = matchupMatrix ? matchupMatrix->CharacterCode(char1) : GameTable::kUnknownCode;
+        int b = matchupMatrix ? matchupMatrix->CharacterCode(char2) : GameTable::kUnknownCode;
+        if (a != GameTable::kUnknownCode && b != GameTable::kUnknownCode) {
+            // Two cells of the matchup matrix, then each character's players by main
+            r->found = true;
+            r->name1 = matchupMatrix->CharacterName(a);
+            r->name2 = matchupMatrix->CharacterName(b);
+            r->ab = matchupMatrix->Matchup(a, b);
+            r->ba = matchupMatrix->Matchup(b, a);
+            if (playerColumns) {
+                r->t1 = playerColumns->SumForCharacter(playerColumns->CharacterCode(r->name1));
+                r->t2 = playerColumns->SumForCharacter(playerColumns->CharacterCode(r->name2));
+            }
+        }
+        res = r;
+        queryCache.Put(QUERY_CHAR_MATCHUP, params, dataVersion, res);
+    }
+    if (!res->found) {
+        m_charResultList->InsertItem(0, "Enter two known character names");
+        SetEfficiency(m_charEfficiencyLabel, msSince(start));
         UpdateVisitedRowsCounter();
         return;
     }
-    int char1_play=0, char1_win=0, char2_play=0, char2_win=0;
-    std::vector<PlayerRecord> records;
-    if (currentDS == HASH_TABLE)      records = playerHash.GetFirstNRecords(100000);
-    else for (auto* r : playerTrie.GetFirstNRecords(100000)) records.push_back(*r);
-
-    for (const auto& rec : records) {
-        if (rec.main_character == char1) { char1_play += rec.matches_played; char1_win += rec.matches_won; }
-        if (rec.main_character == char2) { char2_play += rec.matches_played; char2_win += rec.matches_won; }
-    }
-    m_charResultList->InsertItem(0, char1);
-    m_charResultList->SetItem(0,1, wxString::Format("%d", char1_play));
-    m_charResultList->SetItem(0,2, wxString::Format("%d", char1_win));
-    m_charResultList->SetItem(0,3, wxString::Format("%.2f", char1_play?100.0*char1_win/char1_play:0.0));
-    m_charResultList->InsertItem(1, char2);
-    m_charResultList->SetItem(1,1, wxString::Format("%d", char2_play));
-    m_charResultList->SetItem(1,2, wxString::Format("%d", char2_win));
-    m_charResultList->SetItem(1,3, wxString::Format("%.2f", char2_play?100.0*char2_win/char2_play:0.0));
-    SetEfficiency(m_charEfficiencyLabel, watch.Time());
+    Metrics_RecordLatency(METRIC_OP_CHAR_AGGREGATE, METRIC_COLUMNS, nsSince(start));
+    double ms = msSince(start);
+
+    wxString name1 = wxString::FromUTF8(res->name1);
+    wxString name2 = wxString::FromUTF8(res->name2);
+    auto addRow = [this](long row, const wxString& label, long long played, long long won) {
+        m_charResultList->InsertItem(row, label);
+        m_charResultList->SetItem(row,1, wxString::Format("%lld", played));
+        m_charResultList->SetItem(row,2, wxString::Format("%lld", won));
+        m_charResultList->SetItem(row,3, wxString::Format("%.2f", played?100.0*won/played:0.0));
+    };
+    addRow(0, name1 + " vs " + name2 + " (games)", (long long)res->ab.games, (long long)res->ab.wins);
+    addRow(1, name2 + " vs " + name1 + " (games)", (long long)res->ba.games, (long long)res->ba.wins);
+    addRow(2, name1 + " mains (sets)", (long long)res->t1.played, (long long)res->t1.won);
+    addRow(3, name2 + " mains (sets)", (long long)res->t2.played, (long long)res->t2.won);
+    SetEfficiency(m_charEfficiencyLabel, ms);
 
     UpdateVisitedRowsCounter();
 }
@@ -558,30 +1451,40 @@ void MainFrame::OnCharLoadAll(wxCommandEvent&) {
             "Sets Not Loaded!", wxOK|wxICON_WARNING, this);
         return;
     }
+    if (!SetIndexesReady()) return;
     m_charResultList->DeleteAllItems();
-    wxStopWatch watch;
-    std::map<std::string,std::tuple<int,int>> c_stats;
-    std::vector<PlayerRecord> recs;
-    if (currentDS == HASH_TABLE) recs = playerHash.GetFirstNRecords(1000000);
-    else for (auto* r: playerTrie.GetFirstNRecords(1000000)) recs.push_back(*r);
-
-    for (const auto& rec: recs) {
-        auto& tup = c_stats[rec.main_character];
-        std::get<0>(tup) += rec.matches_played;
-        std::get<1>(tup) += rec.matches_won;
-    }
-    int i=0;
-    for (const auto& kv : c_stats) {
-        const std::string& k = kv.first;
-        int played = std::get<0>(kv.second);
-        int won    = std::get<1>(kv.second);
-        m_charResultList->InsertItem(i, k);
-        m_charResultList->SetItem(i,1, wxString::Format("%d", played));
-        m_charResultList->SetItem(i,2, wxString::Format("%d", won));
-        m_charResultList->SetItem(i,3, wxString::Format("%.2f", played?100.0*won/played:0.0));
+    if (!matchupMatrix) return;
+    auto start = std::chrono::steady_clock::now();
+    // The whole matrix is precomputed; only the display order is worked out here
+    const MatchupMatrix& m = *matchupMatrix;
+    std::shared_ptr<const std::vector<int>> cached = queryCache.Find<std::vector<int>>(QUERY_CHAR_ALL, "", dataVersion);
+    if (!cached) {
+        auto sorted = std::make_shared<std::vector<int>>();
+        for (size_t c = 0; c < m.CharacterCount(); ++c)
+            if (!m.CharacterName((int)c).empty() && m.Overall((int)c).games > 0) sorted->push_back((int)c);
+        std::sort(sorted->begin(), sorted->end(), [&m](int a, int b) {
+            return m.CharacterName(a) < m.CharacterName(b);
+        });
+        cached = sorted;
+        queryCache.Put(QUERY_CHAR_ALL, "", dataVersion, cached);
+    }
+    const std::vector<int>& order = *cached;
+    Metrics_RecordLatency(METRIC_OP_CHAR_AGGREGATE, METRIC_COLUMNS, nsSince(start));
+    setCharacterColumns(m_charResultList, &m, order);
+    long i = 0;
+    for (int a : order) {
+        const MatchupMatrix::Totals& all = m.Overall(a);
+        m_charResultList->InsertItem(i, wxString::FromUTF8(m.CharacterName(a)));
+        m_charResultList->SetItem(i,1, wxString::Format("%llu", (unsigned long long)all.games));
+        m_charResultList->SetItem(i,2, wxString::Format("%llu", (unsigned long long)all.wins));
+        m_charResultList->SetItem(i,3, wxString::Format("%.2f", all.WinRate()*100.0));
+        for (size_t j = 0; j < order.size(); ++j) {
+            MatchupMatrix::Totals t = m.Matchup(a, order[j]);
+            if (t.games > 0) m_charResultList->SetItem(i, (int)(4 + j), wxString::Format("%.1f", t.WinRate()*100.0));
+        }
         ++i;
     }
-    SetEfficiency(m_charEfficiencyLabel, watch.Time());
+    SetEfficiency(m_charEfficiencyLabel, msSince(start));
     UpdateVisitedRowsCounter();
 }
 
@@ -612,11 +1515,11 @@ wxPanel* MainFrame::CreateStageAnalysisPanel(wxWindow* parent) {
     hbox->Add(m_stageAnalyzeBtn, 0);
     vbox->Add(hbox, 0, wxEXPAND | wxALL, 5);
 
-    m_stageResultList = new wxListCtrl(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize,
-                    wxLC_REPORT | wxLC_SINGLE_SEL | wxLC_HRULES | wxLC_VRULES);
+    m_stageResultList = new StageResultList(panel);
 
     m_stageResultList->InsertColumn(0, "Player/Character", wxLIST_FORMAT_LEFT, 200);
     m_stageResultList->InsertColumn(1, "Win Rate (%)", wxLIST_FORMAT_RIGHT, 120);
+    m_stageResultList->InsertColumn(2, "Games", wxLIST_FORMAT_RIGHT, 100);
 
     vbox->Add(m_stageResultList, 1, wxEXPAND | wxLEFT|wxRIGHT|wxBOTTOM, 5);
     panel->SetSizer(vbox);
@@ -633,33 +1536,216 @@ void MainFrame::OnStageAnalyze(wxCommandEvent&) {
             "Sets Not Loaded!", wxOK|wxICON_WARNING, this);
         return;
     }
-    m_stageResultList->DeleteAllItems();
-    wxStopWatch watch;
-    std::vector<PlayerRecord> recs;
-    if (currentDS == HASH_TABLE) recs = playerHash.GetFirstNRecords(100000);
-    else for (auto* r: playerTrie.GetFirstNRecords(100000)) recs.push_back(*r);
-
-    int i=0;
-    for (const auto& rec: recs) {
-        wxString row = rec.name + " (" + rec.main_character + ")";
-        m_stageResultList->InsertItem(i, row);
-        m_stageResultList->SetItem(i,1, wxString::Format("%.2f", rec.win_rate*100.0));
-        ++i;
+    if (!SetIndexesReady()) return;
+    m_stageResultList->ClearRows();
+    if (!stageIndex) return;
+    auto start = std::chrono::steady_clock::now();
+    const StageIndex& idx = *stageIndex;
+    std::string query = std::string(m_stageText->GetValue().Trim().Trim(false).utf8_str());
+    auto rows = std::make_shared<StageRows>();
+    StageRows& list = *rows;
+
+    int stage = idx.StageCode(query);
+    if (stage == GameTable::kUnknownCode) {
+        // No (matching) stage entered: list the stages that can be analyzed
+        if (!query.empty())
+            list.AddHeading("No stage named \"" + wxString::FromUTF8(query) + "\"; known stages:");
+        for (size_t s = 0; s < idx.StageCount(); ++s)
+            if (idx.GamesOn((int)s) > 0)
+                list.AddRow(wxString::FromUTF8(idx.StageName((int)s)), -1.0, idx.GamesOn((int)s));
+        m_stageResultList->SetRows(rows);
+        SetEfficiency(m_stageEfficiencyLabel, msSince(start));
+        return;
+    }
+    // Any spelling of the stage name resolves to the same code
+    std::string params = std::to_string(stage);
+    if (std::shared_ptr<const StageRows> cached = queryCache.Find<StageRows>(QUERY_STAGE, params, dataVersion)) {
+        m_stageResultList->SetRows(cached);
+        SetEfficiency(m_stageEfficiencyLabel, msSince(start));
+        return;
     }
-    SetEfficiency(m_stageEfficiencyLabel, watch.Time());
+
+    // Win rates on the stage per character, then the best players on it
+    list.AddHeading("Games on " + wxString::FromUTF8(idx.StageName(stage)), idx.GamesOn(stage));
+    const StageIndex::Counts* chars = idx.CharactersOn(stage);
+    std::vector<int> order;
+    for (size_t c = 0; c < idx.CharacterCount(); ++c)
+        if (chars[c].Games() > 0 && !idx.CharacterName((int)c).empty()) order.push_back((int)c);
+    std::sort(order.begin(), order.end(), [chars](int a, int b) {
+        return chars[a].WinRate() > chars[b].WinRate();
+    });
+    for (int c : order)
+        list.AddRow(wxString::FromUTF8(idx.CharacterName(c)), chars[c].WinRate(), chars[c].Games());
+
+    const size_t kBestPlayers = 50;
+    const uint32_t kMinStageGames = 5;
+    list.AddHeading(wxString::Format("Best players (%u+ games)", kMinStageGames));
+    RcuReadGuard guard;
+    for (const StageIndex::PlayerCounts& p : idx.BestPlayersOn(stage, kBestPlayers, kMinStageGames)) {
+        std::string id = std::to_string(p.player);
+        const PlayerRecord* rec = playerHash->SearchByID(id);
+        wxString label = rec ? wxString::FromUTF8(rec->name) + " (" + id + ")" : wxString(id);
+        list.AddRow(label, p.counts.WinRate(), p.counts.Games());
+    }
+    queryCache.Put(QUERY_STAGE, params, dataVersion, std::shared_ptr<const StageRows>(rows));
+    m_stageResultList->SetRows(rows);
+    SetEfficiency(m_stageEfficiencyLabel, msSince(start));
     UpdateVisitedRowsCounter();
 }
 
 
+//--------------------- METRICS TAB ----------------------
+wxPanel* MainFrame::CreateMetricsPanel(wxWindow* parent) {
+    wxPanel* panel = new wxPanel(parent);
+    auto* vbox = new wxBoxSizer(wxVERTICAL);
+
+    auto* desc = new wxStaticText(panel, wxID_ANY,
+        "Latency of every query since start-up (or the last reset), per operation and structure,\n"
+        "and the loaders' row counters. Percentiles come from log-linear histograms (about 3% resolution).");
+    vbox->Add(desc, 0, wxEXPAND | wxALL, 10);
+
+    auto* hbox = new wxBoxSizer(wxHORIZONTAL);
+    m_metricsRefreshBtn = new wxButton(panel, wxID_ANY, "Refresh");
+    hbox->Add(m_metricsRefreshBtn, 0, wxRIGHT, 10);
+    m_metricsResetBtn = new wxButton(panel, wxID_ANY, "Reset");
+    hbox->Add(m_metricsResetBtn, 0, wxRIGHT, 10);
+    m_metricsSaveBtn = new wxButton(panel, wxID_ANY, "Save JSON...");
+    hbox->Add(m_metricsSaveBtn, 0);
+    vbox->Add(hbox, 0, wxALIGN_LEFT | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+
+    m_metricsLatencyList = new wxListCtrl(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize,
+                                          wxLC_REPORT | wxLC_SINGLE_SEL | wxLC_HRULES | wxLC_VRULES);
+    m_metricsLatencyList->InsertColumn(0, "Operation", wxLIST_FORMAT_LEFT, 140);
+    m_metricsLatencyList->InsertColumn(1, "Structure", wxLIST_FORMAT_LEFT, 90);
+    m_metricsLatencyList->InsertColumn(2, "Count", wxLIST_FORMAT_RIGHT, 80);
+    m_metricsLatencyList->InsertColumn(3, "p50", wxLIST_FORMAT_RIGHT, 90);
+    m_metricsLatencyList->InsertColumn(4, "p99", wxLIST_FORMAT_RIGHT, 90);
+    m_metricsLatencyList->InsertColumn(5, "p99.9", wxLIST_FORMAT_RIGHT, 90);
+    m_metricsLatencyList->InsertColumn(6, "Max", wxLIST_FORMAT_RIGHT, 90);
+    m_metricsLatencyList->InsertColumn(7, "Mean", wxLIST_FORMAT_RIGHT, 90);
+    m_metricsLatencyList->InsertColumn(8, "Throughput (ops/s)", wxLIST_FORMAT_RIGHT, 140);
+    vbox->Add(m_metricsLatencyList, 2, wxEXPAND | wxLEFT|wxRIGHT|wxBOTTOM, 10);
+
+    m_metricsCounterList = new wxListCtrl(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize,
+                                          wxLC_REPORT | wxLC_SINGLE_SEL);
+    m_metricsCounterList->InsertColumn(0, "Counter", wxLIST_FORMAT_LEFT, 200);
+    m_metricsCounterList->InsertColumn(1, "Value", wxLIST_FORMAT_RIGHT, 140);
+    vbox->Add(m_metricsCounterList, 1, wxEXPAND | wxLEFT|wxRIGHT|wxBOTTOM, 10);
+
+    panel->SetSizer(vbox);
+
+    m_metricsRefreshBtn->Bind(wxEVT_BUTTON, &MainFrame::OnMetricsRefresh, this);
+    m_metricsResetBtn->Bind(wxEVT_BUTTON, &MainFrame::OnMetricsReset, this);
+    m_metricsSaveBtn->Bind(wxEVT_BUTTON, &MainFrame::OnMetricsSave, this);
+    return panel;
+}
+
+// Latencies span nanoseconds (lookups) to seconds (hydration)
+static wxString formatNs(double ns) {
+    if (ns < 1e3) return wxString::Format("%.0f ns", ns);
+    if (ns < 1e6) return wxString::Format("%.1f us", ns / 1e3);
+    if (ns < 1e9) return wxString::Format("%.1f ms", ns / 1e6);
+    return wxString::Format("%.2f s", ns / 1e9);
+}
+
+void MainFrame::RefreshMetrics() {
+    m_metricsLatencyList->DeleteAllItems();
+    long row = 0;
+    for (const LatencySummary& s : Metrics_Latencies()) {
+        m_metricsLatencyList->InsertItem(row, Metrics_OpName(s.op));
+        m_metricsLatencyList->SetItem(row, 1, Metrics_BackendName(s.backend));
+        m_metricsLatencyList->SetItem(row, 2, wxString::Format("%llu", (unsigned long long)s.count));
+        m_metricsLatencyList->SetItem(row, 3, formatNs((double)s.p50_ns));
+        m_metricsLatencyList->SetItem(row, 4, formatNs((double)s.p99_ns));
+        m_metricsLatencyList->SetItem(row, 5, formatNs((double)s.p999_ns));
+        m_metricsLatencyList->SetItem(row, 6, formatNs((double)s.max_ns));
+        m_metricsLatencyList->SetItem(row, 7, formatNs(s.mean_ns));
+        m_metricsLatencyList->SetItem(row, 8, wxString::Format("%.1f", s.ops_per_sec));
+        ++row;
+    }
+    m_metricsCounterList->DeleteAllItems();
+    for (int c = 0; c < kMetricCounters; ++c) {
+        m_metricsCounterList->InsertItem(c, Metrics_CounterName((MetricCounter)c));
+        m_metricsCounterList->SetItem(c, 1, wxString::Format("%llu",
+            (unsigned long long)Metrics_Counter((MetricCounter)c)));
+    }
+    uint64_t hits = Metrics_Counter(METRIC_CACHE_HITS);
+    uint64_t lookups = hits + Metrics_Counter(METRIC_CACHE_MISSES);
+    m_metricsCounterList->InsertItem(kMetricCounters, "cache_hit_rate (%)");
+    m_metricsCounterList->SetItem(kMetricCounters, 1,
+        lookups ? wxString::Format("%.1f", 100.0 * hits / lookups) : wxString("---"));
+}
+void MainFrame::OnMetricsRefresh(wxCommandEvent&) { RefreshMetrics(); }
+void MainFrame::OnMetricsReset(wxCommandEvent&) {
+    Metrics_Reset();
+    RefreshMetrics();
+    UpdateVisitedRowsCounter();
+}
+void MainFrame::OnMetricsSave(wxCommandEvent&) {
+    wxFileDialog saveFileDialog(this, _("Save Metrics"), "", "metrics.json",
+        "JSON files (*.json)|*.json|All files (*.*)|*.*", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (saveFileDialog.ShowModal() == wxID_CANCEL)
+        return;
+    wxString path = saveFileDialog.GetPath();
+    if (Metrics_WriteJson(std::string(path.utf8_str())))
+        SetStatusText("Metrics saved to " + path, 0);
+    else
+        wxMessageBox("Could not write " + path, "Save Metrics", wxOK|wxICON_ERROR, this);
+}
+void MainFrame::OnPageChanged(wxBookCtrlEvent& event) {
+    if (notebook && notebook->GetPage(event.GetSelection()) == m_metricsLatencyList->GetParent())
+        RefreshMetrics();
+    event.Skip();
+}
+
+
 //---------------------- MENU HANDLERS --------------------
-void MainFrame::OnMenuExport(wxCommandEvent&) {
-    wxFileDialog saveFileDialog(this, _("Export Results"), "", "",
-        "CSV files (*.csv)|*.csv|Text files (*.txt)|*.txt|All files (*.*)|*.*",
+// Full results are streamed to the file on the load thread, so the dialog
+// shows progress and Cancel works as it does for loads
+void MainFrame::OnMenuExport(wxCommandEvent& event) {
+    if (!setsLoaded) {
+        wxMessageBox("You must press 'Load Sets' before exporting.",
+            "Sets Not Loaded!", wxOK|wxICON_WARNING, this);
+        return;
+    }
+    const int what = event.GetId();
+    if (what != ID_ExportPlayers && !SetIndexesReady()) return;
+    wxString name = what == ID_ExportPlayers ? "players" : what == ID_ExportMatchups ? "matchups" : "head_to_head";
+    wxFileDialog saveFileDialog(this, _("Export Results"), "", name,
+        "CSV files (*.csv)|*.csv|Columnar binary (*.smcol)|*.smcol",
         wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
     if (saveFileDialog.ShowModal() == wxID_CANCEL)
         return;
-    wxString path = saveFileDialog.GetPath();
-    wxLogMessage("Exported to %s", path);
+    std::string path = saveFileDialog.GetPath().ToStdString();
+    ExportFormat format = saveFileDialog.GetFilterIndex() == 1 ? EXPORT_COLUMNAR : EXPORT_CSV;
+
+    // The job holds its own references, so a reload swapping the structures
+    // out cannot free them mid-export
+    std::shared_ptr<PlayerHashTable> hash = playerHash;
+    std::shared_ptr<MatchupMatrix> matchups = matchupMatrix;
+    std::shared_ptr<SetPairIndex> pairs = playerPairs;
+    auto rows = std::make_shared<size_t>(0);
+    auto watch = std::make_shared<wxStopWatch>();
+
+    StartLoadJob("Exporting " + name + "...",
+        [what, path, format, hash, matchups, pairs, rows](LoadMonitor& monitor) {
+            if (what == ID_ExportPlayers)
+                return hash && Export_Players(path, format, *hash, &monitor, rows.get());
+            if (what == ID_ExportMatchups)
+                return matchups && Export_Matchups(path, format, *matchups, &monitor, rows.get());
+            return pairs && Export_HeadToHead(path, format, *pairs, &monitor, rows.get());
+        },
+        [this, path, rows, watch](bool ok, bool cancelled) {
+            if (cancelled) {
+                SetStatusText("Export cancelled", 0);
+                return;
+            }
+            if (!ok) {
+                wxMessageBox("Could not write " + wxString(path), "Export Failed", wxOK|wxICON_ERROR, this);
+                return;
+            }
+            SetStatusText(wxString::Format("Exported %zu rows to %s in %ld ms", *rows, path.c_str(), watch->Time()), 0);
+        });
 }
 void MainFrame::OnMenuExit(wxCommandEvent&) { Close(true); }
 void MainFrame::OnAbout(wxCommandEvent&) {
@@ -4,8 +4,26 @@
 #include <wx/notebook.h>
 #include <wx/choice.h>
 #include <wx/gauge.h>
+#include <wx/spinctrl.h>
 #include <string>
+#include <memory>
+#include <thread>
+#include <functional>
 #include "backend.h"
+#include "querycache.h"
+
+class PlayerFuzzyIndex;
+class PlayerColumns;
+class SetPairIndex;
+class StageIndex;
+class MatchupMatrix;
+class PlayerResultList;
+class StageResultList;
+
+// Posted by the background loader thread: progress (payload LoadProgress)
+// and completion (GetInt() == 1 on success)
+wxDECLARE_EVENT(EVT_LOAD_PROGRESS, wxThreadEvent);
+wxDECLARE_EVENT(EVT_LOAD_DONE, wxThreadEvent);
 
 //--------------------------------------------------
 // GLOBAL flag for sets/stat hydration state
@@ -37,14 +55,29 @@ public:
 class MainFrame : public wxFrame {
 public:
     MainFrame(const wxString& title);
+    ~MainFrame();
 
 private:
     // Global UI
     wxNotebook* notebook = nullptr;
     wxString dbPath;
-    // Data structures
-    PlayerHashTable playerHash;
-    PlayerTrie playerTrie;
+    // Data structures; a background load builds fresh instances and swaps
+    // them in when it finishes, so queries keep using the previous data.
+    // playerTrie is also read by the tag completers: replace it with atomic_store.
+    std::shared_ptr<PlayerHashTable> playerHash;
+    std::shared_ptr<PlayerTrie> playerTrie;
+    // Typo-tolerant tag index, rebuilt whenever stats are (re)loaded
+    std::shared_ptr<PlayerFuzzyIndex> playerFuzzy;
+    // Column store behind the character and stage tabs, rebuilt with the stats
+    std::shared_ptr<PlayerColumns> playerColumns;
+    std::shared_ptr<SetPairIndex> playerPairs;
+    std::shared_ptr<StageIndex> stageIndex;
+    std::shared_ptr<MatchupMatrix> matchupMatrix;
+    HighWaterMarks loadMarks;   // where the loaded data ends in each table
+    // Bumped whenever a load or refresh changes the data above; results
+    // cached under an older version are never served
+    uint64_t dataVersion = 0;
+    QueryCache queryCache;
     // User choice for active data structure
     DataStructureChoice currentDS = HASH_TABLE;
 
@@ -56,6 +89,8 @@ private:
     //--------------------------------------------------
     wxChoice*      m_perfDSChoice         = nullptr;
     wxButton*      m_perfRunBtn           = nullptr;
+    wxSpinCtrl*    m_perfThreadsSpin      = nullptr;
+    wxButton*      m_perfScaleBtn         = nullptr;
     wxListCtrl*    m_perfResultList       = nullptr;
     wxStaticText*  m_perfEfficiencyLabel  = nullptr;
     wxStaticText*  m_perfStatusLabel      = nullptr;
@@ -68,7 +103,8 @@ private:
     wxButton*      m_playerSearchBtn      = nullptr;
     wxButton*      m_playerLoadBtn        = nullptr;
     wxButton*      m_playerLoadSetsBtn    = nullptr;
-    wxListCtrl*    m_playerResultList     = nullptr;
+    wxButton*      m_playerRefreshBtn     = nullptr;
+    PlayerResultList* m_playerResultList  = nullptr;
     wxStaticText*  m_playerEfficiencyLabel = nullptr;
 
     //--------------------------------------------------
@@ -98,11 +134,27 @@ private:
     wxChoice*      m_stageDSChoice        = nullptr;
     wxTextCtrl*    m_stageText            = nullptr;
     wxButton*      m_stageAnalyzeBtn      = nullptr;
-    wxListCtrl*    m_stageResultList      = nullptr;
+    StageResultList* m_stageResultList    = nullptr;
     wxStaticText*  m_stageEfficiencyLabel = nullptr;
 
+    //--------------------------------------------------
+    // Metrics Tab Widgets
+    //--------------------------------------------------
+    wxButton*      m_metricsRefreshBtn    = nullptr;
+    wxButton*      m_metricsResetBtn      = nullptr;
+    wxButton*      m_metricsSaveBtn       = nullptr;
+    wxListCtrl*    m_metricsLatencyList   = nullptr;
+    wxListCtrl*    m_metricsCounterList   = nullptr;
+
     // Busy/loading dialog
     wxDialog*      m_loadingDialog        = nullptr;
+    wxGauge*       m_loadingGauge         = nullptr;
+    wxStaticText*  m_loadingText          = nullptr;
+
+    // Background load job (one at a time)
+    std::thread                   m_loadThread;
+    std::shared_ptr<LoadMonitor>  m_loadMonitor;
+    std::function<void(bool, bool)> m_loadDone;
 
     //--------------------------------------------------
     // Panel creation helpers
@@ -112,6 +164,7 @@ private:
     wxPanel* CreateHeadToHeadPanel(wxWindow* parent);
     wxPanel* CreateCharacterMatchupPanel(wxWindow* parent);
     wxPanel* CreateStageAnalysisPanel(wxWindow* parent);
+    wxPanel* CreateMetricsPanel(wxWindow* parent);
 
     //--------------------------------------------------
     // Menu event handlers
@@ -125,11 +178,19 @@ private:
     //--------------------------------------------------
     void OnPerfRun(wxCommandEvent& event);
     void OnPerfDSChoice(wxCommandEvent& event);
+    void OnPerfThreads(wxSpinEvent& event);
+    void OnPerfScale(wxCommandEvent& event);
 
     void OnPlayerDSChoice(wxCommandEvent& event);
     void OnPlayerSearch(wxCommandEvent& event);
+    const PlayerRecord* FindPlayer(const std::string& query, RecordPin* pin = nullptr) const;
     void OnPlayerLoad(wxCommandEvent& event);
     void OnPlayerLoadSets(wxCommandEvent& event);
+    void OnPlayerRefresh(wxCommandEvent& event);
+    void StartSetsLoad(bool interactive);
+    void LoadStartupSnapshot();
+    void LoadSnapshotIndexes(const HighWaterMarks& marks, long snapshotMs);
+    bool SetIndexesReady();
 
     void OnHeadDSChoice(wxCommandEvent& event);
     void OnHeadCompare(wxCommandEvent& event);
@@ -141,11 +202,25 @@ private:
     void OnStageDSChoice(wxCommandEvent& event);
     void OnStageAnalyze(wxCommandEvent& event);
 
+    void OnMetricsRefresh(wxCommandEvent& event);
+    void OnMetricsReset(wxCommandEvent& event);
+    void OnMetricsSave(wxCommandEvent& event);
+    void OnPageChanged(wxBookCtrlEvent& event);
+    void RefreshMetrics();
+
     //--------------------------------------------------
     // Helpers
     //--------------------------------------------------
     void BusyStart(const wxString& label);
     void BusyEnd();
+    // Runs work on a background thread; done(ok, cancelled) runs on the GUI thread afterwards
+    bool StartLoadJob(const wxString& label,
+                      std::function<bool(LoadMonitor&)> work,
+                      std::function<void(bool, bool)> done);
+    void OnLoadProgress(wxThreadEvent& event);
+    void OnLoadDone(wxThreadEvent& event);
+    void OnLoadCancel(wxCommandEvent& event);
+    void OnClose(wxCloseEvent& event);
     void SetEfficiency(wxStaticText* label, double ms);
 
     wxDECLARE_EVENT_TABLE();
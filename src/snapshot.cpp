@@ -0,0 +1,728 @@
+#include "snapshot.h"
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// --- On-disk layout (native endianness, all offsets from file start) ---
+static const char     kSnapshotMagic[8] = {'S','M','S','N','A','P','\0','\0'};
+static const uint32_t kSnapshotVersion  = 6;   // 2: Robin Hood slot layout, 3: sets, 4: games, 5: marks,
+                                                // 6: refreshes appended
+
+struct SnapshotHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    uint64_t file_bytes;
+    uint64_t db_size;
+    int64_t  db_mtime;
+    uint32_t record_count;
+    uint32_t hash_capacity;
+    uint32_t trie_count;
+    uint32_t reserved;
+    uint64_t records_off;      // SnapshotRecord[record_count]
+    uint64_t strings_off;      // char[strings_bytes]
+    uint64_t strings_bytes;
+    uint64_t name_slots_off;   // uint32_t[hash_capacity]
+    uint64_t id_slots_off;     // uint32_t[hash_capacity]
+    uint64_t trie_off;         // uint32_t[trie_count], record indices
+    uint32_t set_count;
+    uint32_t reserved2;
+    uint64_t sets_off;         // SnapshotSet[set_count]
+    uint32_t game_count;
+    uint32_t character_count;
+    uint32_t stage_count;
+    uint32_t reserved3;
+    uint64_t games_off;        // SnapshotGame[game_count]
+    uint64_t characters_off;   // SnapshotName[character_count], game character dictionary
+    uint64_t stages_off;       // SnapshotName[stage_count]
+    int64_t  players_mark;     // HighWaterMarks of the load that wrote the snapshot
+    int64_t  sets_mark;
+};
+
+struct SnapshotRecord {
+    uint32_t id_off, id_len;
+    uint32_t name_off, name_len;
+    uint32_t char_off, char_len;
+    int32_t  matches_played;
+    int32_t  matches_won;
+    double   win_rate;
+    uint32_t stats_loaded;
+    uint32_t reserved;
+};
+
+struct SnapshotSet {
+    int64_t  rowid;
+    int64_t  p1, p2, winner;
+    int32_t  p1_score, p2_score;
+    uint32_t tournament_off, tournament_len;
+};
+
+struct SnapshotGame {
+    int64_t  winner, loser;
+    uint16_t winner_char, loser_char, stage;
+    uint16_t reserved;
+};
+
+struct SnapshotName {
+    uint32_t off, len;
+};
+
+// A refresh appended after the base image, at the next multiple of 8 past
+// the image or the segment before it. Offsets are from the segment start;
+// its stamp and marks supersede the ones before it.
+static const char kDeltaMagic[8] = {'S','M','D','E','L','T','A','\0'};
+
+struct SnapshotDelta {
+    char     magic[8];
+    uint32_t header_bytes;
+    uint32_t record_count;
+    uint64_t segment_bytes;    // header included
+    uint64_t db_size;
+    int64_t  db_mtime;
+    int64_t  from_players_mark;   // marks the refresh started from
+    int64_t  from_sets_mark;
+    int64_t  players_mark;
+    int64_t  sets_mark;
+    uint32_t set_count;
+    uint32_t game_count;
+    uint32_t character_count;
+    uint32_t stage_count;
+    uint64_t records_off;      // SnapshotRecord[record_count], the players it changed, by row
+    uint64_t sets_off;         // SnapshotSet[set_count]
+    uint64_t games_off;        // SnapshotGame[game_count], coded in the segment's dictionaries
+    uint64_t characters_off;   // SnapshotName[character_count]
+    uint64_t stages_off;       // SnapshotName[stage_count]
+    uint64_t strings_off;      // char[strings_bytes]
+    uint64_t strings_bytes;
+};
+
+// --- Read-only memory mapping of a whole file ---
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(file_, &sz) || sz.QuadPart == 0) return;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) return;
+        data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (data_) size_ = (size_t)sz.QuadPart;
+#else
+        fd_ = open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) return;
+        struct stat st;
+        if (fstat(fd_, &st) != 0 || st.st_size == 0) return;
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (p == MAP_FAILED) return;
+        data_ = static_cast<const char*>(p);
+        size_ = (size_t)st.st_size;
+#endif
+    }
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_) munmap(const_cast<char*>(data_), size_);
+        if (fd_ >= 0) close(fd_);
+#endif
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+static bool statFile(const std::string& path, uint64_t& size, int64_t& mtime) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    size = (uint64_t)st.st_size;
+    mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+static bool sectionFits(uint64_t off, uint64_t bytes, uint64_t file_bytes) {
+    return off <= file_bytes && bytes <= file_bytes - off;
+}
+static uint64_t alignUp8(uint64_t n) {
+    return (n + 7) & ~(uint64_t)7;
+}
+
+std::string BackendSnapshot_PathFor(const std::string& db_path) {
+    return db_path + ".snap";
+}
+
+bool BackendSnapshot_StampDB(const std::string& db_path, SnapshotStamp& out) {
+    return statFile(db_path, out.db_size, out.db_mtime);
+}
+
+// --- Packing, shared by the base image and the appended refreshes ---
+static void poolString(std::string& strings, const std::string& str, uint32_t& off, uint32_t& len) {
+    off = (uint32_t)strings.size();
+    len = (uint32_t)str.size();
+    strings += str;
+}
+
+static void packRecords(const std::vector<PlayerRecord>& records, std::string& strings,
+                        std::vector<SnapshotRecord>& out) {
+    out.resize(records.size());
+    std::unordered_map<const std::string*, uint32_t> characterOff;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const PlayerRecord& r = records[i];
+        SnapshotRecord& p = out[i];
+        std::memset(&p, 0, sizeof(p));
+        poolString(strings, r.id, p.id_off, p.id_len);
+        poolString(strings, r.name, p.name_off, p.name_len);
+        // Main characters are pooled, so each distinct one is written once
+        const std::string& main = r.main_character;
+        auto it = characterOff.find(&main);
+        if (it == characterOff.end()) {
+            it = characterOff.emplace(&main, (uint32_t)strings.size()).first;
+            strings += main;
+        }
+        p.char_off = it->second;
+        p.char_len = (uint32_t)main.size();
+        p.matches_played = r.matches_played;
+        p.matches_won = r.matches_won;
+        p.win_rate = r.win_rate;
+        p.stats_loaded = r.stats_loaded ? 1 : 0;
+    }
+}
+
+static void packSets(const std::vector<SetSummary>& sets, std::string& strings, std::vector<SnapshotSet>& out) {
+    out.resize(sets.size());
+    // Tournament keys repeat across every set of an event; pool each once
+    std::unordered_map<const std::string*, uint32_t> tournamentOff;   // keyed by pooled value
+    for (size_t i = 0; i < sets.size(); ++i) {
+        const SetSummary& s = sets[i];
+        SnapshotSet& p = out[i];
+        std::memset(&p, 0, sizeof(p));
+        p.rowid = s.rowid;
+        p.p1 = s.p1;
+        p.p2 = s.p2;
+        p.winner = s.winner;
+        p.p1_score = s.p1_score;
+        p.p2_score = s.p2_score;
+        const std::string& key = s.tournament;
+        auto it = tournamentOff.find(&key);
+        if (it == tournamentOff.end()) {
+            it = tournamentOff.emplace(&key, (uint32_t)strings.size()).first;
+            strings += key;
+        }
+        p.tournament_off = it->second;
+        p.tournament_len = (uint32_t)s.tournament.size();
+    }
+}
+
+static void packGames(const GameTable& games, std::string& strings, std::vector<SnapshotGame>& out,
+                      std::vector<SnapshotName>& characters, std::vector<SnapshotName>& stages) {
+    out.resize(games.Games().size());
+    for (size_t i = 0; i < out.size(); ++i) {
+        const GameTable::Game& g = games.Games()[i];
+        out[i] = {g.winner, g.loser, g.winner_char, g.loser_char, g.stage, 0};
+    }
+    auto poolNames = [&strings](const std::vector<std::string>& names, std::vector<SnapshotName>& to) {
+        for (const std::string& n : names) {
+            to.push_back({(uint32_t)strings.size(), (uint32_t)n.size()});
+            strings += n;
+        }
+    };
+    poolNames(games.Characters(), characters);
+    poolNames(games.Stages(), stages);
+}
+
+template <typename T>
+static void writeArray(std::ofstream& out, const std::vector<T>& items) {
+    out.write(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T));
+}
+
+// --- Writer ---
+bool BackendSnapshot_Save(const std::string& db_path, const SnapshotStamp& stamp,
+                          const PlayerHashTable& hash, const PlayerTrie& trie,
+                          const std::vector<SetSummary>* sets, const GameTable* games,
+                          const HighWaterMarks* marks) {
+    SnapshotHeader hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    std::memcpy(hdr.magic, kSnapshotMagic, sizeof(hdr.magic));
+    hdr.version = kSnapshotVersion;
+    hdr.header_bytes = sizeof(SnapshotHeader);
+    if (marks) {
+        hdr.players_mark = marks->players;
+        hdr.sets_mark = marks->sets;
+    }
+    hdr.db_size = stamp.db_size;
+    hdr.db_mtime = stamp.db_mtime;
+
+    std::vector<PlayerRecord> records;
+    std::vector<uint32_t> nameSlots, idSlots;
+    hash.ExportSlots(records, nameSlots, idSlots);
+
+    // Trie records are matched to the hash records by ID; leftovers are appended
+    std::unordered_map<std::string, uint32_t> index_of;
+    for (uint32_t i = 0; i < records.size(); ++i) index_of[records[i].id] = i;
+    std::vector<uint32_t> trieIdx;
+    trieIdx.reserve(trie.Size());
+    trie.ForEachRecord([&](const PlayerRecord& rec) {
+        auto it = index_of.find(rec.id);
+        if (it != index_of.end() && records[it->second].name == rec.name) {
+            trieIdx.push_back(it->second);
+        } else {
+            trieIdx.push_back((uint32_t)records.size());
+            records.push_back(rec);
+        }
+    });
+
+    std::string strings;
+    std::vector<SnapshotRecord> packed;
+    packRecords(records, strings, packed);
+    std::vector<SnapshotSet> packedSets;
+    if (sets) packSets(*sets, strings, packedSets);
+    std::vector<SnapshotGame> packedGames;
+    std::vector<SnapshotName> characterNames, stageNames;
+    if (games) packGames(*games, strings, packedGames, characterNames, stageNames);
+    if (strings.size() > std::numeric_limits<uint32_t>::max()) {
+        std::cerr << "Snapshot: string pool too large" << std::endl;
+        return false;
+    }
+
+    hdr.record_count  = (uint32_t)records.size();
+    hdr.hash_capacity = (uint32_t)nameSlots.size();
+    hdr.trie_count    = (uint32_t)trieIdx.size();
+    hdr.set_count     = (uint32_t)packedSets.size();
+    hdr.game_count      = (uint32_t)packedGames.size();
+    hdr.character_count = (uint32_t)characterNames.size();
+    hdr.stage_count     = (uint32_t)stageNames.size();
+    hdr.records_off    = sizeof(SnapshotHeader);
+    hdr.sets_off       = hdr.records_off + packed.size() * sizeof(SnapshotRecord);
+    hdr.games_off      = hdr.sets_off + packedSets.size() * sizeof(SnapshotSet);
+    hdr.characters_off = hdr.games_off + packedGames.size() * sizeof(SnapshotGame);
+    hdr.stages_off     = hdr.characters_off + characterNames.size() * sizeof(SnapshotName);
+    hdr.name_slots_off = hdr.stages_off + stageNames.size() * sizeof(SnapshotName);
+    hdr.id_slots_off   = hdr.name_slots_off + nameSlots.size() * sizeof(uint32_t);
+    hdr.trie_off       = hdr.id_slots_off + idSlots.size() * sizeof(uint32_t);
+    hdr.strings_off    = hdr.trie_off + trieIdx.size() * sizeof(uint32_t);
+    hdr.strings_bytes  = strings.size();
+    hdr.file_bytes     = hdr.strings_off + hdr.strings_bytes;
+
+    // Write to a temporary file and rename so a crash never leaves a torn snapshot
+    std::string path = BackendSnapshot_PathFor(db_path);
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Snapshot: cannot open " << tmp << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        writeArray(out, packed);
+        writeArray(out, packedSets);
+        writeArray(out, packedGames);
+        writeArray(out, characterNames);
+        writeArray(out, stageNames);
+        writeArray(out, nameSlots);
+        writeArray(out, idSlots);
+        writeArray(out, trieIdx);
+        out.write(strings.data(), strings.size());
+        if (!out) {
+            std::cerr << "Snapshot: write failed for " << tmp << std::endl;
+            out.close();
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    std::remove(path.c_str());
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Snapshot: cannot rename " << tmp << std::endl;
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// --- Reader ---
+// The base image plus the refreshes appended after it that continue it
+struct SnapshotLayout {
+    SnapshotHeader hdr;
+    std::vector<std::pair<uint64_t, SnapshotDelta>> deltas;   // segment offset, header
+    uint64_t end = 0;                                          // where the last valid segment ends
+
+    SnapshotStamp Stamp() const {
+        if (deltas.empty()) return {hdr.db_size, hdr.db_mtime};
+        return {deltas.back().second.db_size, deltas.back().second.db_mtime};
+    }
+    HighWaterMarks Marks() const {
+        HighWaterMarks m;
+        m.players = deltas.empty() ? hdr.players_mark : deltas.back().second.players_mark;
+        m.sets = deltas.empty() ? hdr.sets_mark : deltas.back().second.sets_mark;
+        return m;
+    }
+};
+
+// A segment is taken only whole and only if it starts from the marks the
+// ones before it ended at; a torn append ends the list
+static void findDeltas(const MappedFile& file, SnapshotLayout& layout) {
+    HighWaterMarks at = layout.Marks();
+    uint64_t off = alignUp8(layout.hdr.file_bytes);
+    layout.end = layout.hdr.file_bytes;
+    while (sectionFits(off, sizeof(SnapshotDelta), file.size())) {
+        SnapshotDelta d;
+        std::memcpy(&d, file.data() + off, sizeof(d));
+        if (std::memcmp(d.magic, kDeltaMagic, sizeof(d.magic)) != 0 || d.header_bytes != sizeof(SnapshotDelta) ||
+            !sectionFits(off, d.segment_bytes, file.size()) ||
+            d.from_players_mark != at.players || d.from_sets_mark != at.sets)
+            return;
+        uint64_t n = d.segment_bytes;
+        if (!sectionFits(d.records_off, (uint64_t)d.record_count * sizeof(SnapshotRecord), n) ||
+            !sectionFits(d.sets_off, (uint64_t)d.set_count * sizeof(SnapshotSet), n) ||
+            !sectionFits(d.games_off, (uint64_t)d.game_count * sizeof(SnapshotGame), n) ||
+            !sectionFits(d.characters_off, (uint64_t)d.character_count * sizeof(SnapshotName), n) ||
+            !sectionFits(d.stages_off, (uint64_t)d.stage_count * sizeof(SnapshotName), n) ||
+            !sectionFits(d.strings_off, d.strings_bytes, n))
+            return;
+        layout.deltas.emplace_back(off, d);
+        at.players = d.players_mark;
+        at.sets = d.sets_mark;
+        layout.end = off + d.segment_bytes;
+        off = alignUp8(layout.end);
+    }
+}
+
+// Checks the header, that every section lies inside the file and which
+// refreshes were appended; with check_db, also that the last of them (or the
+// image, without any) was written for the database as it is now
+static SnapshotStatus openSnapshot(const std::string& db_path, const MappedFile& file,
+                                   SnapshotLayout& layout, bool check_db) {
+    if (!file.data()) return SNAPSHOT_MISSING;
+    if (file.size() < sizeof(SnapshotHeader)) return SNAPSHOT_INVALID;
+
+    SnapshotHeader& hdr = layout.hdr;
+    std::memcpy(&hdr, file.data(), sizeof(hdr));
+    if (std::memcmp(hdr.magic, kSnapshotMagic, sizeof(hdr.magic)) != 0 ||
+        hdr.version != kSnapshotVersion || hdr.header_bytes != sizeof(SnapshotHeader) ||
+        hdr.file_bytes > file.size())
+        return SNAPSHOT_INVALID;
+
+    uint64_t n = hdr.file_bytes;
+    if (!sectionFits(hdr.records_off, (uint64_t)hdr.record_count * sizeof(SnapshotRecord), n) ||
+        !sectionFits(hdr.sets_off, (uint64_t)hdr.set_count * sizeof(SnapshotSet), n) ||
+        !sectionFits(hdr.games_off, (uint64_t)hdr.game_count * sizeof(SnapshotGame), n) ||
+        !sectionFits(hdr.characters_off, (uint64_t)hdr.character_count * sizeof(SnapshotName), n) ||
+        !sectionFits(hdr.stages_off, (uint64_t)hdr.stage_count * sizeof(SnapshotName), n) ||
+        !sectionFits(hdr.name_slots_off, (uint64_t)hdr.hash_capacity * sizeof(uint32_t), n) ||
+        !sectionFits(hdr.id_slots_off, (uint64_t)hdr.hash_capacity * sizeof(uint32_t), n) ||
+        !sectionFits(hdr.trie_off, (uint64_t)hdr.trie_count * sizeof(uint32_t), n) ||
+        !sectionFits(hdr.strings_off, hdr.strings_bytes, n))
+        return SNAPSHOT_INVALID;
+    findDeltas(file, layout);
+
+    SnapshotStamp now, written = layout.Stamp();
+    if (check_db && (!BackendSnapshot_StampDB(db_path, now) || now.db_size != written.db_size ||
+                     now.db_mtime != written.db_mtime))
+        return SNAPSHOT_STALE;
+    return SNAPSHOT_OK;
+}
+
+// The string pool of the image or of one segment
+struct SnapshotStrings {
+    const char* data;
+    uint64_t bytes;
+    bool Fits(uint32_t off, uint32_t len) const { return (uint64_t)off + len <= bytes; }
+    std::string_view View(uint32_t off, uint32_t len) const { return std::string_view(data + off, len); }
+};
+
+// Every section starts at a multiple of its element alignment, so it is read in place
+static bool unpackRecords(const SnapshotRecord* packed, uint32_t count, const SnapshotStrings& strings,
+                          std::vector<PlayerRecord>& out) {
+    std::vector<PlayerRecord> records(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const SnapshotRecord& p = packed[i];
+        if (!strings.Fits(p.id_off, p.id_len) || !strings.Fits(p.name_off, p.name_len) ||
+            !strings.Fits(p.char_off, p.char_len))
+            return false;
+        PlayerRecord& r = records[i];
+        r.id.assign(strings.View(p.id_off, p.id_len));
+        r.name.assign(strings.View(p.name_off, p.name_len));
+        r.main_character = PooledString::Intern(strings.View(p.char_off, p.char_len));
+        r.matches_played = p.matches_played;
+        r.matches_won = p.matches_won;
+        r.win_rate = p.win_rate;
+        r.stats_loaded = p.stats_loaded != 0;
+    }
+    out.swap(records);
+    return true;
+}
+
+// Appends to out
+static bool unpackSets(const SnapshotSet* packed, uint32_t count, const SnapshotStrings& strings,
+                       std::vector<SetSummary>& out) {
+    out.reserve(out.size() + count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const SnapshotSet& p = packed[i];
+        if (!strings.Fits(p.tournament_off, p.tournament_len)) return false;
+        SetSummary s;
+        s.rowid = p.rowid;
+        s.p1 = p.p1;
+        s.p2 = p.p2;
+        s.winner = p.winner;
+        s.p1_score = p.p1_score;
+        s.p2_score = p.p2_score;
+        s.tournament = PooledString::Intern(strings.View(p.tournament_off, p.tournament_len));
+        out.push_back(s);
+    }
+    return true;
+}
+
+// Interning the dictionaries in order reproduces the saved codes
+static bool unpackGames(const SnapshotGame* packed, uint32_t count,
+                        const SnapshotName* characters, uint32_t character_count,
+                        const SnapshotName* stages, uint32_t stage_count,
+                        const SnapshotStrings& strings, GameTable& out) {
+    GameTable gameTable;
+    auto internAll = [&](const SnapshotName* names, uint32_t n, bool stage) {
+        for (uint32_t i = 0; i < n; ++i) {
+            if (!strings.Fits(names[i].off, names[i].len)) return false;
+            std::string name(strings.View(names[i].off, names[i].len));
+            if ((stage ? gameTable.InternStage(name) : gameTable.InternCharacter(name)) != i) return false;
+        }
+        return true;
+    };
+    if (!internAll(characters, character_count, false) || !internAll(stages, stage_count, true))
+        return false;
+    gameTable.Reserve(count);
+    auto valid = [](uint16_t code, uint32_t n) { return code < n || code == GameTable::kOtherCode; };
+    for (uint32_t i = 0; i < count; ++i) {
+        const SnapshotGame& g = packed[i];
+        if (!valid(g.winner_char, character_count) || !valid(g.loser_char, character_count) ||
+            !valid(g.stage, stage_count))
+            return false;
+        gameTable.AddGame({g.winner, g.loser, g.winner_char, g.loser_char, g.stage});
+    }
+    std::swap(out, gameTable);
+    return true;
+}
+
+template <typename T>
+static const T* sectionAt(const MappedFile& file, uint64_t off) {
+    return reinterpret_cast<const T*>(file.data() + off);
+}
+
+// The image's sets and games followed by every appended refresh's
+static bool readSetsAndGames(const MappedFile& file, const SnapshotLayout& layout,
+                             std::vector<SetSummary>* sets, GameTable* games) {
+    const SnapshotHeader& hdr = layout.hdr;
+    SnapshotStrings strings{file.data() + hdr.strings_off, hdr.strings_bytes};
+    std::vector<SetSummary> setRows;
+    GameTable gameTable;
+    if (sets && !unpackSets(sectionAt<SnapshotSet>(file, hdr.sets_off), hdr.set_count, strings, setRows))
+        return false;
+    if (games && !unpackGames(sectionAt<SnapshotGame>(file, hdr.games_off), hdr.game_count,
+                              sectionAt<SnapshotName>(file, hdr.characters_off), hdr.character_count,
+                              sectionAt<SnapshotName>(file, hdr.stages_off), hdr.stage_count, strings, gameTable))
+        return false;
+    for (const auto& seg : layout.deltas) {
+        const uint64_t at = seg.first;
+        const SnapshotDelta& d = seg.second;
+        SnapshotStrings segStrings{file.data() + at + d.strings_off, d.strings_bytes};
+        if (sets && !unpackSets(sectionAt<SnapshotSet>(file, at + d.sets_off), d.set_count, segStrings, setRows))
+            return false;
+        GameTable added;
+        if (games && !unpackGames(sectionAt<SnapshotGame>(file, at + d.games_off), d.game_count,
+                                  sectionAt<SnapshotName>(file, at + d.characters_off), d.character_count,
+                                  sectionAt<SnapshotName>(file, at + d.stages_off), d.stage_count,
+                                  segStrings, added))
+            return false;
+        if (games) gameTable.Append(added);
+    }
+    if (sets) sets->swap(setRows);
+    if (games) std::swap(*games, gameTable);
+    return true;
+}
+
+// Replays a refresh's players as BackendDB_Refresh applied them: a known ID
+// is updated in place and its trie record under an old tag dropped
+static void applyRefreshed(PlayerHashTable& hash, PlayerTrie& trie, std::vector<PlayerRecord>& records) {
+    {
+        RcuReadGuard guard;
+        for (PlayerRecord& rec : records) {
+            const PlayerRecord* old = hash.SearchByID(rec.id);
+            if (old && old->name != rec.name) trie.Erase(old->name, rec.id);
+            hash.Insert(rec);
+            trie.Insert(std::move(rec));
+        }
+    }
+    hash.Publish();
+    trie.Publish();
+}
+
+// Only the players: the sets and games behind the set-level indexes are
+// decoded by BackendSnapshot_LoadSets, so searches can start before those
+// indexes are built
+SnapshotStatus BackendSnapshot_Load(const std::string& db_path, PlayerHashTable& hash, PlayerTrie& trie,
+                                    HighWaterMarks* marks) {
+    MappedFile file(BackendSnapshot_PathFor(db_path));
+    SnapshotLayout layout;
+    SnapshotStatus st = openSnapshot(db_path, file, layout, true);
+    if (st != SNAPSHOT_OK) return st;
+
+    const SnapshotHeader& hdr = layout.hdr;
+    const uint32_t* nameSlots = sectionAt<uint32_t>(file, hdr.name_slots_off);
+    const uint32_t* idSlots   = sectionAt<uint32_t>(file, hdr.id_slots_off);
+    const uint32_t* trieIdx   = sectionAt<uint32_t>(file, hdr.trie_off);
+    if (hdr.hash_capacity == 0 || (hdr.hash_capacity & (hdr.hash_capacity - 1)) != 0)
+        return SNAPSHOT_INVALID;
+
+    std::vector<PlayerRecord> records;
+    if (!unpackRecords(sectionAt<SnapshotRecord>(file, hdr.records_off), hdr.record_count,
+                       {file.data() + hdr.strings_off, hdr.strings_bytes}, records))
+        return SNAPSHOT_INVALID;
+    for (uint32_t i = 0; i < hdr.trie_count; ++i)
+        if (trieIdx[i] >= hdr.record_count) return SNAPSHOT_INVALID;
+    std::vector<std::vector<PlayerRecord>> refreshed(layout.deltas.size());
+    for (size_t i = 0; i < layout.deltas.size(); ++i) {
+        const uint64_t at = layout.deltas[i].first;
+        const SnapshotDelta& d = layout.deltas[i].second;
+        if (!unpackRecords(sectionAt<SnapshotRecord>(file, at + d.records_off), d.record_count,
+                           {file.data() + at + d.strings_off, d.strings_bytes}, refreshed[i]))
+            return SNAPSHOT_INVALID;
+    }
+
+    // The trie takes copies; the hash table then takes the records themselves
+    trie.Clear();
+    for (uint32_t i = 0; i < hdr.trie_count; ++i)
+        trie.Insert(records[trieIdx[i]]);
+    hash.ImportSlots(std::move(records), nameSlots, idSlots, hdr.hash_capacity);
+    hash.Publish();
+    trie.Publish();
+    for (std::vector<PlayerRecord>& players : refreshed) applyRefreshed(hash, trie, players);
+    if (marks) *marks = layout.Marks();
+    return SNAPSHOT_OK;
+}
+
+SnapshotStatus BackendSnapshot_LoadSets(const std::string& db_path, const HighWaterMarks& marks,
+                                        std::vector<SetSummary>& sets, GameTable& games) {
+    MappedFile file(BackendSnapshot_PathFor(db_path));
+    SnapshotLayout layout;
+    SnapshotStatus st = openSnapshot(db_path, file, layout, false);
+    if (st != SNAPSHOT_OK) return st;
+    HighWaterMarks at = layout.Marks();
+    if (at.players != marks.players || at.sets != marks.sets) return SNAPSHOT_STALE;
+    return readSetsAndGames(file, layout, &sets, &games) ? SNAPSHOT_OK : SNAPSHOT_INVALID;
+}
+
+// --- Catching up after a refresh ---
+// The refresh is appended as one segment: the players it changed, its sets
+// and games, and the new stamp and marks. Once the segments outgrow the
+// image, or after a torn append, the file is rewritten whole from the
+// structures and its own sets and games instead, so a refresh costs its
+// delta plus, amortized, a constant share of a rewrite.
+bool BackendSnapshot_SaveRefresh(const std::string& db_path, const SnapshotStamp& stamp,
+                                 const PlayerHashTable& hash, const PlayerTrie& trie, const HighWaterMarks& from,
+                                 const RefreshDelta& delta, const HighWaterMarks& to) {
+    std::string strings;
+    std::vector<PlayerRecord> players;
+    players.reserve(delta.players.size());
+    for (const UpdatedPlayer& p : delta.players) players.push_back(p.record);
+    std::vector<SnapshotRecord> packed;
+    packRecords(players, strings, packed);
+    std::vector<SnapshotSet> packedSets;
+    packSets(delta.sets, strings, packedSets);
+    std::vector<SnapshotGame> packedGames;
+    std::vector<SnapshotName> characterNames, stageNames;
+    packGames(delta.games, strings, packedGames, characterNames, stageNames);
+
+    SnapshotDelta d;
+    std::memset(&d, 0, sizeof(d));
+    std::memcpy(d.magic, kDeltaMagic, sizeof(d.magic));
+    d.header_bytes = sizeof(SnapshotDelta);
+    d.db_size = stamp.db_size;
+    d.db_mtime = stamp.db_mtime;
+    d.from_players_mark = from.players;
+    d.from_sets_mark = from.sets;
+    d.players_mark = to.players;
+    d.sets_mark = to.sets;
+    d.record_count    = (uint32_t)packed.size();
+    d.set_count       = (uint32_t)packedSets.size();
+    d.game_count      = (uint32_t)packedGames.size();
+    d.character_count = (uint32_t)characterNames.size();
+    d.stage_count     = (uint32_t)stageNames.size();
+    d.records_off    = sizeof(SnapshotDelta);
+    d.sets_off       = d.records_off + packed.size() * sizeof(SnapshotRecord);
+    d.games_off      = d.sets_off + packedSets.size() * sizeof(SnapshotSet);
+    d.characters_off = d.games_off + packedGames.size() * sizeof(SnapshotGame);
+    d.stages_off     = d.characters_off + characterNames.size() * sizeof(SnapshotName);
+    d.strings_off    = d.stages_off + stageNames.size() * sizeof(SnapshotName);
+    d.strings_bytes  = strings.size();
+    d.segment_bytes  = d.strings_off + d.strings_bytes;
+
+    std::string path = BackendSnapshot_PathFor(db_path);
+    uint64_t fileBytes = 0;
+    bool rewrite = false;
+    std::vector<SetSummary> sets;
+    GameTable games;
+    {
+        MappedFile file(path);
+        SnapshotLayout layout;
+        if (openSnapshot(db_path, file, layout, false) != SNAPSHOT_OK) return false;
+        HighWaterMarks at = layout.Marks();
+        if (at.players != from.players || at.sets != from.sets) return false;
+        fileBytes = file.size();
+        uint64_t appended = alignUp8(fileBytes) + d.segment_bytes - layout.hdr.file_bytes;
+        rewrite = layout.end != fileBytes || appended > layout.hdr.file_bytes ||
+                  strings.size() > std::numeric_limits<uint32_t>::max();
+        if (rewrite && !readSetsAndGames(file, layout, &sets, &games)) return false;
+    }
+    if (rewrite) {
+        sets.insert(sets.end(), delta.sets.begin(), delta.sets.end());
+        games.Append(delta.games);
+        return BackendSnapshot_Save(db_path, stamp, hash, trie, &sets, &games, &to);
+    }
+
+    // A torn append is skipped by the reader, which then finds the snapshot
+    // stale, and rewritten by the next refresh
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    if (!out) {
+        std::cerr << "Snapshot: cannot open " << path << std::endl;
+        return false;
+    }
+    static const char kPadding[8] = {};
+    out.write(kPadding, (std::streamsize)(alignUp8(fileBytes) - fileBytes));
+    out.write(reinterpret_cast<const char*>(&d), sizeof(d));
+    writeArray(out, packed);
+    writeArray(out, packedSets);
+    writeArray(out, packedGames);
+    writeArray(out, characterNames);
+    writeArray(out, stageNames);
+    out.write(strings.data(), strings.size());
+    out.flush();
+    if (!out) {
+        std::cerr << "Snapshot: write failed for " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include "backend.h"
+
+//--------------------------------------------------
+// Binary snapshot of the hydrated player state
+//--------------------------------------------------
+// Written next to the database after a successful stats load and mapped on
+// startup so the app is queryable without touching SQLite. The file holds
+// every PlayerRecord (strings in one pooled blob), the hash table's slot
+// layout, the trie's record list and, when given, the set summaries and
+// decoded games behind the set-level indexes plus the loader's high-water
+// marks, so a refresh can continue from a snapshot. The database's size and
+// mtime are stored in the header; a snapshot that does not match them is
+// stale. A refresh brings the snapshot up to date again with
+// BackendSnapshot_SaveRefresh, which appends what the refresh read, with a
+// new stamp and marks, after the image.
+
+enum SnapshotStatus {
+    SNAPSHOT_OK = 0,
+    SNAPSHOT_MISSING,
+    SNAPSHOT_STALE,
+    SNAPSHOT_INVALID
+};
+
+// The database's size and mtime, as a snapshot header records them. Taken
+// before a load opens the database, so rows written while it runs leave the
+// snapshot stale instead of being stamped as read.
+struct SnapshotStamp {
+    uint64_t db_size = 0;
+    int64_t db_mtime = 0;
+};
+
+std::string BackendSnapshot_PathFor(const std::string& db_path);
+bool BackendSnapshot_StampDB(const std::string& db_path, SnapshotStamp& out);
+// stamp is the one taken before the load that filled the structures
+bool BackendSnapshot_Save(const std::string& db_path, const SnapshotStamp& stamp,
+                          const PlayerHashTable& hash, const PlayerTrie& trie,
+                          const std::vector<SetSummary>* sets = nullptr, const GameTable* games = nullptr,
+                          const HighWaterMarks* marks = nullptr);
+// Brings the snapshot up to date after BackendDB_Refresh moved the marks from
+// from to to by appending delta, in O(delta). Once the appended refreshes
+// outgrow the image, the file is rewritten whole from hash and trie instead.
+// Returns false, leaving the file alone, unless the snapshot on disk is the
+// one written at from.
+bool BackendSnapshot_SaveRefresh(const std::string& db_path, const SnapshotStamp& stamp,
+                                 const PlayerHashTable& hash, const PlayerTrie& trie, const HighWaterMarks& from, const RefreshDelta& delta, const HighWaterMarks& to);
+// On SNAPSHOT_OK hash, trie and marks (if given) hold the snapshot contents;
+// otherwise they are untouched. The sets and games are not read.
+SnapshotStatus BackendSnapshot_Load(const std::string& db_path, PlayerHashTable& hash, PlayerTrie& trie,
+                                    HighWaterMarks* marks = nullptr);
+// The sets and games of the snapshot a BackendSnapshot_Load at marks read, for
+// building the set-level indexes once the players are searchable.
+// SNAPSHOT_STALE if a refresh has moved the snapshot past marks since.
+SnapshotStatus BackendSnapshot_LoadSets(const std::string& db_path, const HighWaterMarks& marks,
+                                        std::vector<SetSummary>& sets, GameTable& games);
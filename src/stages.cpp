@@ -0,0 +1,175 @@
+#include "stages.h"
+#include <algorithm>
+#include <cctype>
+
+static bool equalsIgnoreCase(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i])) return false;
+    return true;
+}
+
+uint32_t StageIndex::playerCode(long long id) {
+    auto it = _playerCode.emplace(id, (uint32_t)_playerIds.size()).first;
+    if (it->second == _playerIds.size()) {
+        _playerIds.push_back(id);
+        _scratch.emplace_back();
+    }
+    return it->second;
+}
+
+void StageIndex::mapCodes(const GameTable& games, std::vector<uint16_t>& charMap, std::vector<uint16_t>& stageMap) {
+    auto mapNames = [](const std::vector<std::string>& from, std::vector<std::string>& to,
+                       std::vector<uint16_t>& map) {
+        map.resize(from.size());
+        for (size_t i = 0; i < from.size(); ++i) {
+            auto it = std::find(to.begin(), to.end(), from[i]);
+            map[i] = (uint16_t)(it - to.begin());
+            if (it == to.end() && to.size() < GameTable::kOtherCode) to.push_back(from[i]);
+            else if (it == to.end()) map[i] = GameTable::kOtherCode;   // our dictionary is full
+        }
+    };
+    size_t oldChars = _characterNames.size();
+    mapNames(games.Characters(), _characterNames, charMap);
+    mapNames(games.Stages(), _stageNames, stageMap);
+    const size_t stages = _stageNames.size(), chars = _characterNames.size();
+
+    if (chars != oldChars) {
+        std::vector<Counts> wider(_stageGames.size() * chars);
+        for (size_t st = 0; st < _stageGames.size(); ++st)
+            std::copy(_charCounts.begin() + st * oldChars, _charCounts.begin() + (st + 1) * oldChars,
+                      wider.begin() + st * chars);
+        _charCounts.swap(wider);
+    }
+    _charCounts.resize(stages * chars);
+    _stageGames.resize(stages, 0);
+    _rows.resize(stages);
+}
+
+void StageIndex::countStage(size_t stage, const std::vector<GameTable::Game>& all, const uint32_t* order,
+                            size_t n, const uint16_t* charMap) {
+    if (stage == GameTable::kOtherCode || _stageNames[stage].empty() || n == 0) return;
+    const size_t chars = _characterNames.size();
+    Counts* charRow = &_charCounts[stage * chars];
+    // Count into the dense scratch row, then merge the touched players into
+    // the stage's sorted row in one pass
+    std::vector<uint32_t> touched;
+    for (size_t k = 0; k < n; ++k) {
+        const GameTable::Game& g = all[order[k]];
+        ++_stageGames[stage];
+        // Characters past a full dictionary count for the players but get no row
+        uint16_t wc = g.winner_char == GameTable::kOtherCode ? GameTable::kOtherCode : charMap[g.winner_char];
+        uint16_t lc = g.loser_char == GameTable::kOtherCode ? GameTable::kOtherCode : charMap[g.loser_char];
+        if (wc != GameTable::kOtherCode) ++charRow[wc].wins;
+        if (lc != GameTable::kOtherCode) ++charRow[lc].losses;
+        uint32_t w = playerCode(g.winner), l = playerCode(g.loser);
+        if (_scratch[w].Games() == 0) touched.push_back(w);
+        ++_scratch[w].wins;
+        if (_scratch[l].Games() == 0) touched.push_back(l);
+        ++_scratch[l].losses;
+    }
+    std::sort(touched.begin(), touched.end());
+
+    std::vector<Entry>& row = _rows[stage];
+    std::vector<Entry> merged;
+    merged.reserve(row.size() + touched.size());
+    size_t r = 0;
+    for (uint32_t p : touched) {
+        while (r < row.size() && row[r].player < p) merged.push_back(row[r++]);
+        Entry e{p, _scratch[p]};
+        if (r < row.size() && row[r].player == p) {
+            e.counts.wins += row[r].counts.wins;
+            e.counts.losses += row[r].counts.losses;
+            ++r;
+        }
+        merged.push_back(e);
+        _scratch[p] = Counts();
+    }
+    merged.insert(merged.end(), row.begin() + r, row.end());
+    row.swap(merged);
+}
+
+// Buckets the games by stage (counting sort) and counts each stage in turn
+void StageIndex::AddGames(const GameTable& games) {
+    const std::vector<GameTable::Game>& all = games.Games();
+    std::vector<uint16_t> charMap, stageMap;
+    mapCodes(games, charMap, stageMap);
+
+    const size_t srcStages = games.Stages().size();
+    std::vector<uint32_t> bucketStart(srcStages + 1, 0);
+    // Games on a stage past a full dictionary are left out, like unnamed ones
+    for (const GameTable::Game& g : all)
+        if (g.stage != GameTable::kOtherCode) ++bucketStart[g.stage + 1];
+    for (size_t st = 0; st < srcStages; ++st) bucketStart[st + 1] += bucketStart[st];
+    std::vector<uint32_t> byStage(bucketStart[srcStages]);
+    {
+        std::vector<uint32_t> fill(bucketStart.begin(), bucketStart.end() - 1);
+        for (uint32_t i = 0; i < all.size(); ++i)
+            if (all[i].stage != GameTable::kOtherCode) byStage[fill[all[i].stage]++] = i;
+    }
+    for (size_t st = 0; st < srcStages; ++st)
+        countStage(stageMap[st], all, byStage.data() + bucketStart[st],
+                   bucketStart[st + 1] - bucketStart[st], charMap.data());
+}
+
+void StageIndex::Build(const GameTable& games) {
+    _stageNames.clear();
+    _characterNames.clear();
+    _stageGames.clear();
+    _charCounts.clear();
+    _playerIds.clear();
+    _playerCode.clear();
+    _rows.clear();
+    _scratch.clear();
+    AddGames(games);
+}
+
+int StageIndex::StageCode(const std::string& name) const {
+    if (name.empty()) return GameTable::kUnknownCode;
+    for (size_t s = 0; s < _stageNames.size(); ++s)
+        if (equalsIgnoreCase(_stageNames[s], name)) return (int)s;
+    return GameTable::kUnknownCode;
+}
+
+StageIndex::Counts StageIndex::PlayerOn(long long player, int stage) const {
+    auto id = _playerCode.find(player);
+    if (id == _playerCode.end()) return Counts();
+    const std::vector<Entry>& row = _rows[stage];
+    auto e = std::lower_bound(row.begin(), row.end(), id->second,
+                              [](const Entry& en, uint32_t c) { return en.player < c; });
+    return (e != row.end() && e->player == id->second) ? e->counts : Counts();
+}
+
+std::vector<StageIndex::PlayerCounts> StageIndex::BestPlayersOn(int stage, size_t k, uint32_t min_games) const {
+    std::vector<PlayerCounts> out;
+    for (const Entry& e : _rows[stage])
+        if (e.counts.Games() >= min_games)
+            out.push_back({_playerIds[e.player], e.counts});
+    auto better = [](const PlayerCounts& a, const PlayerCounts& b) {
+        // a.wins / a.games > b.wins / b.games, without division
+        uint64_t lhs = (uint64_t)a.counts.wins * b.counts.Games();
+        uint64_t rhs = (uint64_t)b.counts.wins * a.counts.Games();
+        if (lhs != rhs) return lhs > rhs;
+        if (a.counts.Games() != b.counts.Games()) return a.counts.Games() > b.counts.Games();
+        return a.player < b.player;
+    };
+    if (out.size() > k) {
+        std::partial_sort(out.begin(), out.begin() + k, out.end(), better);
+        out.resize(k);
+    } else {
+        std::sort(out.begin(), out.end(), better);
+    }
+    return out;
+}
+
+size_t StageIndex::MemoryUsageBytes() const {
+    size_t total = _stageGames.capacity() * sizeof(uint64_t)
+                 + _charCounts.capacity() * sizeof(Counts)
+                 + _playerIds.capacity() * sizeof(long long)
+                 + _playerCode.size() * (sizeof(long long) + sizeof(uint32_t) + 2 * sizeof(void*))
+                 + _scratch.capacity() * sizeof(Counts);
+    for (const auto& row : _rows) total += sizeof(row) + row.capacity() * sizeof(Entry);
+    for (const auto* names : {&_stageNames, &_characterNames})
+        for (const auto& n : *names) total += sizeof(std::string) + n.capacity();
+    return total;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <cstdint>
+#include "backend.h"
+
+//--------------------------------------------------
+// Per-stage win/loss index over the decoded games
+//--------------------------------------------------
+// Built from a GameTable after a stats load. Stages and characters keep the
+// table's integer codes; players are recoded densely in first-seen order. Two
+// count tables answer the Stage Analysis queries without SQL:
+//   - character x stage: one dense Counts row per stage, indexed by character
+//   - player x stage:    per stage, only the players who played on it, sorted
+//                        by player code (compressed rows)
+// Games without a stage name, or on a stage coded GameTable::kOtherCode, are
+// left out; kOtherCode characters count for the players only. AddGames folds
+// in a refresh by merging each stage's new counts into its row; existing
+// codes never change.
+
+class StageIndex {
+public:
+    struct Counts {
+        uint32_t wins = 0;
+        uint32_t losses = 0;
+        uint32_t Games() const { return wins + losses; }
+        double WinRate() const { return wins + losses ? (double)wins / (wins + losses) : 0.0; }
+    };
+    struct PlayerCounts {
+        long long player;   // player ID
+        Counts counts;
+    };
+
+    void Build(const GameTable& games);
+    void AddGames(const GameTable& games);
+
+    // --- Dictionaries (codes shared with the GameTable) ---
+    size_t StageCount() const { return _stageNames.size(); }
+    size_t CharacterCount() const { return _characterNames.size(); }
+    const std::string& StageName(int code) const { return _stageNames[code]; }
+    const std::string& CharacterName(int code) const { return _characterNames[code]; }
+    // Case-insensitive; GameTable::kUnknownCode if no stage matches
+    int StageCode(const std::string& name) const;
+
+    // --- Queries ---
+    uint64_t GamesOn(int stage) const { return _stageGames[stage]; }
+    // CharacterCount() entries, indexed by character code
+    const Counts* CharactersOn(int stage) const { return &_charCounts[(size_t)stage * _characterNames.size()]; }
+    Counts PlayerOn(long long player, int stage) const;
+    // Highest win rate first (ties: more games first); players need min_games on the stage
+    std::vector<PlayerCounts> BestPlayersOn(int stage, size_t k, uint32_t min_games) const;
+
+    size_t MemoryUsageBytes() const;
+private:
+    struct Entry {
+        uint32_t player;   // index into _playerIds
+        Counts counts;
+    };
+    uint32_t playerCode(long long id);
+    // Remaps games' dictionaries into ours, growing the count tables for new names
+    void mapCodes(const GameTable& games, std::vector<uint16_t>& charMap, std::vector<uint16_t>& stageMap);
+    // Adds the games listed in order (indices into all) to the stage rows
+    void countStage(size_t stage, const std::vector<GameTable::Game>& all, const uint32_t* order, size_t n,
+                    const uint16_t* charMap);
+
+    std::vector<std::string> _stageNames;
+    std::vector<std::string> _characterNames;
+    std::vector<uint64_t> _stageGames;
+    std::vector<Counts> _charCounts;      // StageCount() x CharacterCount()
+    std::vector<long long> _playerIds;    // a player's code is its position
+    std::unordered_map<long long, uint32_t> _playerCode;
+    std::vector<std::vector<Entry>> _rows;   // per stage, sorted by player code
+    std::vector<Counts> _scratch;            // per player code, all zero between calls
+};